@@ -42,6 +42,22 @@ namespace NeuralAudio
 			return TCONST(1.0) / (TCONST(1.0)+ std::exp(-x));
 		}
 
+		static void Tanh(T* __restrict data, const size_t size)
+		{
+			for (size_t pos = 0; pos < size; pos++)
+			{
+				data[pos] = Tanh(data[pos]);
+			}
+		}
+
+		static void Sigmoid(T* __restrict data, const size_t size)
+		{
+			for (size_t pos = 0; pos < size; pos++)
+			{
+				data[pos] = Sigmoid(data[pos]);
+			}
+		}
+
 		template<size_t Channels>
 		static void LeakyReLU(ChannelRowSpan<T, Channels> channelBuffer)
 		{
@@ -95,6 +111,22 @@ namespace NeuralAudio
 			return  TCONST(0.5) * (Tanh(x * TCONST(0.5)) + TCONST(1));
 		}
 
+		static void Tanh(T* __restrict data, const size_t size)
+		{
+			for (size_t pos = 0; pos < size; pos++)
+			{
+				data[pos] = Tanh(data[pos]);
+			}
+		}
+
+		static void Sigmoid(T* __restrict data, const size_t size)
+		{
+			for (size_t pos = 0; pos < size; pos++)
+			{
+				data[pos] = Sigmoid(data[pos]);
+			}
+		}
+
 		template<size_t Channels>
 		static void LeakyReLU(ChannelRowSpan<T, Channels> channelBuffer)
 		{
@@ -146,5 +178,19 @@ namespace NeuralAudio
 		{
 			return  TCONST(0.5) * (Tanh(x * TCONST(0.5)) + TCONST(1));
 		}
+
+		static void Tanh(T* data, const size_t size)
+		{
+			auto map = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>(data, size);
+
+			map = map.tanh();
+		}
+
+		static void Sigmoid(T* data, const size_t size)
+		{
+			auto map = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>(data, size);
+
+			map = TCONST(0.5) * ((map * TCONST(0.5)).tanh() + TCONST(1));
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "ModelWeights.h"
+
+#define BINARY_MODEL_VERSION 1
+#define BINARY_MODEL_ALIGNMENT 64
+
+namespace NeuralAudio
+{
+	// Binary model files (".namb") hold the model json with its weight arrays replaced by references (see ModelWeights),
+	// followed by all of the weights as raw floats. The weights start on a 64 byte boundary, so they can be used straight
+	// from a memory mapped file. Weights that the internal engines can use in place are stored packed in their layout
+	// (see PackModelWeights()). All values are little endian.
+	struct BinaryModelHeader
+	{
+		char Magic[4];			// "NAMB"
+		uint32_t Version;
+		uint64_t JsonOffset;
+		uint64_t JsonSize;
+		uint64_t WeightsOffset;
+		uint64_t NumWeights;
+		char Extension[16];		// Extension of the original model file (ie: ".nam")
+	};
+
+	inline bool IsBinaryModel(const void* data, size_t size)
+	{
+		return (size >= sizeof(BinaryModelHeader)) && (std::memcmp(data, "NAMB", 4) == 0);
+	}
+
+	// The model json refers to the weights buffer (see ExtractModelWeights())
+	inline void WriteBinaryModel(const nlohmann::json& modelJson, const ModelWeights& weights, const std::filesystem::path& extension, std::ostream& stream)
+	{
+		const std::string jsonText = modelJson.dump();
+
+		BinaryModelHeader header = {};
+
+		std::memcpy(header.Magic, "NAMB", 4);
+		header.Version = BINARY_MODEL_VERSION;
+		header.JsonOffset = sizeof(BinaryModelHeader);
+		header.JsonSize = jsonText.size();
+		header.WeightsOffset = ((header.JsonOffset + header.JsonSize + BINARY_MODEL_ALIGNMENT - 1) / BINARY_MODEL_ALIGNMENT) * BINARY_MODEL_ALIGNMENT;
+		header.NumWeights = weights.GetSize();
+
+		std::string extensionText = extension.string();
+		std::memcpy(header.Extension, extensionText.data(), std::min(extensionText.size(), sizeof(header.Extension) - 1));
+
+		const std::vector<char> padding(header.WeightsOffset - (header.JsonOffset + header.JsonSize), 0);
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(jsonText.data(), jsonText.size());
+		stream.write(padding.data(), padding.size());
+		stream.write(reinterpret_cast<const char*>(weights.GetData()), weights.GetSize() * sizeof(float));
+	}
+
+	// If there is a data owner, the weights reference the data in place and keep the owner alive. Otherwise they are copied
+	// out of the data, so it doesn't need to outlive the returned json and weights.
+	inline bool ReadBinaryModel(const void* data, size_t size, nlohmann::json& modelJson, ModelWeightsPtr& weights, std::filesystem::path& extension,
+		std::shared_ptr<const void> dataOwner = nullptr)
+	{
+		if (!IsBinaryModel(data, size))
+			return false;
+
+		BinaryModelHeader header;
+		std::memcpy(&header, data, sizeof(header));
+
+		if (header.Version != BINARY_MODEL_VERSION)
+			return false;
+
+		if ((header.JsonOffset > size) || (header.JsonSize > (size - header.JsonOffset)) || (header.WeightsOffset > size) ||
+			(header.NumWeights > ((size - header.WeightsOffset) / sizeof(float))))
+			return false;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		const char* jsonStart = reinterpret_cast<const char*>(bytes + header.JsonOffset);
+
+		modelJson = nlohmann::json::parse(jsonStart, jsonStart + header.JsonSize, nullptr, false);
+
+		if (modelJson.is_discarded())
+			return false;
+
+		header.Extension[sizeof(header.Extension) - 1] = 0;
+		extension = std::string(header.Extension);
+
+		if (!CheckModelWeights(modelJson, header.NumWeights))
+			return false;
+
+		const uint8_t* weightBytes = bytes + header.WeightsOffset;
+
+		if (dataOwner && ((reinterpret_cast<uintptr_t>(weightBytes) % alignof(float)) == 0))
+		{
+			weights = std::make_shared<ModelWeights>(reinterpret_cast<const float*>(weightBytes), header.NumWeights, std::move(dataOwner));
+
+			return true;
+		}
+
+		std::vector<float> weightData(header.NumWeights);
+
+		std::memcpy(weightData.data(), weightBytes, header.NumWeights * sizeof(float));
+
+		weights = std::make_shared<ModelWeights>(std::move(weightData));
+
+		return true;
+	}
+}
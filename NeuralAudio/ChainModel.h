@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "NeuralModel.h"
+#include "NeuralModelImpl.h"
+
+namespace NeuralAudio
+{
+	// Runs several models in series (ie: boost, then amp, then power amp). Intermediate stages ping-pong between the output
+	// buffer and a single shared scratch buffer, arranged so that the last stage always writes to the output.
+	class ChainModel : public NeuralModelImpl
+	{
+		public:
+			static constexpr size_t ScratchAlignment = 64;	// Bytes
+
+			ChainModel(const std::vector<NeuralModel*>& chainModels, size_t maxBufferSize) :
+				models(chainModels)
+			{
+				for (auto& model : models)
+				{
+					processors.push_back(model->GetProcessor());
+				}
+
+				SetMaxAudioBufferSize((int)maxBufferSize);
+			}
+
+			~ChainModel()
+			{
+				for (auto& model : models)
+				{
+					delete model;
+				}
+			}
+
+			size_t GetNumModels()
+			{
+				return models.size();
+			}
+
+			NeuralModel* GetModel(size_t index)
+			{
+				return models[index];
+			}
+
+			EModelLoadMode GetLoadMode() override
+			{
+				return models.front()->GetLoadMode();
+			}
+
+			bool IsStatic() override
+			{
+				return std::all_of(models.begin(), models.end(), [](NeuralModel* model) { return model->IsStatic(); });
+			}
+
+			void SetMaxAudioBufferSize(const int maxSize) override
+			{
+				scratchSize = (size_t)std::max(maxSize, 1);
+
+				// Over-allocate so the start of the scratch buffer can be aligned
+				scratchData.resize(scratchSize + (ScratchAlignment / sizeof(float)));
+
+				uintptr_t address = reinterpret_cast<uintptr_t>(scratchData.data());
+				scratch = reinterpret_cast<float*>((address + ScratchAlignment - 1) & ~(uintptr_t)(ScratchAlignment - 1));
+
+				for (auto& model : models)
+				{
+					model->SetMaxAudioBufferSize(maxSize);
+				}
+			}
+
+			// Input level and sample rate come from the first model, and the output adjustment from the last
+			void SetAudioInputLevelDBu(float audioDBu) override
+			{
+				models.front()->SetAudioInputLevelDBu(audioDBu);
+			}
+
+			float GetAudioInputLevelDBu() override
+			{
+				return models.front()->GetAudioInputLevelDBu();
+			}
+
+			float GetRecommendedInputDBAdjustment() override
+			{
+				return models.front()->GetRecommendedInputDBAdjustment();
+			}
+
+			float GetRecommendedOutputDBAdjustment() override
+			{
+				return models.back()->GetRecommendedOutputDBAdjustment();
+			}
+
+			float GetSampleRate() override
+			{
+				return models.front()->GetSampleRate();
+			}
+
+			std::string GetModelVersion() override
+			{
+				return models.front()->GetModelVersion();
+			}
+
+			std::string GetMetadata(const std::string& fieldName) override
+			{
+				return models.front()->GetMetadata(fieldName);
+			}
+
+			// Sum of the stage receptive fields, or -1 if any stage doesn't have a fixed one
+			int GetReceptiveFieldSize() override
+			{
+				int receptiveFieldSize = 0;
+
+				for (auto& model : models)
+				{
+					int modelReceptiveFieldSize = model->GetReceptiveFieldSize();
+
+					if (modelReceptiveFieldSize < 0)
+						return -1;
+
+					receptiveFieldSize += modelReceptiveFieldSize;
+				}
+
+				return receptiveFieldSize;
+			}
+
+			int GetLatencySamples() override
+			{
+				int latencySamples = 0;
+
+				for (auto& model : models)
+				{
+					latencySamples += model->GetLatencySamples();
+				}
+
+				return latencySamples;
+			}
+
+			void Process(float* input, float* output, size_t numSamples) override
+			{
+				const size_t numStages = processors.size();
+
+				while (numSamples > 0)
+				{
+					const size_t toProcess = std::min(numSamples, scratchSize);
+
+					float* stageInput = input;
+
+					for (size_t stage = 0; stage < numStages; stage++)
+					{
+						// Counting back from the last stage, even stages write to the output and odd stages to the scratch buffer
+						float* stageOutput = (((numStages - 1 - stage) & 1) == 0) ? output : scratch;
+
+						processors[stage].Process(stageInput, stageOutput, toProcess);
+
+						stageInput = stageOutput;
+					}
+
+					input += toProcess;
+					output += toProcess;
+					numSamples -= toProcess;
+				}
+			}
+
+			void Prewarm() override
+			{
+				for (auto& model : models)
+				{
+					model->Prewarm();
+				}
+
+				// Later stages were prewarmed with silence, so let them settle to the output of the earlier stages.
+				// That takes the combined receptive field of the chain - fall back to a fixed length if any stage doesn't have one.
+				if (models.size() > 1)
+				{
+					int receptiveFieldSize = GetReceptiveFieldSize();
+
+					size_t prewarmSamples = (receptiveFieldSize < 0) ? 2048 : (size_t)receptiveFieldSize;
+					size_t blockSize = std::min(scratchSize, (size_t)64);
+
+					NeuralModelImpl::Prewarm(((prewarmSamples + blockSize - 1) / blockSize) * blockSize, blockSize);
+				}
+			}
+
+		private:
+			std::vector<NeuralModel*> models;
+			std::vector<NeuralModelProcessor> processors;
+			std::vector<float> scratchData;
+			float* scratch = nullptr;
+			size_t scratchSize = 0;
+	};
+}
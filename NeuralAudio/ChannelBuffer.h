@@ -10,96 +10,73 @@ namespace NeuralAudio
 	template<typename T, int Channels>
 	class ChannelRowSpan;
 
-	template<typename T, int Channels>
-	class ChannelBufferBase
-	{
-		public:
-			virtual size_t GetSize() const { return 0; }
-			virtual size_t GetNumCols() const { return 0; }
-			size_t GetNumChannels() const { return Channels; }
-			virtual T* GetData() { return nullptr; }
-			virtual T* GetData(size_t startCol)
-			{
-				(void)startCol;
-
-				return nullptr;
-			}
-			virtual const T* GetDataConst() const { return nullptr; }
-			virtual const T* GetDataConst(size_t startCol) const
-			{
-				(void)startCol;
-
-				return nullptr;
-			}
-			virtual void SetZero() {}
-			virtual T& operator()(size_t row, size_t col) = 0;
-
-			virtual const T& operator()(size_t row, size_t col) const = 0;
-	};
-
 	template<typename T, int Channels, int Cols>
-	class ChannelBuffer : public ChannelBufferBase<T, Channels>
+	class ChannelBuffer
 	{
 		public:
 			ChannelBuffer()
 			{
 			}
 			
-			size_t GetSize() const override
+			size_t GetSize() const
 			{
 				return (size_t)(Channels * Cols);
 			}
 
-			size_t GetNumCols() const override
+			size_t GetNumCols() const
 			{
 				return Cols;
 			}
 
-			T* GetData() override
+			T* GetData()
 			{
 				return data[0].data();
 			}
 
-			const T* GetDataConst() const override
+			const T* GetDataConst() const
 			{
 				return data[0].data();
 			}
 
-			T* GetData(size_t startCol) override
+			T* GetData(size_t startCol)
 			{
 				return data[startCol].data();
 			}
 
-			const T* GetDataConst(size_t startCol) const override
+			const T* GetDataConst(size_t startCol) const
 			{
 				return data[startCol].data();
 			}
 
-			void SetZero() override
+			void SetZero()
 			{
 				for (auto& col : data) {
 					col.fill(0);
 				}
 			}
 
-			T& operator()(size_t row, size_t col) override
+			T& operator()(size_t row, size_t col)
 			{
 				return data[col][row];
 			}
 
-			const T& operator()(size_t row, size_t col) const override
+			const T& operator()(size_t row, size_t col) const
 			{
 				return data[col][row];
 			}
 
 			const ChannelRowSpan<T, Channels> Slice(size_t startCol, size_t numCols)
 			{
-				return ChannelRowSpan<T, Channels>(this, startCol, numCols);
+				assert((startCol + numCols) <= Cols);
+
+				return ChannelRowSpan<T, Channels>(GetData(startCol), numCols);
 			}
 
 			const ChannelRowSpan<T, Channels> Slice(size_t numCols)
-			{					
-				return ChannelRowSpan<T, Channels>(this, numCols);
+			{
+				assert(numCols <= Cols);
+
+				return ChannelRowSpan<T, Channels>(GetData(), numCols);
 			}
 
 			const Eigen::Map<Eigen::Matrix<T, Channels, Cols>> GetEigenMap()
@@ -116,51 +93,48 @@ namespace NeuralAudio
 			alignas(32) std::array<std::array<T, Channels>, Cols> data;
 	};
 
+	// Spans point straight at the column data, so building and slicing them is cheap enough to do per-block
 	template<typename T, int Channels>
 	class ChannelRowSpan
 	{
 		public:
-			ChannelRowSpan(ChannelBufferBase<T, Channels>& baseBuffer) :
-				buffer(&baseBuffer),
-				startCol(0),
-				numCols(baseBuffer.GetNumCols())
+			ChannelRowSpan(T* data, size_t numCols) :
+				data(data),
+				numCols(numCols)
 			{
 			}
 
-			ChannelRowSpan(ChannelBufferBase<T, Channels>* baseBuffer) :
-				buffer(baseBuffer),
-				startCol(0),
-				numCols(baseBuffer->GetNumCols())
+			template<int Cols>
+			ChannelRowSpan(ChannelBuffer<T, Channels, Cols>& baseBuffer) :
+				data(baseBuffer.GetData()),
+				numCols(Cols)
 			{
-			
 			}
 
-			ChannelRowSpan(ChannelBufferBase<T, Channels>* baseBuffer, size_t startCol, size_t numCols) :
-				buffer(baseBuffer),
-				startCol(startCol),
+			template<int Cols>
+			ChannelRowSpan(ChannelBuffer<T, Channels, Cols>* baseBuffer, size_t startCol, size_t numCols) :
+				data(baseBuffer->GetData(startCol)),
 				numCols(numCols)
 			{
-				assert(startCol >= 0);
-				assert(numCols <= (baseBuffer->GetNumCols() - startCol));
+				assert(numCols <= (Cols - startCol));
 			}
 
-			ChannelRowSpan(ChannelBufferBase<T, Channels>* baseBuffer, size_t numCols) :
-				buffer(baseBuffer),
-				startCol(0),
+			template<int Cols>
+			ChannelRowSpan(ChannelBuffer<T, Channels, Cols>* baseBuffer, size_t numCols) :
+				data(baseBuffer->GetData()),
 				numCols(numCols)
 			{
-				assert(numCols <= baseBuffer->GetNumCols());
-
+				assert(numCols <= Cols);
 			}
 
 			const ChannelRowSpan<T, Channels> Slice(size_t startCol, size_t numCols) const
 			{
-				return ChannelRowSpan<T, Channels>(buffer, this->startCol + startCol, numCols);
+				return ChannelRowSpan<T, Channels>(data + (startCol * Channels), numCols);
 			}
 
 			const ChannelRowSpan<T, Channels> Slice(size_t numCols) const
 			{
-				return ChannelRowSpan<T, Channels>(buffer, this->startCol, numCols);
+				return ChannelRowSpan<T, Channels>(data, numCols);
 			}
 
 			size_t GetSize() const
@@ -180,32 +154,32 @@ namespace NeuralAudio
 
 			T& operator()(size_t row, size_t col)
 			{
-				return (*buffer)(row, startCol + col);
+				return data[(col * Channels) + row];
 			}
 
 			const T& operator()(size_t row, size_t col) const
 			{
-				return (*buffer)(row, startCol + col);
+				return data[(col * Channels) + row];
 			}
 
 			T* GetData() const
-			{				
-				return buffer->GetData(startCol);
+			{
+				return data;
 			}
 
 			const T* GetDataConst() const
 			{
-				return buffer->GetDataConst(startCol);
+				return data;
 			}
 
 			T* GetData(size_t startCol) const
 			{
-				return buffer->GetData(this->startCol + startCol);
+				return data + (startCol * Channels);
 			}
 
 			const T* GetDataConst(size_t startCol) const
 			{
-				return buffer->GetDataConst(this->startCol + startCol);
+				return data + (startCol * Channels);
 			}
 
 			Eigen::Map<Eigen::Matrix<T, Channels, Eigen::Dynamic>> GetEigenMap() const
@@ -238,8 +212,7 @@ namespace NeuralAudio
 			}
 
 		private:
-			ChannelBufferBase<T, Channels>* const buffer;
-			const size_t startCol;
+			T* const data;
 			const size_t numCols;
 	};
 }
\ No newline at end of file
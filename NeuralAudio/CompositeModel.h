@@ -4,6 +4,7 @@
 #include <vector>
 #include "NeuralModel.h"
 #include "NeuralModelImpl.h"
+#include "ModelWeights.h"
 
 namespace NeuralAudio
 {
@@ -83,6 +84,14 @@ namespace NeuralAudio
 				return models[currentModelIndex.load()]->GetReceptiveFieldSize();
 			}
 
+			int GetLatencySamples() override
+			{
+				if (currentModelIndex == -1)
+					return 0;
+
+				return models[currentModelIndex.load()]->GetLatencySamples();
+			}
+
 			void SetMaxAudioBufferSize(const int maxSize) override
 			{
 				for (auto& model : models)
@@ -127,14 +136,15 @@ namespace NeuralAudio
 	class ScalableCompositeModel : public CompositeModel
 	{
 		public:			
-			bool LoadFromJson(nlohmann::json& modelJson)
+			// The submodels refer to the weights buffer for their weights
+			bool LoadFromJson(nlohmann::json& modelJson, const ModelWeightsPtr& weights)
 			{
 				ReadNAMConfig(modelJson);
 
-				return CreateModelFromNAMJson(modelJson);
+				return CreateModelFromNAMJson(modelJson, weights);
 			}
 
-			virtual bool CreateModelFromNAMJson(nlohmann::json& modelJson)
+			virtual bool CreateModelFromNAMJson(nlohmann::json& modelJson, const ModelWeightsPtr& weights)
 			{
 				compositeLoadMode = loader->GetCompositeModelLoadMode();
 
@@ -142,11 +152,26 @@ namespace NeuralAudio
 
 				auto& subModels = config.at("submodels");
 
-				for (auto& submodelJson : subModels)
+				std::vector<NeuralModelImpl*> submodels(subModels.size(), nullptr);
+
+				try
 				{
-					NeuralModelImpl* submodel = dynamic_cast<NeuralModelImpl*>(loader->CreateFromJson(submodelJson.at("model"), ".nam", false));
+					loader->RunParallel(submodels.size(), [&](size_t index)
+					{
+						submodels[index] = loader->CreateModelFromJson(subModels.at(index).at("model"), weights, ".nam");
+					});
+				}
+				catch (...)
+				{
+					for (auto submodel : submodels)
+						delete submodel;
 
-					AddModel(submodelJson.at("max_value"), submodel);
+					throw;
+				}
+
+				for (size_t index = 0; index < submodels.size(); index++)
+				{
+					AddModel(subModels.at(index).at("max_value"), submodels[index]);
 				}
 
 				// Don't call SetMaxAudioBufferSize because it has already been done by individual models
@@ -0,0 +1,402 @@
+#pragma once
+
+// Based on ConvNet model structure from https://github.com/sdatkinson/NeuralAmpModelerCore
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+#include "WaveNet.h"
+
+namespace NeuralAudio
+{
+	enum class EConvNetActivation
+	{
+		Tanh,
+		ReLU,
+		LeakyReLU,
+		Hardtanh,
+		Sigmoid
+	};
+
+	// NAM ConvNet blocks are a kernel size 2 convolution (first block has a single input channel), optionally followed by
+	// batchnorm, then the activation. The head is a single output dense layer.
+	inline size_t GetConvNetNumWeights(size_t channels, size_t numBlocks, bool batchNorm)
+	{
+		size_t numWeights = 0;
+
+		for (size_t i = 0; i < numBlocks; i++)
+		{
+			const size_t inChannels = (i == 0) ? 1 : channels;
+
+			// Convolution only has a bias without batchnorm. Batchnorm has running mean, running var, weight, bias and eps.
+			numWeights += (channels * inChannels * 2) + (batchNorm ? ((4 * channels) + 1) : channels);
+		}
+
+		return numWeights + channels + 1;
+	}
+
+	// Layout of the packed weights of a ConvNet without batchnorm - each block's convolution and bias, then the head
+	inline WeightLayout GetConvNetWeightLayout(size_t channels, size_t numBlocks)
+	{
+		WeightLayout layout;
+
+		for (size_t i = 0; i < numBlocks; i++)
+		{
+			AddWeightBlock(layout, channels, (i == 0) ? 1 : channels, 2);
+			AddWeightBlock(layout, channels);
+		}
+
+		AddWeightBlock(layout, 1, channels);
+		AddWeightBlock(layout, 1);
+
+		return layout;
+	}
+
+	// Approximate cost of running a ConvNet (every weight is a multiply-add per sample)
+	inline size_t GetConvNetFLOPsPerSample(size_t channels, size_t numBlocks)
+	{
+		return 2 * GetConvNetNumWeights(channels, numBlocks, false);
+	}
+
+	// Fold the batchnorm of each block into its convolution weights and bias. The result has the weight layout of a
+	// ConvNet without batchnorm, so the engines never need to apply batchnorm while processing.
+	inline std::vector<float> FoldConvNetBatchNorm(std::span<const float> weights, size_t channels, size_t numBlocks)
+	{
+		std::vector<float> folded;
+		auto it = weights.begin();
+
+		for (size_t block = 0; block < numBlocks; block++)
+		{
+			const size_t inChannels = (block == 0) ? 1 : channels;
+			const size_t convSize = channels * inChannels * 2;	// [out][in][kernel]
+
+			std::vector<float> conv(it, it + convSize);
+			it += convSize;
+
+			std::vector<float> mean(it, it + channels);
+			it += channels;
+			std::vector<float> var(it, it + channels);
+			it += channels;
+			std::vector<float> weight(it, it + channels);
+			it += channels;
+			std::vector<float> bias(it, it + channels);
+			it += channels;
+			const float eps = *(it++);
+
+			std::vector<float> scale(channels);
+
+			for (size_t i = 0; i < channels; i++)
+				scale[i] = weight[i] / std::sqrt(eps + var[i]);
+
+			for (size_t i = 0; i < channels; i++)
+				for (size_t j = 0; j < (inChannels * 2); j++)
+					folded.push_back(conv[(i * inChannels * 2) + j] * scale[i]);
+
+			for (size_t i = 0; i < channels; i++)
+				folded.push_back(bias[i] - (scale[i] * mean[i]));
+		}
+
+		folded.insert(folded.end(), it, weights.end());	// Head
+
+		return folded;
+	}
+
+	// Zero-pad the weights of a ConvNet without batchnorm to a larger number of channels. The padded channels only feed
+	// zero weights in the next block and the head, so they don't change the output whatever the activation does to them.
+	inline std::vector<float> PadConvNetWeights(std::span<const float> weights, size_t channels, size_t paddedChannels, size_t numBlocks)
+	{
+		std::vector<float> padded;
+		auto it = weights.begin();
+
+		for (size_t block = 0; block < numBlocks; block++)
+		{
+			const size_t inChannels = (block == 0) ? 1 : channels;
+			const size_t paddedInChannels = (block == 0) ? 1 : paddedChannels;
+
+			for (size_t i = 0; i < paddedChannels; i++)
+				for (size_t j = 0; j < paddedInChannels; j++)
+					for (size_t k = 0; k < 2; k++)
+						padded.push_back(((i < channels) && (j < inChannels)) ? *(it++) : 0.0f);
+
+			for (size_t i = 0; i < paddedChannels; i++)
+				padded.push_back((i < channels) ? *(it++) : 0.0f);
+		}
+
+		for (size_t i = 0; i < paddedChannels; i++)
+			padded.push_back((i < channels) ? *(it++) : 0.0f);
+
+		padded.push_back(*(it++));
+
+		return padded;
+	}
+
+	template <typename T, int InChannels, int Channels, int Dilation, EConvNetActivation Activation>
+	class ConvNetBlockT
+	{
+	private:
+		Conv1DT<T, InChannels, Channels, 2, true, Dilation> conv1D;	// Batchnorm is folded into the weights and bias
+
+	public:
+		static constexpr auto ReceptiveFieldSize = Dilation;
+
+		void AllocBuffer(int allocNum)
+		{
+			conv1D.channelBuffer.AllocBuffer(allocNum);
+		}
+
+		size_t GetNumWeights()
+		{
+			return conv1D.GetNumWeights();
+		}
+
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			conv1D.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const T*& packed)
+		{
+			conv1D.BindWeights(packed);
+		}
+
+		void SetConvolutionTileSize(int tileSize)
+		{
+			conv1D.SetMultiFrameSize(tileSize);
+		}
+
+		auto GetInputBuffer(size_t numFrames)
+		{
+			return conv1D.GetInputBuffer(numFrames);
+		}
+
+		void AdvanceFrames(const size_t numFrames)
+		{
+			conv1D.channelBuffer.AdvanceFrames(numFrames);
+		}
+
+		void CopyBuffer()
+		{
+			conv1D.channelBuffer.CopyBuffer();
+		}
+
+		void Process(const ChannelRowSpan<T, Channels>& output)
+		{
+			conv1D.Process(output);
+
+			if constexpr (Activation == EConvNetActivation::Tanh)
+			{
+				auto block = output;
+
+				WAVENET_MATH<T>::template Tanh<Channels>(block);
+			}
+			else if constexpr (Activation == EConvNetActivation::LeakyReLU)
+			{
+				WAVENET_MATH<T>::template LeakyReLU<Channels>(output);
+			}
+			else if constexpr (Activation == EConvNetActivation::Sigmoid)
+			{
+				WAVENET_MATH<T>::Sigmoid(output.GetData(), output.GetSize());
+			}
+			else
+			{
+				T* data = output.GetData();
+				const size_t size = output.GetSize();
+
+				for (size_t pos = 0; pos < size; pos++)
+				{
+					if constexpr (Activation == EConvNetActivation::ReLU)
+						data[pos] = std::max(data[pos], TCONST(0));
+					else
+						data[pos] = std::clamp(data[pos], TCONST(-1), TCONST(1));
+				}
+			}
+		}
+	};
+
+	template <typename T, int Channels, typename DilationsSequence, EConvNetActivation Activation>
+	class ConvNetModelT
+	{
+		template <typename>
+		struct BlocksHelper
+		{
+		};
+
+		template <int firstDilation, int... dilationVals>
+		struct BlocksHelper<Dilations<firstDilation, dilationVals...>>
+		{
+			using type = std::tuple<ConvNetBlockT<T, 1, Channels, firstDilation, Activation>, ConvNetBlockT<T, Channels, Channels, dilationVals, Activation>...>;
+		};
+
+		using Blocks = typename BlocksHelper<DilationsSequence>::type;
+
+	private:
+		Blocks blocks;
+		DenseLayerT<T, Channels, 1, true> head;
+		ChannelBuffer<T, Channels, WAVENET_MAX_NUM_FRAMES> blockOutputs;
+		std::shared_ptr<const void> weightsOwner;
+
+	public:
+		static constexpr auto NumChannelsP = Channels;
+		static constexpr auto NumBlocks = std::tuple_size_v<Blocks>;
+		static constexpr auto LastBlock = NumBlocks - 1;
+
+		int ReceptiveFieldSize = 0;
+
+		ConvNetModelT()
+		{
+			int allocNum = 0;
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					ReceptiveFieldSize += std::get<blockIndex>(blocks).ReceptiveFieldSize;
+
+					std::get<blockIndex>(blocks).AllocBuffer(allocNum++);
+				});
+		}
+
+		size_t GetNumWeights()
+		{
+			size_t numWeights = head.GetNumWeights();
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					numWeights += std::get<blockIndex>(blocks).GetNumWeights();
+				});
+
+			return numWeights;
+		}
+
+		// Weights must have any batchnorm already folded in
+		void SetWeights(std::span<const float> weights)
+		{
+			size_t numWeights = GetNumWeights();
+
+			if (numWeights != weights.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numWeights << " but got " << weights.size();
+				throw std::runtime_error(str.str());
+			}
+
+			auto packedWeights = std::make_shared<std::vector<T>>(numWeights);
+
+			PackWeights(weights, GetWeightLayout(), packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
+
+		// Layout of our packed weights - each block in turn, then the head
+		WeightLayout GetWeightLayout() const
+		{
+			WeightLayout layout;
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					std::get<blockIndex>(blocks).AddWeightLayout(layout);
+				});
+
+			head.AddWeightLayout(layout);
+
+			return layout;
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive, and they
+		// may be shared with other instances.
+		void SetSharedWeights(const T* packedWeights, std::shared_ptr<const void> owner)
+		{
+			weightsOwner = std::move(owner);
+
+			const T* packed = packedWeights;
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					std::get<blockIndex>(blocks).BindWeights(packed);
+				});
+
+			head.BindWeights(packed);
+		}
+
+		const std::shared_ptr<const void>& GetSharedWeights() const
+		{
+			return weightsOwner;
+		}
+
+		// New instance that shares our weights, and starts with a copy of our state
+		ConvNetModelT* CreateSharedInstance() const
+		{
+			return new ConvNetModelT(*this);
+		}
+
+		// Other must share our weights. Only copies buffers, so doesn't allocate.
+		void CopyState(const ConvNetModelT& other)
+		{
+			assert(other.weightsOwner == weightsOwner);
+
+			*this = other;
+		}
+
+		std::string GetArchitectureSignature()
+		{
+			return "ConvNet_" + std::to_string(Channels) + "x" + std::to_string(NumBlocks) + "_rf" + std::to_string(ReceptiveFieldSize);
+		}
+
+		// Multi-frame convolution tile size (0, 4 or 8)
+		void SetConvolutionTileSize(int tileSize)
+		{
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					std::get<blockIndex>(blocks).SetConvolutionTileSize(tileSize);
+				});
+		}
+
+		size_t GetMaxFrames()
+		{
+			return WAVENET_MAX_NUM_FRAMES;
+		}
+
+		// Fill the block histories with the steady state for silent input
+		void Prewarm()
+		{
+			std::get<0>(blocks).GetInputBuffer(1).GetData()[0] = 0;
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					std::get<blockIndex>(blocks).CopyBuffer();
+
+					if constexpr (blockIndex == LastBlock)
+					{
+						std::get<blockIndex>(blocks).Process(blockOutputs.Slice(1));
+					}
+					else
+					{
+						std::get<blockIndex>(blocks).Process(std::get<blockIndex + 1>(blocks).GetInputBuffer(1));
+					}
+				});
+		}
+
+		void Process(const T* input, T* output, const size_t numFrames)
+		{
+			std::memcpy(std::get<0>(blocks).GetInputBuffer(numFrames).GetData(), input, numFrames * sizeof(T));
+
+			ForEachIndex<NumBlocks>([&](auto blockIndex)
+				{
+					if constexpr (blockIndex == LastBlock)
+					{
+						std::get<blockIndex>(blocks).Process(blockOutputs.Slice(numFrames));
+					}
+					else
+					{
+						std::get<blockIndex>(blocks).Process(std::get<blockIndex + 1>(blocks).GetInputBuffer(numFrames));
+					}
+
+					std::get<blockIndex>(blocks).AdvanceFrames(numFrames);
+				});
+
+			head.Process(blockOutputs.Slice(numFrames), ChannelRowSpan<T, 1>(output, numFrames));
+		}
+	};
+}
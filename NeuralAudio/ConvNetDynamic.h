@@ -0,0 +1,276 @@
+#pragma once
+
+// Based on ConvNet model structure from https://github.com/sdatkinson/NeuralAmpModelerCore
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <Eigen/Dense>
+#include "Activation.h"
+#include "ConvNet.h"
+#include "WaveNetDynamic.h"
+
+namespace NeuralAudio
+{
+	inline void ApplyConvNetActivation(float* data, const size_t size, const EConvNetActivation activation)
+	{
+		switch (activation)
+		{
+			case EConvNetActivation::Tanh:
+				WAVENET_MATH<float>::Tanh(data, size);
+				break;
+
+			case EConvNetActivation::Sigmoid:
+				WAVENET_MATH<float>::Sigmoid(data, size);
+				break;
+
+			case EConvNetActivation::LeakyReLU:
+				for (size_t i = 0; i < size; i++)
+					data[i] = (data[i] > 0) ? data[i] : (0.01f * data[i]);
+				break;
+
+			case EConvNetActivation::ReLU:
+				for (size_t i = 0; i < size; i++)
+					data[i] = std::max(data[i], 0.0f);
+				break;
+
+			case EConvNetActivation::Hardtanh:
+				for (size_t i = 0; i < size; i++)
+					data[i] = std::clamp(data[i], -1.0f, 1.0f);
+				break;
+		}
+	}
+
+	class ConvNetBlock
+	{
+	private:
+		size_t inChannels;
+		Conv1D conv1D;	// Batchnorm is folded into the weights and bias
+		EConvNetActivation activation;
+		Eigen::MatrixXf buffer;
+
+	public:
+		size_t ReceptiveFieldSize;
+		size_t bufferStart;
+
+		ConvNetBlock(size_t inChannels, size_t channels, size_t dilation, EConvNetActivation activation) :
+			inChannels(inChannels),
+			conv1D(inChannels, channels, 2, true, dilation),
+			activation(activation),
+			ReceptiveFieldSize(dilation),
+			bufferStart(0)
+		{
+		}
+
+		Eigen::MatrixXf& GetBlockBuffer()
+		{
+			return buffer;
+		}
+
+		void AllocBuffer(size_t allocNum)
+		{
+			size_t size = ReceptiveFieldSize + ((LAYER_ARRAY_BUFFER_PADDING + 1) * WAVENET_MAX_NUM_FRAMES);
+
+			buffer.resize(inChannels, size);
+			buffer.setZero();
+
+			// offset prevents buffer rewinds of various blocks from happening at the same time
+#if (LAYER_ARRAY_BUFFER_PADDING == 0)
+			bufferStart = ReceptiveFieldSize;
+#else
+			bufferStart = size - (WAVENET_MAX_NUM_FRAMES * ((allocNum % LAYER_ARRAY_BUFFER_PADDING) + 1));
+#endif
+		}
+
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			conv1D.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const float*& packed)
+		{
+			conv1D.BindWeights(packed);
+		}
+
+		void AdvanceFrames(const size_t numFrames)
+		{
+			bufferStart += numFrames;
+
+			if ((int)(bufferStart + WAVENET_MAX_NUM_FRAMES) > buffer.cols())
+			{
+				buffer.leftCols(ReceptiveFieldSize) = buffer.middleCols(bufferStart - ReceptiveFieldSize, ReceptiveFieldSize).eval();
+
+				bufferStart = ReceptiveFieldSize;
+			}
+		}
+
+		void CopyBuffer()
+		{
+			for (size_t offset = 1; offset < ReceptiveFieldSize + 1; offset++)
+			{
+				buffer.col(bufferStart - offset) = buffer.col(bufferStart);
+			}
+		}
+
+		// Output must be whole columns of a column major matrix, so its data is contiguous
+		void Process(Eigen::Ref<Eigen::MatrixXf> output, const size_t numFrames)
+		{
+			conv1D.Process(buffer, output, bufferStart, numFrames);
+
+			ApplyConvNetActivation(output.data(), output.rows() * output.cols(), activation);
+		}
+	};
+
+	class ConvNetModel
+	{
+	private:
+		size_t channels;
+		std::vector<ConvNetBlock> blocks;
+		DenseLayer head;
+		Eigen::MatrixXf blockOutputs;
+		std::shared_ptr<const void> weightsOwner;
+
+	public:
+		size_t ReceptiveFieldSize = 0;
+
+		ConvNetModel(size_t channels, const std::vector<size_t>& dilations, EConvNetActivation activation) :
+			channels(channels),
+			head(channels, 1, true),
+			blockOutputs(channels, WAVENET_MAX_NUM_FRAMES)
+		{
+			size_t allocNum = 0;
+
+			for (size_t i = 0; i < dilations.size(); i++)
+			{
+				blocks.push_back(ConvNetBlock((i == 0) ? 1 : channels, channels, dilations[i], activation));
+
+				blocks.back().AllocBuffer(allocNum++);
+
+				ReceptiveFieldSize += dilations[i];
+			}
+		}
+
+		size_t GetNumBlocks() const
+		{
+			return blocks.size();
+		}
+
+		// Weights must have any batchnorm already folded in
+		void SetWeights(std::span<const float> weights)
+		{
+			size_t numWeights = GetConvNetNumWeights(channels, blocks.size(), false);
+
+			if (numWeights != weights.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numWeights << " but got " << weights.size();
+				throw std::runtime_error(str.str());
+			}
+
+			auto packedWeights = std::make_shared<std::vector<float>>(numWeights);
+
+			PackWeights(weights, GetWeightLayout(), packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
+
+		// Layout of our packed weights - each block in turn, then the head
+		WeightLayout GetWeightLayout() const
+		{
+			WeightLayout layout;
+
+			for (auto& block : blocks)
+			{
+				block.AddWeightLayout(layout);
+			}
+
+			head.AddWeightLayout(layout);
+
+			return layout;
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive, and they
+		// may be shared with other instances.
+		void SetSharedWeights(const float* packedWeights, std::shared_ptr<const void> owner)
+		{
+			weightsOwner = std::move(owner);
+
+			const float* packed = packedWeights;
+
+			for (auto& block : blocks)
+			{
+				block.BindWeights(packed);
+			}
+
+			head.BindWeights(packed);
+		}
+
+		const std::shared_ptr<const void>& GetSharedWeights() const
+		{
+			return weightsOwner;
+		}
+
+		// New instance that shares our weights, and starts with a copy of our state
+		ConvNetModel* CreateSharedInstance() const
+		{
+			return new ConvNetModel(*this);
+		}
+
+		// Other must share our weights. Buffers are already the right size, so this doesn't allocate.
+		void CopyState(const ConvNetModel& other)
+		{
+			assert(other.weightsOwner == weightsOwner);
+
+			*this = other;
+		}
+
+		size_t GetMaxFrames()
+		{
+			return WAVENET_MAX_NUM_FRAMES;
+		}
+
+		// Fill the block histories with the steady state for silent input
+		void Prewarm()
+		{
+			blocks[0].GetBlockBuffer()(0, blocks[0].bufferStart) = 0;
+
+			for (size_t blockIndex = 0; blockIndex < blocks.size(); blockIndex++)
+			{
+				blocks[blockIndex].CopyBuffer();
+
+				ProcessBlock(blockIndex, 1);
+			}
+		}
+
+		void Process(const float* input, float* output, const size_t numFrames)
+		{
+			blocks[0].GetBlockBuffer().middleCols(blocks[0].bufferStart, numFrames) = Eigen::Map<const Eigen::MatrixXf>(input, 1, numFrames);
+
+			for (size_t blockIndex = 0; blockIndex < blocks.size(); blockIndex++)
+			{
+				ProcessBlock(blockIndex, numFrames);
+
+				blocks[blockIndex].AdvanceFrames(numFrames);
+			}
+
+			auto out = Eigen::Map<Eigen::MatrixXf>(output, 1, numFrames);
+
+			head.Process(blockOutputs.leftCols(numFrames), out);
+		}
+
+	private:
+		void ProcessBlock(const size_t blockIndex, const size_t numFrames)
+		{
+			if (blockIndex == (blocks.size() - 1))
+			{
+				blocks[blockIndex].Process(blockOutputs.leftCols(numFrames), numFrames);
+			}
+			else
+			{
+				auto& nextBlock = blocks[blockIndex + 1];
+
+				blocks[blockIndex].Process(nextBlock.GetBlockBuffer().middleCols(nextBlock.bufferStart, numFrames), numFrames);
+			}
+		}
+	};
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <Eigen/Dense>
+#include "FFT.h"
+
+// Smallest partition size considered when choosing a partition size automatically
+#ifndef CONVOLUTION_MIN_PARTITION_SIZE
+#define CONVOLUTION_MIN_PARTITION_SIZE 32
+#endif
+
+#ifndef CONVOLUTION_MAX_PARTITION_SIZE
+#define CONVOLUTION_MAX_PARTITION_SIZE 4096
+#endif
+
+namespace NeuralAudio
+{
+	// Zero latency FIR convolution. The first partition of the filter is done in direct form a sample at a time, and the
+	// rest of the filter is done with uniformly partitioned FFT convolution a block at a time. Short filters are done
+	// entirely in direct form.
+	class PartitionedConvolution
+	{
+	public:
+		// Approximate cost per sample for a partition size (0 is direct form only), relative to one direct form tap.
+		// Direct form taps are a vectorized dot product, so they are much cheaper than FFT butterflies or spectrum bins.
+		static double GetCostPerSample(size_t length, size_t partitionSize)
+		{
+			if ((partitionSize == 0) || (partitionSize >= length))
+				return (double)length;
+
+			const size_t numTailPartitions = (length - 1) / partitionSize;
+			const double fftSize = 2.0 * (double)partitionSize;
+
+			const double fftCost = 8.0 * fftSize * std::log2(fftSize);	// Forward and inverse transform
+			const double spectrumCost = 16.0 * (double)numTailPartitions * ((double)partitionSize + 1);	// Complex multiply-add per bin
+
+			return (double)partitionSize + ((fftCost + spectrumCost) / (double)partitionSize);
+		}
+
+		// Returns the cheapest partition size for a filter length, or 0 if direct form is cheapest
+		static size_t GetAutoPartitionSize(size_t length)
+		{
+			size_t bestSize = 0;
+			double bestCost = GetCostPerSample(length, 0);
+
+			for (size_t partitionSize = CONVOLUTION_MIN_PARTITION_SIZE; (partitionSize < length) && (partitionSize <= CONVOLUTION_MAX_PARTITION_SIZE); partitionSize *= 2)
+			{
+				double cost = GetCostPerSample(length, partitionSize);
+
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSize = partitionSize;
+				}
+			}
+
+			return bestSize;
+		}
+
+		// Tap 0 is the current sample. A partition size of 0 chooses one automatically from the filter length.
+		void SetImpulseResponse(const float* impulseResponse, size_t length, size_t newPartitionSize = 0)
+		{
+			filterLength = length;
+
+			if (newPartitionSize == 0)
+				newPartitionSize = GetAutoPartitionSize(length);
+
+			if ((newPartitionSize == 0) || (newPartitionSize >= length))
+			{
+				partitionSize = length;	// Direct form only
+				numTailPartitions = 0;
+			}
+			else
+			{
+				partitionSize = newPartitionSize;
+				numTailPartitions = (length - 1) / partitionSize;
+			}
+
+			// Head taps are reversed so that they can be dotted with the input history
+			headTaps.resize(partitionSize);
+
+			for (size_t i = 0; i < partitionSize; i++)
+				headTaps[i] = impulseResponse[partitionSize - 1 - i];
+
+			inputBuffer.resize(2 * partitionSize);
+
+			if (numTailPartitions > 0)
+			{
+				fft.SetSize(2 * partitionSize);
+
+				const size_t numBins = fft.GetNumBins();
+
+				tailRe.resize(numTailPartitions * numBins);
+				tailIm.resize(numTailPartitions * numBins);
+
+				fdlRe.resize(numTailPartitions * numBins);
+				fdlIm.resize(numTailPartitions * numBins);
+
+				accRe.resize(numBins);
+				accIm.resize(numBins);
+
+				fftBuffer.resize(2 * partitionSize);
+				tailOutput.resize(partitionSize);
+
+				for (size_t partition = 0; partition < numTailPartitions; partition++)
+				{
+					std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+
+					const size_t start = (partition + 1) * partitionSize;
+					const size_t numTaps = std::min(partitionSize, length - start);
+
+					std::copy(impulseResponse + start, impulseResponse + start + numTaps, fftBuffer.begin());
+
+					fft.Forward(fftBuffer.data(), &tailRe[partition * numBins], &tailIm[partition * numBins]);
+				}
+			}
+
+			Reset();
+		}
+
+		size_t GetLength() const
+		{
+			return filterLength;
+		}
+
+		// Returns the filter length if it is done entirely in direct form
+		size_t GetPartitionSize() const
+		{
+			return partitionSize;
+		}
+
+		void Reset()
+		{
+			std::fill(inputBuffer.begin(), inputBuffer.end(), 0.0f);
+			std::fill(fdlRe.begin(), fdlRe.end(), 0.0f);
+			std::fill(fdlIm.begin(), fdlIm.end(), 0.0f);
+			std::fill(tailOutput.begin(), tailOutput.end(), 0.0f);
+
+			blockPos = 0;
+			fdlPos = 0;
+		}
+
+		// Input and output can be the same buffer
+		void Process(const float* input, float* output, size_t numSamples)
+		{
+			while (numSamples > 0)
+			{
+				const size_t numFrames = std::min(numSamples, partitionSize - blockPos);
+
+				// The input buffer holds the previous block followed by the current one
+				std::memcpy(inputBuffer.data() + partitionSize + blockPos, input, numFrames * sizeof(float));
+
+				auto taps = Eigen::Map<const Eigen::VectorXf>(headTaps.data(), partitionSize);
+
+				for (size_t i = 0; i < numFrames; i++)
+				{
+					const size_t pos = blockPos + i;
+
+					output[i] = taps.dot(Eigen::Map<const Eigen::VectorXf>(inputBuffer.data() + pos + 1, partitionSize));
+
+					if (numTailPartitions > 0)
+						output[i] += tailOutput[pos];
+				}
+
+				blockPos += numFrames;
+
+				if (blockPos == partitionSize)
+				{
+					if (numTailPartitions > 0)
+						ProcessTail();
+
+					std::memcpy(inputBuffer.data(), inputBuffer.data() + partitionSize, partitionSize * sizeof(float));
+
+					blockPos = 0;
+				}
+
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		// Called when an input block is complete. Computes the contribution of the tail partitions to the next output block,
+		// which only depends on input we already have.
+		void ProcessTail()
+		{
+			const size_t numBins = fft.GetNumBins();
+
+			fdlPos = (fdlPos + numTailPartitions - 1) % numTailPartitions;
+
+			fft.Forward(inputBuffer.data(), &fdlRe[fdlPos * numBins], &fdlIm[fdlPos * numBins]);
+
+			std::fill(accRe.begin(), accRe.end(), 0.0f);
+			std::fill(accIm.begin(), accIm.end(), 0.0f);
+
+			for (size_t partition = 0; partition < numTailPartitions; partition++)
+			{
+				const size_t fdlIndex = (fdlPos + partition) % numTailPartitions;
+
+				const float* __restrict xRe = &fdlRe[fdlIndex * numBins];
+				const float* __restrict xIm = &fdlIm[fdlIndex * numBins];
+				const float* __restrict hRe = &tailRe[partition * numBins];
+				const float* __restrict hIm = &tailIm[partition * numBins];
+				float* __restrict yRe = accRe.data();
+				float* __restrict yIm = accIm.data();
+
+				for (size_t bin = 0; bin < numBins; bin++)
+				{
+					yRe[bin] += (xRe[bin] * hRe[bin]) - (xIm[bin] * hIm[bin]);
+					yIm[bin] += (xRe[bin] * hIm[bin]) + (xIm[bin] * hRe[bin]);
+				}
+			}
+
+			fft.Inverse(accRe.data(), accIm.data(), fftBuffer.data());
+
+			// The second half is the linear (non wrapped) part of the circular convolution
+			std::memcpy(tailOutput.data(), fftBuffer.data() + partitionSize, partitionSize * sizeof(float));
+		}
+
+		size_t filterLength = 0;
+		size_t partitionSize = 0;
+		size_t numTailPartitions = 0;
+		size_t blockPos = 0;
+		size_t fdlPos = 0;
+		std::vector<float> headTaps;
+		std::vector<float> inputBuffer;
+		RealFFT fft;
+		std::vector<float> tailRe;	// Spectra of the tail partitions
+		std::vector<float> tailIm;
+		std::vector<float> fdlRe;	// Frequency domain delay line of input block spectra
+		std::vector<float> fdlIm;
+		std::vector<float> accRe;
+		std::vector<float> accIm;
+		std::vector<float> fftBuffer;
+		std::vector<float> tailOutput;
+	};
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace NeuralAudio
+{
+	// Radix-2 FFT of real signals, done as a half size complex FFT. Size must be a power of two (at least 4).
+	// Complex data is kept as separate real and imaginary arrays so the butterflies vectorize.
+	class RealFFT
+	{
+	public:
+		RealFFT()
+		{
+		}
+
+		RealFFT(size_t size)
+		{
+			SetSize(size);
+		}
+
+		void SetSize(size_t newSize)
+		{
+			assert((newSize >= 4) && ((newSize & (newSize - 1)) == 0));
+
+			size = newSize;
+			halfSize = size / 2;
+
+			const double pi = 3.14159265358979323846;
+
+			bitReverse.resize(halfSize);
+
+			size_t numBits = 0;
+
+			while (((size_t)1 << numBits) < halfSize)
+				numBits++;
+
+			for (size_t i = 0; i < halfSize; i++)
+			{
+				size_t reversed = 0;
+
+				for (size_t bit = 0; bit < numBits; bit++)
+				{
+					if (i & ((size_t)1 << bit))
+						reversed |= (size_t)1 << (numBits - 1 - bit);
+				}
+
+				bitReverse[i] = reversed;
+			}
+
+			// Twiddles for each stage are stored contiguously - the stage with butterfly span "half" starts at index half - 1
+			stageTwiddleRe.resize(halfSize);
+			stageTwiddleIm.resize(halfSize);
+
+			for (size_t half = 1; half < halfSize; half *= 2)
+			{
+				for (size_t j = 0; j < half; j++)
+				{
+					const double angle = -pi * (double)j / (double)half;
+
+					stageTwiddleRe[half - 1 + j] = (float)std::cos(angle);
+					stageTwiddleIm[half - 1 + j] = (float)std::sin(angle);
+				}
+			}
+
+			realTwiddleRe.resize(halfSize + 1);
+			realTwiddleIm.resize(halfSize + 1);
+
+			for (size_t k = 0; k <= halfSize; k++)
+			{
+				const double angle = -2.0 * pi * (double)k / (double)size;
+
+				realTwiddleRe[k] = (float)std::cos(angle);
+				realTwiddleIm[k] = (float)std::sin(angle);
+			}
+
+			workRe.resize(halfSize);
+			workIm.resize(halfSize);
+		}
+
+		size_t GetSize() const
+		{
+			return size;
+		}
+
+		size_t GetNumBins() const
+		{
+			return halfSize + 1;
+		}
+
+		// Spectrum is returned split into real and imaginary parts, with GetNumBins() values each
+		void Forward(const float* input, float* re, float* im)
+		{
+			for (size_t n = 0; n < halfSize; n++)
+			{
+				workRe[bitReverse[n]] = input[2 * n];
+				workIm[bitReverse[n]] = input[(2 * n) + 1];
+			}
+
+			Transform(workIm.data(), workRe.data());
+
+			// Even and odd sample spectra are untangled from the packed transform, then combined
+			for (size_t k = 0; k <= halfSize; k++)
+			{
+				const size_t index = (k == halfSize) ? 0 : k;
+				const size_t mirror = (k == 0) ? 0 : (halfSize - k);
+
+				const float evenRe = 0.5f * (workRe[index] + workRe[mirror]);
+				const float evenIm = 0.5f * (workIm[index] - workIm[mirror]);
+				const float oddRe = 0.5f * (workIm[index] + workIm[mirror]);
+				const float oddIm = -0.5f * (workRe[index] - workRe[mirror]);
+
+				re[k] = evenRe + (realTwiddleRe[k] * oddRe) - (realTwiddleIm[k] * oddIm);
+				im[k] = evenIm + (realTwiddleRe[k] * oddIm) + (realTwiddleIm[k] * oddRe);
+			}
+		}
+
+		// Output is scaled so that Inverse(Forward(x)) == x
+		void Inverse(const float* re, const float* im, float* output)
+		{
+			for (size_t k = 0; k < halfSize; k++)
+			{
+				const size_t mirror = halfSize - k;
+
+				const float evenRe = 0.5f * (re[k] + re[mirror]);
+				const float evenIm = 0.5f * (im[k] - im[mirror]);
+				const float diffRe = 0.5f * (re[k] - re[mirror]);
+				const float diffIm = 0.5f * (im[k] + im[mirror]);
+
+				// Odd spectrum is the difference times the conjugate twiddle
+				const float oddRe = (realTwiddleRe[k] * diffRe) + (realTwiddleIm[k] * diffIm);
+				const float oddIm = (realTwiddleRe[k] * diffIm) - (realTwiddleIm[k] * diffRe);
+
+				// Pack as even + i * odd, conjugated so the forward transform can be used for the inverse
+				workRe[bitReverse[k]] = evenRe - oddIm;
+				workIm[bitReverse[k]] = -(evenIm + oddRe);
+			}
+
+			Transform(workIm.data(), workRe.data());
+
+			const float scale = 1.0f / (float)halfSize;
+
+			for (size_t n = 0; n < halfSize; n++)
+			{
+				output[2 * n] = workRe[n] * scale;
+				output[(2 * n) + 1] = -workIm[n] * scale;
+			}
+		}
+
+	private:
+		// In-place iterative forward FFT of data already in bit-reversed order
+		void Transform(float* __restrict dataIm, float* __restrict dataRe)
+		{
+			for (size_t half = 1; half < halfSize; half *= 2)
+			{
+				const float* __restrict twiddleRe = &stageTwiddleRe[half - 1];
+				const float* __restrict twiddleIm = &stageTwiddleIm[half - 1];
+
+				for (size_t i = 0; i < halfSize; i += 2 * half)
+				{
+					float* __restrict aRe = dataRe + i;
+					float* __restrict aIm = dataIm + i;
+					float* __restrict bRe = dataRe + i + half;
+					float* __restrict bIm = dataIm + i + half;
+
+					for (size_t j = 0; j < half; j++)
+					{
+						const float vRe = (bRe[j] * twiddleRe[j]) - (bIm[j] * twiddleIm[j]);
+						const float vIm = (bRe[j] * twiddleIm[j]) + (bIm[j] * twiddleRe[j]);
+
+						bRe[j] = aRe[j] - vRe;
+						bIm[j] = aIm[j] - vIm;
+						aRe[j] += vRe;
+						aIm[j] += vIm;
+					}
+				}
+			}
+		}
+
+		size_t size = 0;
+		size_t halfSize = 0;
+		std::vector<size_t> bitReverse;
+		std::vector<float> stageTwiddleRe;
+		std::vector<float> stageTwiddleIm;
+		std::vector<float> realTwiddleRe;
+		std::vector<float> realTwiddleIm;
+		std::vector<float> workRe;
+		std::vector<float> workIm;
+	};
+}
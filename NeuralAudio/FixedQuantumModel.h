@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "NeuralModel.h"
+#include "NeuralModelImpl.h"
+
+namespace NeuralAudio
+{
+	// Buffers input internally so that the wrapped model is always run on a fixed, tile-aligned number of samples,
+	// regardless of the host block size. This adds a latency of one quantum.
+	class FixedQuantumModel : public NeuralModelImpl
+	{
+		public:
+			static constexpr size_t QuantumAlignment = 8;	// Largest multi-frame convolution tile size
+
+			static size_t AlignQuantum(size_t quantum)
+			{
+				return ((quantum + QuantumAlignment - 1) / QuantumAlignment) * QuantumAlignment;
+			}
+
+			FixedQuantumModel(NeuralModel* model, size_t quantum) :
+				model(model),
+				quantum(AlignQuantum(quantum))
+			{
+				inputFifo.resize(this->quantum);
+				outputFifo.resize(this->quantum);
+
+				model->SetMaxAudioBufferSize((int)this->quantum);
+
+				Reset();
+			}
+
+			~FixedQuantumModel()
+			{
+				if (model != nullptr)
+					delete model;
+			}
+
+			NeuralModel* GetModel()
+			{
+				return model;
+			}
+
+			size_t GetQuantum()
+			{
+				return quantum;
+			}
+
+			EModelLoadMode GetLoadMode() override
+			{
+				return model->GetLoadMode();
+			}
+
+			bool HasQualityScaling() override
+			{
+				return model->HasQualityScaling();
+			}
+
+			float GetQualityScaleFactor() override
+			{
+				return model->GetQualityScaleFactor();
+			}
+
+			bool IsQualityChangeRealtimeSafe(float newScaleFactor) override
+			{
+				return model->IsQualityChangeRealtimeSafe(newScaleFactor);
+			}
+
+			void SetQualityScaleFactor(float scaleFactor) override
+			{
+				model->SetQualityScaleFactor(scaleFactor);
+			}
+
+			bool IsStatic() override
+			{
+				return model->IsStatic();
+			}
+
+			void SetMaxAudioBufferSize(const int maxSize) override
+			{
+				(void)maxSize;	// The wrapped model always processes a single quantum
+			}
+
+			void SetAudioInputLevelDBu(float audioDBu) override
+			{
+				model->SetAudioInputLevelDBu(audioDBu);
+			}
+
+			float GetAudioInputLevelDBu() override
+			{
+				return model->GetAudioInputLevelDBu();
+			}
+
+			float GetRecommendedInputDBAdjustment() override
+			{
+				return model->GetRecommendedInputDBAdjustment();
+			}
+
+			float GetRecommendedOutputDBAdjustment() override
+			{
+				return model->GetRecommendedOutputDBAdjustment();
+			}
+
+			float GetSampleRate() override
+			{
+				return model->GetSampleRate();
+			}
+
+			int GetReceptiveFieldSize() override
+			{
+				return model->GetReceptiveFieldSize();
+			}
+
+			int GetLatencySamples() override
+			{
+				return (int)quantum + model->GetLatencySamples();
+			}
+
+			std::string GetModelVersion() override
+			{
+				return model->GetModelVersion();
+			}
+
+			std::string GetMetadata(const std::string& fieldName) override
+			{
+				return model->GetMetadata(fieldName);
+			}
+
+			void Process(float* input, float* output, size_t numSamples) override
+			{
+				while (numSamples > 0)
+				{
+					size_t toCopy = std::min(numSamples, quantum - fifoPos);
+
+					// Read the input before writing the output so that in-place processing works
+					std::memcpy(inputFifo.data() + fifoPos, input, toCopy * sizeof(float));
+					std::memcpy(output, outputFifo.data() + fifoPos, toCopy * sizeof(float));
+
+					fifoPos += toCopy;
+					input += toCopy;
+					output += toCopy;
+					numSamples -= toCopy;
+
+					if (fifoPos == quantum)
+					{
+						model->Process(inputFifo.data(), outputFifo.data(), quantum);
+
+						fifoPos = 0;
+					}
+				}
+			}
+
+			void Prewarm() override
+			{
+				model->Prewarm();
+
+				Reset();
+			}
+
+			// Batches don't need the fixed quantum, so they run the wrapped model directly
+			NeuralModelBatch* CreateBatch(size_t numInstances) override
+			{
+				return model->CreateBatch(numInstances);
+			}
+
+			// Clones wrap a clone of the model, and carry on from our buffered input and output
+			NeuralModel* Clone() override
+			{
+				NeuralModel* modelClone = model->Clone();
+
+				if (modelClone == nullptr)
+					return nullptr;
+
+				FixedQuantumModel* clone = clonePool.Take();
+
+				if (clone == nullptr)
+					clone = new FixedQuantumModel(quantum);
+
+				clone->model = modelClone;
+				clone->CopyState(*this);
+
+				return clone;
+			}
+
+			// Reserves clones of the wrapped model, and our wrappers for them
+			size_t ReserveClones(size_t numClones) override
+			{
+				const size_t numReserved = model->ReserveClones(numClones);
+
+				return clonePool.Reserve(numReserved, [this] { return new FixedQuantumModel(quantum); });
+			}
+
+			bool ReleaseClone(NeuralModel* clone) override
+			{
+				auto quantumClone = dynamic_cast<FixedQuantumModel*>(clone);
+
+				if ((quantumClone == nullptr) || (quantumClone == this) || (quantumClone->quantum != quantum) || !model->ReleaseClone(quantumClone->model))
+					return false;
+
+				quantumClone->model = nullptr;
+
+				if (!clonePool.Release(quantumClone))
+					delete quantumClone;
+
+				return true;
+			}
+
+		private:
+			// Wrapper without a model, for reserved clones
+			FixedQuantumModel(size_t alignedQuantum) :
+				quantum(alignedQuantum),
+				inputFifo(alignedQuantum),
+				outputFifo(alignedQuantum)
+			{
+			}
+
+			// Fifos are the same size, so this doesn't allocate
+			void CopyState(const FixedQuantumModel& other)
+			{
+				std::copy(other.inputFifo.begin(), other.inputFifo.end(), inputFifo.begin());
+				std::copy(other.outputFifo.begin(), other.outputFifo.end(), outputFifo.begin());
+
+				fifoPos = other.fifoPos;
+			}
+
+			void Reset()
+			{
+				std::fill(inputFifo.begin(), inputFifo.end(), 0.0f);
+				std::fill(outputFifo.begin(), outputFifo.end(), 0.0f);
+
+				fifoPos = 0;
+			}
+
+			NeuralModel* model = nullptr;
+			size_t quantum;
+			size_t fifoPos = 0;
+			std::vector<float> inputFifo;
+			std::vector<float> outputFifo;
+			ClonePool<FixedQuantumModel> clonePool;
+	};
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include "Activation.h"
+#include "TemplateHelper.h"
+
+#ifndef GRU_MAX_NUM_FRAMES
+#define GRU_MAX_NUM_FRAMES 64
+#endif
+
+// Largest hidden size that uses the small (register-resident) step kernel
+#ifndef GRU_SMALL_KERNEL_MAX_HIDDEN
+#define GRU_SMALL_KERNEL_MAX_HIDDEN 16
+#endif
+
+namespace NeuralAudio
+{
+	// Keras GRU (reset_after = true) weights. Gates are in z, r, h order.
+	struct GRULayerDef
+	{
+		std::vector<float> InputWeights;
+		std::vector<float> HiddenWeights;
+		std::vector<float> InputBias;
+		std::vector<float> HiddenBias;
+	};
+
+	struct GRUDef
+	{
+		std::vector<GRULayerDef> Layers;
+		std::vector<float> HeadWeights;
+		float HeadBias;
+	};
+
+	// Keras layout - numCols x (3 x hiddenSize) gates
+	inline std::vector<float> PadGRUGateMatrix(const std::vector<float>& weights, size_t numCols, size_t paddedNumCols, size_t hiddenSize, size_t paddedHiddenSize)
+	{
+		std::vector<float> padded(paddedNumCols * 3 * paddedHiddenSize, 0.0f);
+
+		for (size_t col = 0; col < numCols; col++)
+		{
+			for (size_t gate = 0; gate < 3; gate++)
+			{
+				for (size_t unit = 0; unit < hiddenSize; unit++)
+				{
+					padded[(col * 3 * paddedHiddenSize) + (gate * paddedHiddenSize) + unit] = weights[(col * 3 * hiddenSize) + (gate * hiddenSize) + unit];
+				}
+			}
+		}
+
+		return padded;
+	}
+
+	// Zero-pad GRU weights to a larger hidden size. Padded units start at zero and their candidate is always zero, so
+	// they stay at zero and the padded model produces exactly the same output.
+	inline GRUDef PadGRUDef(const GRUDef& def, size_t hiddenSize, size_t paddedHiddenSize)
+	{
+		GRUDef padded;
+
+		for (size_t layer = 0; layer < def.Layers.size(); layer++)
+		{
+			const GRULayerDef& layerDef = def.Layers[layer];
+			GRULayerDef paddedLayerDef;
+
+			const size_t inputSize = (layer == 0) ? 1 : hiddenSize;
+			const size_t paddedInputSize = (layer == 0) ? 1 : paddedHiddenSize;
+
+			paddedLayerDef.InputWeights = PadGRUGateMatrix(layerDef.InputWeights, inputSize, paddedInputSize, hiddenSize, paddedHiddenSize);
+			paddedLayerDef.HiddenWeights = PadGRUGateMatrix(layerDef.HiddenWeights, hiddenSize, paddedHiddenSize, hiddenSize, paddedHiddenSize);
+			paddedLayerDef.InputBias = PadGRUGateMatrix(layerDef.InputBias, 1, 1, hiddenSize, paddedHiddenSize);
+			paddedLayerDef.HiddenBias = PadGRUGateMatrix(layerDef.HiddenBias, 1, 1, hiddenSize, paddedHiddenSize);
+
+			padded.Layers.push_back(paddedLayerDef);
+		}
+
+		padded.HeadWeights = def.HeadWeights;
+		padded.HeadWeights.resize(paddedHiddenSize, 0.0f);
+		padded.HeadBias = def.HeadBias;
+
+		return padded;
+	}
+
+	// Approximate cost of running a GRU model, used to choose between model implementations
+	inline size_t GetGRUFLOPsPerSample(size_t numLayers, size_t hiddenSize)
+	{
+		size_t flops = 0;
+
+		for (size_t layer = 0; layer < numLayers; layer++)
+		{
+			const size_t inputSize = (layer == 0) ? 1 : hiddenSize;
+
+			flops += 2 * (3 * hiddenSize) * (inputSize + hiddenSize);
+		}
+
+		return flops + (2 * hiddenSize);
+	}
+
+	// Weights of a layer. Immutable once loaded, so they can be shared between model instances.
+	template<int InputSize, int HiddenSize>
+	struct GRULayerWeightsT
+	{
+		Eigen::Matrix<float, 3 * HiddenSize, InputSize> InputWeights;
+		Eigen::Matrix<float, 3 * HiddenSize, HiddenSize> HiddenWeights;
+		Eigen::Vector<float, 3 * HiddenSize> Bias;	// Input bias, plus the hidden bias for the z and r gates
+		Eigen::Vector<float, HiddenSize> HiddenBias;	// Hidden bias for the candidate, which is scaled by the reset gate
+
+		void SetWeights(GRULayerDef& def)
+		{
+			constexpr int hOffset = 2 * HiddenSize;
+
+			std::vector<float>::iterator it = def.InputWeights.begin();
+
+			for (int j = 0; j < InputSize; j++)
+				for (int i = 0; i < (3 * HiddenSize); i++)
+				{
+					InputWeights(i, j) = *(it++);
+				}
+
+			assert(std::distance(def.InputWeights.begin(), it) == (long)def.InputWeights.size());
+
+			it = def.HiddenWeights.begin();
+
+			for (int j = 0; j < HiddenSize; j++)
+				for (int i = 0; i < (3 * HiddenSize); i++)
+				{
+					HiddenWeights(i, j) = *(it++);
+				}
+
+			assert(std::distance(def.HiddenWeights.begin(), it) == (long)def.HiddenWeights.size());
+
+			for (int i = 0; i < (3 * HiddenSize); i++)
+				Bias[i] = def.InputBias[i] + ((i < hOffset) ? def.HiddenBias[i] : 0);
+
+			for (int i = 0; i < HiddenSize; i++)
+				HiddenBias[i] = def.HiddenBias[i + hOffset];
+		}
+	};
+
+	// Streaming state of a layer. The weights are referenced, not owned.
+	template<int InputSize, int HiddenSize>
+	class GRULayerT
+	{
+	public:
+		using Weights = GRULayerWeightsT<InputSize, HiddenSize>;
+
+	private:
+		const Weights* weights = nullptr;
+		Eigen::Vector<float, HiddenSize> hiddenState;
+		Eigen::Vector<float, 3 * HiddenSize> gates;
+		Eigen::Vector<float, HiddenSize> candidate;
+		Eigen::Matrix<float, 3 * HiddenSize, GRU_MAX_NUM_FRAMES> inputGates;	// Input projection (plus bias) for the whole block
+		Eigen::Matrix<float, HiddenSize, GRU_MAX_NUM_FRAMES> outputs;
+
+		constexpr static long zOffset = 0;
+		constexpr static long rOffset = HiddenSize;
+		constexpr static long hOffset = 2 * HiddenSize;
+
+	public:
+		const float* GetOutputs() const { return outputs.data(); }
+
+		// Weights must outlive the layer
+		void SetWeights(const Weights& layerWeights)
+		{
+			weights = &layerWeights;
+
+			hiddenState.setZero();
+		}
+
+		void CopyState(const GRULayerT& other)
+		{
+			hiddenState = other.hiddenState;
+		}
+
+		// Recurrent state, held locally by the caller for the duration of a block
+		struct StepState
+		{
+			alignas(32) float Hidden[HiddenSize];
+		};
+
+		inline void LoadState(StepState& state) const
+		{
+			for (int i = 0; i < HiddenSize; i++)
+				state.Hidden[i] = hiddenState[i];
+		}
+
+		inline void StoreState(const StepState& state)
+		{
+			for (int i = 0; i < HiddenSize; i++)
+				hiddenState[i] = state.Hidden[i];
+		}
+
+		// Input is InputSize x numFrames (column major), numFrames <= GRU_MAX_NUM_FRAMES
+		inline void Process(const float* input, const size_t numFrames)
+		{
+			ProjectInputs(input, numFrames);
+
+			StepState state;
+
+			LoadState(state);
+
+			for (size_t frame = 0; frame < numFrames; frame++)
+				Step(frame, state);
+
+			StoreState(state);
+		}
+
+		// The input doesn't depend on the recurrent state, so project the whole block at once
+		inline void ProjectInputs(const float* input, const size_t numFrames)
+		{
+			auto inputMap = Eigen::Map<const Eigen::Matrix<float, InputSize, Eigen::Dynamic>>(input, InputSize, numFrames);
+
+			inputGates.leftCols(numFrames).noalias() = weights->InputWeights * inputMap;
+			inputGates.leftCols(numFrames).colwise() += weights->Bias;
+		}
+
+		inline void ProjectInput(const float* input, const size_t frame)
+		{
+			inputGates.col(frame).noalias() = weights->InputWeights * Eigen::Map<const Eigen::Vector<float, InputSize>>(input);
+			inputGates.col(frame) += weights->Bias;
+		}
+
+		// Run the recurrent update for a frame whose input has already been projected
+		inline void Step(const size_t frame, StepState& state)
+		{
+			const float* in = inputGates.data() + (frame * 3 * HiddenSize);
+
+			if constexpr (HiddenSize <= GRU_SMALL_KERNEL_MAX_HIDDEN)
+			{
+				// Small layers - fully unrolled fixed-size loops over local arrays so that the state and gates
+				// stay in registers from frame to frame instead of round-tripping through the layer members
+				alignas(32) float g[3 * HiddenSize];
+				alignas(32) float c[HiddenSize];
+
+				const float* w = weights->HiddenWeights.data();
+				const float* hiddenBias = weights->HiddenBias.data();
+
+				for (int row = 0; row < hOffset; row++)
+					g[row] = in[row];
+
+				for (int i = 0; i < HiddenSize; i++)
+					g[i + hOffset] = hiddenBias[i];
+
+				for (int col = 0; col < HiddenSize; col++)
+				{
+					const float h = state.Hidden[col];
+
+					for (int row = 0; row < (3 * HiddenSize); row++)
+						g[row] += w[(col * 3 * HiddenSize) + row] * h;
+				}
+
+				LSTM_MATH<float>::Sigmoid(g, 2 * HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
+					c[i] = in[i + hOffset] + (g[i + rOffset] * g[i + hOffset]);
+
+				LSTM_MATH<float>::Tanh(c, HiddenSize);
+
+				float* out = outputs.data() + (frame * HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
+				{
+					state.Hidden[i] = c[i] + (g[i + zOffset] * (state.Hidden[i] - c[i]));
+					out[i] = state.Hidden[i];
+				}
+			}
+			else
+			{
+				auto hidden = Eigen::Map<Eigen::Vector<float, HiddenSize>>(state.Hidden);
+
+				gates.noalias() = weights->HiddenWeights * hidden;
+				gates.template head<2 * HiddenSize>() += inputGates.col(frame).template head<2 * HiddenSize>();
+				gates.template tail<HiddenSize>() += weights->HiddenBias;
+
+				LSTM_MATH<float>::Sigmoid(gates.data(), 2 * HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
+					candidate[i] = in[i + hOffset] + (gates[i + rOffset] * gates[i + hOffset]);
+
+				LSTM_MATH<float>::Tanh(candidate.data(), HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
+					hidden[i] = candidate[i] + (gates[i + zOffset] * (hidden[i] - candidate[i]));
+
+				outputs.col(frame) = hidden;
+			}
+		}
+	};
+
+	template<int NumLayers, int HiddenSize>
+	struct GRUModelWeightsT
+	{
+		GRULayerWeightsT<1, HiddenSize> FirstLayer;
+		std::array<GRULayerWeightsT<HiddenSize, HiddenSize>, NumLayers - 1> RemainingLayers;
+		Eigen::Vector<float, HiddenSize> HeadWeights;
+		float HeadBias;
+
+		void SetWeights(GRUDef& def)
+		{
+			for (int i = 0; i < HiddenSize; i++)
+				HeadWeights[i] = def.HeadWeights[i];
+
+			HeadBias = def.HeadBias;
+
+			FirstLayer.SetWeights(def.Layers[0]);
+
+			for (size_t layer = 0; layer < RemainingLayers.size(); layer++)
+				RemainingLayers[layer].SetWeights(def.Layers[layer + 1]);
+		}
+	};
+
+	template<int NumLayers, int HiddenSize>
+	class GRUModelT
+	{
+	public:
+		using Weights = GRUModelWeightsT<NumLayers, HiddenSize>;
+
+	private:
+		std::shared_ptr<const Weights> weights;
+		GRULayerT<1, HiddenSize> firstLayer;
+		std::vector<GRULayerT<HiddenSize, HiddenSize>> remainingLayers;
+
+	public:
+		GRUModelT()
+		{
+			if constexpr (NumLayers > 1)
+			{
+				remainingLayers.resize(NumLayers - 1);
+			}
+		}
+
+		GRUModelT(std::shared_ptr<const Weights> sharedWeights) :
+			GRUModelT()
+		{
+			SetSharedWeights(std::move(sharedWeights));
+		}
+
+		const std::shared_ptr<const Weights>& GetSharedWeights() const { return weights; }
+
+		// New instance that shares our weights
+		GRUModelT* CreateSharedInstance() const
+		{
+			return new GRUModelT(weights);
+		}
+
+		// Use weights that may be shared with other instances. Resets the state.
+		void SetSharedWeights(std::shared_ptr<const Weights> sharedWeights)
+		{
+			weights = std::move(sharedWeights);
+
+			firstLayer.SetWeights(weights->FirstLayer);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+				{
+					remainingLayers[layerIndex].SetWeights(weights->RemainingLayers[layerIndex]);
+				});
+		}
+
+		void SetWeights(GRUDef& def)
+		{
+			auto newWeights = std::make_shared<Weights>();
+
+			newWeights->SetWeights(def);
+
+			SetSharedWeights(std::move(newWeights));
+		}
+
+		void CopyState(const GRUModelT& other)
+		{
+			firstLayer.CopyState(other.firstLayer);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+				{
+					remainingLayers[layerIndex].CopyState(other.remainingLayers[layerIndex]);
+				});
+		}
+
+		void Process(const float* input, float* output, size_t numSamples)
+		{
+			while (numSamples > 0)
+			{
+				size_t numFrames = std::min(numSamples, (size_t)GRU_MAX_NUM_FRAMES);
+
+				ProcessBlock(input, output, numFrames);
+
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		void ProcessBlock(const float* input, float* output, const size_t numFrames)
+		{
+			firstLayer.ProjectInputs(input, numFrames);
+
+			// Keep the recurrent state local for the whole block
+			typename GRULayerT<1, HiddenSize>::StepState firstState;
+			std::array<typename GRULayerT<HiddenSize, HiddenSize>::StepState, NumLayers - 1> remainingStates;
+
+			firstLayer.LoadState(firstState);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+				{
+					remainingLayers[layerIndex].LoadState(remainingStates[layerIndex]);
+				});
+
+			if constexpr (NumLayers == 1)
+			{
+				for (size_t frame = 0; frame < numFrames; frame++)
+					firstLayer.Step(frame, firstState);
+			}
+			else
+			{
+				// Wavefront schedule - layer N works on frame (t - N), so the layer updates within an iteration
+				// are independent of each other and their dependency chains can overlap
+				for (size_t t = 0; t < (numFrames + NumLayers - 1); t++)
+				{
+					if (t < numFrames)
+						firstLayer.Step(t, firstState);
+
+					ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+						{
+							if ((t > layerIndex) && ((t - layerIndex - 1) < numFrames))
+							{
+								const size_t frame = t - layerIndex - 1;
+
+								if constexpr (layerIndex == 0)
+								{
+									remainingLayers[layerIndex].ProjectInput(firstLayer.GetOutputs() + (frame * HiddenSize), frame);
+								}
+								else
+								{
+									remainingLayers[layerIndex].ProjectInput(remainingLayers[layerIndex - 1].GetOutputs() + (frame * HiddenSize), frame);
+								}
+
+								remainingLayers[layerIndex].Step(frame, remainingStates[layerIndex]);
+							}
+						});
+				}
+			}
+
+			firstLayer.StoreState(firstState);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+				{
+					remainingLayers[layerIndex].StoreState(remainingStates[layerIndex]);
+				});
+
+			const float* layerOutputs = firstLayer.GetOutputs();
+
+			if constexpr (NumLayers > 1)
+				layerOutputs = remainingLayers[NumLayers - 2].GetOutputs();
+
+			auto outputMap = Eigen::Map<Eigen::Matrix<float, 1, Eigen::Dynamic>>(output, 1, numFrames);
+
+			outputMap.noalias() = weights->HeadWeights.transpose() * Eigen::Map<const Eigen::Matrix<float, HiddenSize, Eigen::Dynamic>>(layerOutputs, HiddenSize, numFrames);
+			outputMap.array() += weights->HeadBias;
+		}
+	};
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <Eigen/Dense>
+#include "Activation.h"
+#include "GRU.h"
+
+// Hidden sizes up to this are rounded up to a multiple of GRU_BUCKET_HIDDEN_STEP and run with fixed-size kernels
+#ifndef GRU_BUCKET_MAX_HIDDEN
+#define GRU_BUCKET_MAX_HIDDEN 32
+#endif
+
+#ifndef GRU_BUCKET_HIDDEN_STEP
+#define GRU_BUCKET_HIDDEN_STEP 4
+#endif
+
+namespace NeuralAudio
+{
+	class GRULayerBase
+	{
+	public:
+		virtual ~GRULayerBase()
+		{
+		}
+
+		virtual const float* GetOutputs() const = 0;
+		virtual void CopyState(const GRULayerBase& other) = 0;
+		virtual void Process(const float* input, const size_t numFrames) = 0;
+	};
+
+	// Layer weights, shareable between model instances. Each instance creates its own layer state from them.
+	class GRULayerWeightsBase
+	{
+	public:
+		virtual ~GRULayerWeightsBase()
+		{
+		}
+
+		virtual void SetWeights(GRULayerDef& def) = 0;
+		virtual std::unique_ptr<GRULayerBase> CreateLayer() const = 0;
+	};
+
+	// Fixed-size layer used for bucketed hidden sizes
+	template<int InputSize, int HiddenSize>
+	class GRUBucketLayerT : public GRULayerBase
+	{
+	private:
+		GRULayerT<InputSize, HiddenSize> layer;
+
+	public:
+		GRUBucketLayerT(const GRULayerWeightsT<InputSize, HiddenSize>& weights)
+		{
+			layer.SetWeights(weights);
+		}
+
+		const float* GetOutputs() const override { return layer.GetOutputs(); }
+
+		void CopyState(const GRULayerBase& other) override
+		{
+			layer.CopyState(static_cast<const GRUBucketLayerT&>(other).layer);
+		}
+
+		void Process(const float* input, const size_t numFrames) override
+		{
+			layer.Process(input, numFrames);
+		}
+	};
+
+	template<int InputSize, int HiddenSize>
+	class GRUBucketLayerWeightsT : public GRULayerWeightsBase
+	{
+	private:
+		GRULayerWeightsT<InputSize, HiddenSize> weights;
+
+	public:
+		void SetWeights(GRULayerDef& def) override
+		{
+			weights.SetWeights(def);
+		}
+
+		std::unique_ptr<GRULayerBase> CreateLayer() const override
+		{
+			return std::make_unique<GRUBucketLayerT<InputSize, HiddenSize>>(weights);
+		}
+	};
+
+	class GRULayerWeights : public GRULayerWeightsBase
+	{
+	public:
+		size_t InputSize;
+		size_t HiddenSize;
+		Eigen::MatrixXf InputWeights;
+		Eigen::MatrixXf HiddenWeights;
+		Eigen::VectorXf Bias;	// Input bias, plus the hidden bias for the z and r gates
+		Eigen::VectorXf HiddenBias;	// Hidden bias for the candidate, which is scaled by the reset gate
+
+		GRULayerWeights(size_t inputSize, size_t hiddenSize) :
+			InputSize(inputSize),
+			HiddenSize(hiddenSize),
+			InputWeights(3 * hiddenSize, inputSize),
+			HiddenWeights(3 * hiddenSize, hiddenSize),
+			Bias(3 * hiddenSize),
+			HiddenBias(hiddenSize)
+		{
+		}
+
+		void SetWeights(GRULayerDef& def) override
+		{
+			const size_t gateSize = 3 * HiddenSize;
+			const size_t hOffset = 2 * HiddenSize;
+
+			std::vector<float>::iterator it = def.InputWeights.begin();
+
+			for (size_t j = 0; j < InputSize; j++)
+				for (size_t i = 0; i < gateSize; i++)
+				{
+					InputWeights(i, j) = *(it++);
+				}
+
+			assert(std::distance(def.InputWeights.begin(), it) == (long)def.InputWeights.size());
+
+			it = def.HiddenWeights.begin();
+
+			for (size_t j = 0; j < HiddenSize; j++)
+				for (size_t i = 0; i < gateSize; i++)
+				{
+					HiddenWeights(i, j) = *(it++);
+				}
+
+			assert(std::distance(def.HiddenWeights.begin(), it) == (long)def.HiddenWeights.size());
+
+			for (size_t i = 0; i < gateSize; i++)
+				Bias[i] = def.InputBias[i] + ((i < hOffset) ? def.HiddenBias[i] : 0);
+
+			for (size_t i = 0; i < HiddenSize; i++)
+				HiddenBias[i] = def.HiddenBias[i + hOffset];
+		}
+
+		std::unique_ptr<GRULayerBase> CreateLayer() const override;
+	};
+
+	class GRULayer : public GRULayerBase
+	{
+	private:
+		const GRULayerWeights& weights;
+		size_t hiddenSize;
+		Eigen::VectorXf hiddenState;
+		Eigen::VectorXf gates;
+		Eigen::VectorXf candidate;
+		Eigen::MatrixXf inputGates;	// Input projection (plus bias) for the whole block
+		Eigen::MatrixXf outputs;
+
+		size_t zOffset;
+		size_t rOffset;
+		size_t hOffset;
+
+	public:
+		GRULayer(const GRULayerWeights& weights) :
+			weights(weights),
+			hiddenSize(weights.HiddenSize),
+			hiddenState(Eigen::VectorXf::Zero(hiddenSize)),
+			gates(3 * hiddenSize),
+			candidate(hiddenSize),
+			inputGates(3 * hiddenSize, GRU_MAX_NUM_FRAMES),
+			outputs(hiddenSize, GRU_MAX_NUM_FRAMES),
+			zOffset(0),
+			rOffset(hiddenSize),
+			hOffset(2 * hiddenSize)
+		{
+		}
+
+		const float* GetOutputs() const override { return outputs.data(); }
+
+		void CopyState(const GRULayerBase& other) override
+		{
+			hiddenState = static_cast<const GRULayer&>(other).hiddenState;
+		}
+
+		// Input is inputSize x numFrames (column major), numFrames <= GRU_MAX_NUM_FRAMES
+		void Process(const float* input, const size_t numFrames) override
+		{
+			auto inputMap = Eigen::Map<const Eigen::MatrixXf>(input, weights.InputSize, numFrames);
+
+			// The input doesn't depend on the recurrent state, so project the whole block at once
+			inputGates.leftCols(numFrames).noalias() = weights.InputWeights * inputMap;
+			inputGates.leftCols(numFrames).colwise() += weights.Bias;
+
+			for (size_t frame = 0; frame < numFrames; frame++)
+			{
+				gates.noalias() = weights.HiddenWeights * hiddenState;
+				gates.head(hOffset) += inputGates.col(frame).head(hOffset);
+				gates.tail(hiddenSize) += weights.HiddenBias;
+
+				LSTM_MATH<float>::Sigmoid(gates.data(), 2 * hiddenSize);
+
+				for (size_t i = 0; i < hiddenSize; i++)
+					candidate[i] = inputGates(i + hOffset, frame) + (gates[i + rOffset] * gates[i + hOffset]);
+
+				LSTM_MATH<float>::Tanh(candidate.data(), hiddenSize);
+
+				for (size_t i = 0; i < hiddenSize; i++)
+					hiddenState[i] = candidate[i] + (gates[i + zOffset] * (hiddenState[i] - candidate[i]));
+
+				outputs.col(frame) = hiddenState;
+			}
+		}
+	};
+
+	inline std::unique_ptr<GRULayerBase> GRULayerWeights::CreateLayer() const
+	{
+		return std::make_unique<GRULayer>(*this);
+	}
+
+	struct GRUModelWeights
+	{
+		std::vector<std::unique_ptr<GRULayerWeightsBase>> Layers;
+		Eigen::VectorXf HeadWeights;
+		float HeadBias;
+	};
+
+	class GRUModel
+	{
+	private:
+		size_t numLayers;
+		size_t modelHiddenSize;
+		size_t hiddenSize;	// Hidden size we run at - larger than the model's if it has been padded to a bucket size
+		std::shared_ptr<const GRUModelWeights> weights;
+		std::vector<std::unique_ptr<GRULayerBase>> layers;
+
+	public:
+		static size_t GetBucketHiddenSize(size_t hiddenSize)
+		{
+			if (hiddenSize > GRU_BUCKET_MAX_HIDDEN)
+				return hiddenSize;
+
+			return ((hiddenSize + GRU_BUCKET_HIDDEN_STEP - 1) / GRU_BUCKET_HIDDEN_STEP) * GRU_BUCKET_HIDDEN_STEP;
+		}
+
+		GRUModel(size_t numLayers, size_t hiddenSize) :
+			numLayers(numLayers),
+			modelHiddenSize(hiddenSize),
+			hiddenSize(GetBucketHiddenSize(hiddenSize))
+		{
+		}
+
+		GRUModel(size_t numLayers, size_t hiddenSize, std::shared_ptr<const GRUModelWeights> sharedWeights) :
+			GRUModel(numLayers, hiddenSize)
+		{
+			SetSharedWeights(std::move(sharedWeights));
+		}
+
+		const std::shared_ptr<const GRUModelWeights>& GetSharedWeights() const { return weights; }
+
+		// New instance that shares our weights
+		GRUModel* CreateSharedInstance() const
+		{
+			return new GRUModel(numLayers, modelHiddenSize, weights);
+		}
+
+		// Use weights that may be shared with other instances. Resets the state.
+		void SetSharedWeights(std::shared_ptr<const GRUModelWeights> sharedWeights)
+		{
+			weights = std::move(sharedWeights);
+
+			layers.clear();
+
+			for (auto& layerWeights : weights->Layers)
+			{
+				layers.push_back(layerWeights->CreateLayer());
+			}
+		}
+
+		void SetWeights(GRUDef& def)
+		{
+			if (hiddenSize != modelHiddenSize)
+			{
+				GRUDef paddedDef = PadGRUDef(def, modelHiddenSize, hiddenSize);
+
+				SetLayerWeights(paddedDef);
+			}
+			else
+			{
+				SetLayerWeights(def);
+			}
+		}
+
+		void CopyState(const GRUModel& other)
+		{
+			for (size_t i = 0; i < numLayers; i++)
+			{
+				layers[i]->CopyState(*other.layers[i]);
+			}
+		}
+
+		void Process(const float* input, float* output, size_t numSamples)
+		{
+			while (numSamples > 0)
+			{
+				size_t numFrames = std::min(numSamples, (size_t)GRU_MAX_NUM_FRAMES);
+
+				ProcessBlock(input, output, numFrames);
+
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		template<int BucketSize = GRU_BUCKET_HIDDEN_STEP>
+		static GRULayerWeightsBase* CreateBucketLayerWeights(size_t inputSize, size_t hiddenSize)
+		{
+			if constexpr (BucketSize > GRU_BUCKET_MAX_HIDDEN)
+			{
+				return nullptr;
+			}
+			else
+			{
+				if (hiddenSize != BucketSize)
+					return CreateBucketLayerWeights<BucketSize + GRU_BUCKET_HIDDEN_STEP>(inputSize, hiddenSize);
+
+				if (inputSize == 1)
+					return new GRUBucketLayerWeightsT<1, BucketSize>;
+
+				return new GRUBucketLayerWeightsT<BucketSize, BucketSize>;
+			}
+		}
+
+		static std::unique_ptr<GRULayerWeightsBase> CreateLayerWeights(size_t inputSize, size_t hiddenSize)
+		{
+			GRULayerWeightsBase* layerWeights = CreateBucketLayerWeights(inputSize, hiddenSize);
+
+			if (layerWeights == nullptr)
+				layerWeights = new GRULayerWeights(inputSize, hiddenSize);
+
+			return std::unique_ptr<GRULayerWeightsBase>(layerWeights);
+		}
+
+		void SetLayerWeights(GRUDef& def)
+		{
+			auto newWeights = std::make_shared<GRUModelWeights>();
+
+			newWeights->Layers.push_back(CreateLayerWeights(1, hiddenSize));
+
+			for (size_t i = 0; i < numLayers - 1; i++)
+			{
+				newWeights->Layers.push_back(CreateLayerWeights(hiddenSize, hiddenSize));
+			}
+
+			newWeights->HeadWeights.resize(hiddenSize);
+
+			for (size_t i = 0; i < hiddenSize; i++)
+				newWeights->HeadWeights[i] = def.HeadWeights[i];
+
+			newWeights->HeadBias = def.HeadBias;
+
+			for (size_t i = 0; i < numLayers; i++)
+			{
+				newWeights->Layers[i]->SetWeights(def.Layers[i]);
+			}
+
+			SetSharedWeights(std::move(newWeights));
+		}
+
+		void ProcessBlock(const float* input, float* output, const size_t numFrames)
+		{
+			layers[0]->Process(input, numFrames);
+
+			for (size_t layer = 1; layer < numLayers; layer++)
+			{
+				layers[layer]->Process(layers[layer - 1]->GetOutputs(), numFrames);
+			}
+
+			auto outputMap = Eigen::Map<Eigen::RowVectorXf>(output, numFrames);
+
+			outputMap.noalias() = weights->HeadWeights.transpose() * Eigen::Map<const Eigen::MatrixXf>(layers[numLayers - 1]->GetOutputs(), hiddenSize, numFrames);
+			outputMap.array() += weights->HeadBias;
+		}
+	};
+}
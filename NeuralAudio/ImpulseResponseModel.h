@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "NeuralModel.h"
+#include "NeuralModelImpl.h"
+#include "Convolution.h"
+
+namespace NeuralAudio
+{
+	// Reads a PCM (8, 16, 24 or 32 bit) or floating point (32 or 64 bit) WAV file. Multi-channel files are mixed to mono.
+	inline bool ReadWavFile(const std::filesystem::path& wavPath, std::vector<float>& samples, float& sampleRate)
+	{
+		std::ifstream stream(wavPath, std::ifstream::binary);
+
+		if (!stream)
+			return false;
+
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		auto readUInt = [&](size_t pos, size_t numBytes)
+		{
+			uint32_t value = 0;
+
+			for (size_t i = 0; i < numBytes; i++)
+				value |= (uint32_t)data[pos + i] << (8 * i);
+
+			return value;
+		};
+
+		if ((data.size() < 12) || (std::memcmp(data.data(), "RIFF", 4) != 0) || (std::memcmp(data.data() + 8, "WAVE", 4) != 0))
+			return false;
+
+		uint32_t format = 0;
+		size_t numChannels = 0;
+		size_t bitsPerSample = 0;
+		size_t dataPos = 0;
+		size_t dataSize = 0;
+
+		size_t pos = 12;
+
+		while ((pos + 8) <= data.size())
+		{
+			const size_t chunkSize = readUInt(pos + 4, 4);
+			const size_t chunkStart = pos + 8;
+
+			if (std::memcmp(data.data() + pos, "fmt ", 4) == 0)
+			{
+				if ((chunkSize < 16) || ((chunkStart + chunkSize) > data.size()))
+					return false;
+
+				format = readUInt(chunkStart, 2);
+				numChannels = readUInt(chunkStart + 2, 2);
+				sampleRate = (float)readUInt(chunkStart + 4, 4);
+				bitsPerSample = readUInt(chunkStart + 14, 2);
+
+				if ((format == 0xFFFE) && (chunkSize >= 26))	// WAVE_FORMAT_EXTENSIBLE - the real format starts the sub-format GUID
+					format = readUInt(chunkStart + 24, 2);
+			}
+			else if (std::memcmp(data.data() + pos, "data", 4) == 0)
+			{
+				dataPos = chunkStart;
+				dataSize = std::min(chunkSize, data.size() - chunkStart);
+			}
+
+			pos = chunkStart + chunkSize + (chunkSize & 1);	// Chunks are padded to an even size
+		}
+
+		const bool isPCM = (format == 1) && (bitsPerSample >= 8) && (bitsPerSample <= 32) && ((bitsPerSample % 8) == 0);
+		const bool isFloat = (format == 3) && ((bitsPerSample == 32) || (bitsPerSample == 64));
+
+		if ((!isPCM && !isFloat) || (numChannels == 0) || (dataPos == 0))
+			return false;
+
+		const size_t bytesPerSample = bitsPerSample / 8;
+		const size_t numFrames = dataSize / (bytesPerSample * numChannels);
+
+		samples.resize(numFrames);
+
+		for (size_t frame = 0; frame < numFrames; frame++)
+		{
+			double sum = 0;
+
+			for (size_t channel = 0; channel < numChannels; channel++)
+			{
+				const size_t samplePos = dataPos + (((frame * numChannels) + channel) * bytesPerSample);
+
+				if (isFloat)
+				{
+					if (bytesPerSample == 4)
+					{
+						uint32_t bits = readUInt(samplePos, 4);
+						float value;
+						std::memcpy(&value, &bits, 4);
+
+						sum += value;
+					}
+					else
+					{
+						uint64_t bits = readUInt(samplePos, 4) | ((uint64_t)readUInt(samplePos + 4, 4) << 32);
+						double value;
+						std::memcpy(&value, &bits, 8);
+
+						sum += value;
+					}
+				}
+				else if (bytesPerSample == 1)
+				{
+					sum += ((double)data[samplePos] - 128) / 128;	// 8 bit is unsigned
+				}
+				else
+				{
+					// Shift up to the top of a 32 bit int to sign extend
+					const int32_t value = (int32_t)(readUInt(samplePos, bytesPerSample) << (32 - bitsPerSample));
+
+					sum += (double)value / 2147483648.0;
+				}
+			}
+
+			samples[frame] = (float)(sum / numChannels);
+		}
+
+		return true;
+	}
+
+	// Resamples an impulse response using windowed sinc interpolation, low-pass filtering at the lower of the two Nyquist frequencies.
+	// The overall gain of the response is preserved.
+	inline std::vector<float> ResampleImpulseResponse(const std::vector<float>& samples, float fromRate, float toRate)
+	{
+		if ((fromRate <= 0) || (toRate <= 0) || (fromRate == toRate) || samples.empty())
+			return samples;
+
+		constexpr double pi = 3.14159265358979323846;
+		constexpr double numZeroCrossings = 16;
+
+		const double ratio = (double)toRate / (double)fromRate;
+		const double cutoff = std::min(1.0, ratio);
+		const double halfWidth = numZeroCrossings / cutoff;	// In input samples
+
+		const size_t numOutput = (size_t)std::ceil(samples.size() * ratio);
+		const long lastInput = (long)samples.size() - 1;
+
+		std::vector<float> output(numOutput);
+
+		for (size_t outPos = 0; outPos < numOutput; outPos++)
+		{
+			const double center = outPos / ratio;
+
+			const long start = std::max(0L, (long)std::ceil(center - halfWidth));
+			const long end = std::min(lastInput, (long)std::floor(center + halfWidth));
+
+			double sum = 0;
+
+			for (long inPos = start; inPos <= end; inPos++)
+			{
+				const double offset = inPos - center;
+				const double x = cutoff * offset;
+				const double sinc = (x == 0) ? 1 : (std::sin(pi * x) / (pi * x));
+				const double window = 0.42 + (0.5 * std::cos(pi * offset / halfWidth)) + (0.08 * std::cos(2 * pi * offset / halfWidth));	// Blackman
+
+				sum += samples[inPos] * cutoff * sinc * window;
+			}
+
+			output[outPos] = (float)(sum / ratio);
+		}
+
+		return output;
+	}
+
+	// Runs an impulse response (ie: a cabinet IR) after a model, using zero latency convolution in place on the model output
+	class ImpulseResponseChainModel : public NeuralModelImpl
+	{
+		public:
+			ImpulseResponseChainModel(NeuralModel* model, const float* impulseResponse, size_t length) :
+				model(model)
+			{
+				convolution.SetImpulseResponse(impulseResponse, length);
+			}
+
+			~ImpulseResponseChainModel()
+			{
+				delete model;
+			}
+
+			NeuralModel* GetModel()
+			{
+				return model;
+			}
+
+			size_t GetImpulseResponseLength()
+			{
+				return convolution.GetLength();
+			}
+
+			EModelLoadMode GetLoadMode() override
+			{
+				return model->GetLoadMode();
+			}
+
+			bool HasQualityScaling() override
+			{
+				return model->HasQualityScaling();
+			}
+
+			float GetQualityScaleFactor() override
+			{
+				return model->GetQualityScaleFactor();
+			}
+
+			bool IsQualityChangeRealtimeSafe(float newScaleFactor) override
+			{
+				return model->IsQualityChangeRealtimeSafe(newScaleFactor);
+			}
+
+			void SetQualityScaleFactor(float scaleFactor) override
+			{
+				model->SetQualityScaleFactor(scaleFactor);
+			}
+
+			bool IsStatic() override
+			{
+				return model->IsStatic();
+			}
+
+			void SetMaxAudioBufferSize(const int maxSize) override
+			{
+				model->SetMaxAudioBufferSize(maxSize);
+			}
+
+			void SetAudioInputLevelDBu(float audioDBu) override
+			{
+				model->SetAudioInputLevelDBu(audioDBu);
+			}
+
+			float GetAudioInputLevelDBu() override
+			{
+				return model->GetAudioInputLevelDBu();
+			}
+
+			float GetRecommendedInputDBAdjustment() override
+			{
+				return model->GetRecommendedInputDBAdjustment();
+			}
+
+			float GetRecommendedOutputDBAdjustment() override
+			{
+				return model->GetRecommendedOutputDBAdjustment();
+			}
+
+			float GetSampleRate() override
+			{
+				return model->GetSampleRate();
+			}
+
+			int GetReceptiveFieldSize() override
+			{
+				return model->GetReceptiveFieldSize();
+			}
+
+			int GetLatencySamples() override
+			{
+				return model->GetLatencySamples();
+			}
+
+			std::string GetModelVersion() override
+			{
+				return model->GetModelVersion();
+			}
+
+			std::string GetMetadata(const std::string& fieldName) override
+			{
+				return model->GetMetadata(fieldName);
+			}
+
+			void Process(float* input, float* output, size_t numSamples) override
+			{
+				model->Process(input, output, numSamples);
+
+				convolution.Process(output, output, numSamples);
+			}
+
+			void Prewarm() override
+			{
+				model->Prewarm();
+
+				// Fill the convolution history with the model's steady state output for silence
+				std::vector<float> input(64, 0.0f);
+				std::vector<float> output(64);
+
+				model->Process(input.data(), output.data(), 1);
+
+				std::fill(input.begin(), input.end(), output[0]);
+
+				convolution.Reset();
+
+				for (size_t pos = 0; pos < convolution.GetLength(); pos += input.size())
+				{
+					convolution.Process(input.data(), output.data(), input.size());
+				}
+			}
+
+		private:
+			NeuralModel* model = nullptr;
+			PartitionedConvolution convolution;
+	};
+}
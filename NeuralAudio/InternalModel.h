@@ -2,10 +2,19 @@
 
 #include "NeuralModel.h"
 #include "NeuralModelImpl.h"
+#include "ModelWeights.h"
 #include "WaveNet.h"
 #include "WaveNetDynamic.h"
+#include "ConvNet.h"
+#include "ConvNetDynamic.h"
+#include "Convolution.h"
 #include "LSTM.h"
+#include "LSTMBatch.h"
 #include "LSTMDynamic.h"
+#include "GRU.h"
+#include "GRUDynamic.h"
+#include "KerasModel.h"
+#include "KerasModelDynamic.h"
 
 namespace NeuralAudio
 {
@@ -16,51 +25,1361 @@ namespace NeuralAudio
 	using ILiteDilations2 = NeuralAudio::Dilations<128, 256, 512, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512>;
 	using ILiteKernelSizes2 = NeuralAudio::KernelSizes<3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3>;
 
+	using IConvNetDilations = NeuralAudio::Dilations<1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048>;
+
 	using A2KernelSizes = NeuralAudio::KernelSizes<6, 6, 6, 6, 6, 6, 6, 6,	6, 6, 6, 6,	6, 6, 15, 15, 6, 6,	6, 6, 6, 6,	6>;
 	using A2Dilations = NeuralAudio::Dilations<1, 3, 7, 17, 41, 101, 239, 1, 3, 7, 17, 41, 101, 239, 1, 13, 1, 3, 7, 17, 41, 101, 239>;
 
-	class InternalModel : public NeuralModelImpl
+	// Approximate cost of running a two layer array A1 WaveNet (every weight is a multiply-add per sample)
+	inline size_t GetA1WaveNetFLOPsPerSample(size_t numChannels, size_t headSize, size_t numLayers1, size_t numLayers2, size_t kernelSize = 3)
+	{
+		auto arrayWeights = [kernelSize](size_t inputSize, size_t channels, size_t arrayHeadSize, size_t numLayers, bool headBias)
+		{
+			size_t layerWeights = (channels * channels * kernelSize) + channels + channels + (channels * channels) + channels;
+
+			return (inputSize * channels) + (numLayers * layerWeights) + (arrayHeadSize * channels) + (headBias ? arrayHeadSize : 0);
+		};
+
+		return 2 * (arrayWeights(1, numChannels, headSize, numLayers1, false) + arrayWeights(numChannels, headSize, 1, numLayers2, true));
+	}
+
+	// Zero-pad the weights of a two layer array A1 WaveNet to larger channel and head sizes. The padded channels have zero
+	// weights and bias, so they stay at zero through the layers and don't change the output.
+	inline std::vector<float> PadA1WaveNetNAMWeights(const nlohmann::json& modelJson, const ModelWeightsPtr& modelWeights, size_t paddedChannels, size_t paddedHeadSize)
+	{
+		const auto& layersConfig = modelJson.at("config").at("layers");
+
+		std::vector<float> unpackedWeights;
+		const std::span<const float> weights = GetNAMWeights(modelJson.at("weights"), modelWeights, unpackedWeights);
+
+		std::vector<float> padded;
+		auto it = weights.begin();
+
+		// Weights are stored [out][in][kernel], followed by the bias
+		auto padWeights = [&](size_t outSize, size_t inSize, size_t kernelSize, size_t paddedOutSize, size_t paddedInSize, bool hasBias)
+		{
+			for (size_t i = 0; i < paddedOutSize; i++)
+				for (size_t j = 0; j < paddedInSize; j++)
+					for (size_t k = 0; k < kernelSize; k++)
+						padded.push_back(((i < outSize) && (j < inSize)) ? *(it++) : 0.0f);
+
+			if (hasBias)
+			{
+				for (size_t i = 0; i < paddedOutSize; i++)
+					padded.push_back((i < outSize) ? *(it++) : 0.0f);
+			}
+		};
+
+		for (size_t array = 0; array < layersConfig.size(); array++)
+		{
+			const auto& arrayConfig = layersConfig[array];
+
+			const size_t inputSize = arrayConfig.at("input_size");
+			const size_t conditionSize = arrayConfig.at("condition_size");
+			const size_t headSize = arrayConfig.at("head_size");
+			const size_t channels = arrayConfig.at("channels");
+			const size_t kernelSize = arrayConfig.at("kernel_size");
+			const size_t numLayers = arrayConfig.at("dilations").size();
+			const bool headBias = arrayConfig.at("head_bias");
+
+			// The second layer array takes the output of the first, and its channels are the first's head
+			const size_t paddedInputSize = (array == 0) ? inputSize : paddedChannels;
+			const size_t paddedArrayChannels = (array == 0) ? paddedChannels : paddedHeadSize;
+			const size_t paddedArrayHeadSize = (array == 0) ? paddedHeadSize : headSize;
+
+			padWeights(channels, inputSize, 1, paddedArrayChannels, paddedInputSize, false);	// Rechannel
+
+			for (size_t layer = 0; layer < numLayers; layer++)
+			{
+				padWeights(channels, channels, kernelSize, paddedArrayChannels, paddedArrayChannels, true);	// Dilated convolution
+				padWeights(channels, conditionSize, 1, paddedArrayChannels, conditionSize, false);	// Input mixin
+				padWeights(channels, channels, 1, paddedArrayChannels, paddedArrayChannels, true);	// 1x1
+			}
+
+			padWeights(headSize, channels, 1, paddedArrayHeadSize, paddedArrayChannels, headBias);	// Head rechannel
+		}
+
+		padded.insert(padded.end(), it, weights.end());	// Head scale
+
+		return padded;
+	}
+
+	inline std::vector<float> FlattenKerasWeights(const nlohmann::json& weights)
+	{
+		std::vector<float> vec;
+
+		for (size_t i = 0; i < weights.size(); i++)
+		{
+			if (weights[i].is_array())
+			{
+				auto subVec = FlattenKerasWeights(weights[i]);
+				vec.insert(vec.end(), subVec.begin(), subVec.end());
+			}
+			else
+			{
+				vec.push_back(weights[i]);
+			}
+		}
+
+		return vec;
+	}
+
+	// Reads a Keras model made of GRU layers followed by a linear dense layer. Only GRUs with reset_after (the Keras
+	// default, with separate input and hidden biases) are supported.
+	inline bool ReadKerasGRUDef(const nlohmann::json& modelJson, GRUDef& gruDef)
+	{
+		const auto& layers = modelJson.at("layers");
+		const size_t numLayers = layers.size();
+
+		if (numLayers < 2)
+			return false;
+
+		const size_t hiddenSize = layers.at(0).at("shape").back();
+
+		const auto& lastLayer = layers[numLayers - 1];
+
+		if ((lastLayer.at("type") != "dense") || !lastLayer.value("activation", "").empty())
+			return false;
+
+		gruDef.HeadWeights = FlattenKerasWeights(lastLayer.at("weights").at(0));
+		gruDef.HeadBias = lastLayer.at("weights").at(1).at(0);
+
+		if (gruDef.HeadWeights.size() != hiddenSize)
+			return false;
+
+		for (size_t i = 0; i < (numLayers - 1); i++)
+		{
+			const auto& layer = layers[i];
+
+			if ((layer.at("type") != "gru") || (layer.at("shape").back() != hiddenSize))
+				return false;
+
+			const size_t inputSize = (i == 0) ? 1 : hiddenSize;
+
+			GRULayerDef layerDef;
+
+			layerDef.InputWeights = FlattenKerasWeights(layer.at("weights").at(0));
+			layerDef.HiddenWeights = FlattenKerasWeights(layer.at("weights").at(1));
+
+			std::vector<float> bias = FlattenKerasWeights(layer.at("weights").at(2));
+
+			if ((layerDef.InputWeights.size() != (inputSize * 3 * hiddenSize)) || (layerDef.HiddenWeights.size() != (hiddenSize * 3 * hiddenSize)) ||
+				(bias.size() != (2 * 3 * hiddenSize)))
+				return false;
+
+			layerDef.InputBias.assign(bias.begin(), bias.begin() + (3 * hiddenSize));
+			layerDef.HiddenBias.assign(bias.begin() + (3 * hiddenSize), bias.end());
+
+			gruDef.Layers.push_back(layerDef);
+		}
+
+		return true;
+	}
+
+	inline bool GetKerasActivation(const std::string& name, EKerasActivation& activation)
+	{
+		if (name.empty() || (name == "linear"))
+			activation = EKerasActivation::Linear;
+		else if (name == "tanh")
+			activation = EKerasActivation::Tanh;
+		else if (name == "relu")
+			activation = EKerasActivation::ReLU;
+		else if (name == "sigmoid")
+			activation = EKerasActivation::Sigmoid;
+		else if (name == "elu")
+			activation = EKerasActivation::ELU;
+		else
+			return false;
+
+		return true;
+	}
+
+	// Reads a Keras model made of conv1d, dense and activation layers, with a single input and output
+	inline bool ReadKerasModelDef(const nlohmann::json& modelJson, KerasModelDef& modelDef)
+	{
+		size_t inSize = 1;
+
+		// Sizes can be stored as a single value or a list
+		auto getSize = [](const nlohmann::json& value) -> size_t
+		{
+			return value.is_array() ? value.back().get<size_t>() : value.get<size_t>();
+		};
+
+		for (const auto& layer : modelJson.at("layers"))
+		{
+			const std::string type = layer.at("type");
+
+			EKerasActivation activation;
+
+			if ((type == "conv1d") || (type == "dense") || (type == "time-distributed-dense"))
+			{
+				if (!GetKerasActivation(layer.value("activation", ""), activation))
+					return false;
+
+				KerasLayerDef layerDef;
+
+				const auto& weights = layer.at("weights");
+
+				if (type == "conv1d")
+				{
+					if (layer.value("groups", 1) != 1)
+						return false;
+
+					layerDef.KernelSize = getSize(layer.at("kernel_size"));
+					layerDef.Dilation = getSize(layer.at("dilation"));
+				}
+
+				layerDef.InSize = inSize;
+				layerDef.OutSize = getSize(layer.at("shape"));
+				layerDef.Weights = FlattenKerasWeights(weights.at(0));
+				layerDef.Activation = activation;
+
+				if (weights.size() > 1)
+					layerDef.Bias = FlattenKerasWeights(weights.at(1));
+
+				if ((layerDef.KernelSize == 0) || (layerDef.Weights.size() != (layerDef.KernelSize * layerDef.InSize * layerDef.OutSize)) ||
+					(!layerDef.Bias.empty() && (layerDef.Bias.size() != layerDef.OutSize)))
+					return false;
+
+				modelDef.Layers.push_back(layerDef);
+
+				inSize = layerDef.OutSize;
+			}
+			else if (GetKerasActivation(type, activation))
+			{
+				// Standalone activations are folded into the previous layer
+				if (modelDef.Layers.empty() || (modelDef.Layers.back().Activation != EKerasActivation::Linear))
+					return false;
+
+				modelDef.Layers.back().Activation = activation;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return !modelDef.Layers.empty() && (inSize == 1);
+	}
+
+	// Reads a NAM ConvNet config. Returns false for grouped convolutions and activations we don't implement.
+	inline bool ReadConvNetConfig(const nlohmann::json& config, size_t& channels, std::vector<size_t>& dilations, bool& batchNorm, EConvNetActivation& activation)
+	{
+		if (config.value("groups", 1) != 1)
+			return false;
+
+		channels = config.at("channels");
+		dilations = config.at("dilations").get<std::vector<size_t>>();
+		batchNorm = config.at("batchnorm");
+
+		if (dilations.empty())
+			return false;
+
+		// Activation can be a name, or an object with a type
+		const auto& activationConfig = config.at("activation");
+		const std::string name = activationConfig.is_object() ? activationConfig.at("type").get<std::string>() : activationConfig.get<std::string>();
+
+		if ((name == "Tanh") || (name == "Fasttanh"))
+			activation = EConvNetActivation::Tanh;
+		else if (name == "ReLU")
+			activation = EConvNetActivation::ReLU;
+		else if (name == "Hardtanh")
+			activation = EConvNetActivation::Hardtanh;
+		else if (name == "Sigmoid")
+			activation = EConvNetActivation::Sigmoid;
+		else if ((name == "LeakyReLU") && !(activationConfig.is_object() && activationConfig.contains("negative_slope") && (activationConfig.at("negative_slope") != 0.01)))
+			activation = EConvNetActivation::LeakyReLU;
+		else
+			return false;
+
+		return true;
+	}
+
+	// NAM ConvNet weights with any batchnorm folded in, zero-padded if paddedChannels is larger than the model. Weights that
+	// need converting end up in convertedWeights - otherwise they are used straight from the weights buffer.
+	inline std::span<const float> GetConvNetNAMWeights(const nlohmann::json& modelJson, const ModelWeightsPtr& modelWeights, size_t paddedChannels,
+		std::vector<float>& convertedWeights)
+	{
+		const auto& config = modelJson.at("config");
+		const size_t channels = config.at("channels");
+		const size_t numBlocks = config.at("dilations").size();
+		const bool batchNorm = config.at("batchnorm");
+
+		std::span<const float> weights = GetNAMWeights(modelJson.at("weights"), modelWeights, convertedWeights);
+
+		size_t numWeights = GetConvNetNumWeights(channels, numBlocks, batchNorm);
+
+		if (numWeights != weights.size())
+		{
+			std::stringstream str;
+			str << "Wrong number of weights. Expected " << numWeights << " but got " << weights.size();
+			throw std::runtime_error(str.str());
+		}
+
+		if (batchNorm)
+		{
+			convertedWeights = FoldConvNetBatchNorm(weights, channels, numBlocks);
+			weights = convertedWeights;
+		}
+
+		if (paddedChannels > channels)
+		{
+			convertedWeights = PadConvNetWeights(weights, channels, paddedChannels, numBlocks);
+			weights = convertedWeights;
+		}
+
+		return weights;
+	}
+
+	// Layout of a classic (A1 style) WaveNet - rechannel, the layers, then the head rechannel of each layer array, followed
+	// by the head scale. This is what the internal WaveNet engines use for it.
+	inline bool GetA1WaveNetWeightLayout(const nlohmann::json& config, WeightLayout& layout)
+	{
+		for (auto& [key, value] : config.items())
+		{
+			if ((key != "layers") && (key != "head_scale") && !((key == "head") && value.is_null()))
+				return false;
+		}
+
+		for (auto& arrayConfig : config.at("layers"))
+		{
+			for (auto& [key, value] : arrayConfig.items())
+			{
+				if ((key != "input_size") && (key != "condition_size") && (key != "head_size") && (key != "channels") && (key != "kernel_size") &&
+					(key != "dilations") && (key != "activation") && (key != "gated") && (key != "head_bias"))
+					return false;
+			}
+
+			if (arrayConfig.at("gated"))
+				return false;
+
+			const size_t inputSize = arrayConfig.at("input_size");
+			const size_t conditionSize = arrayConfig.at("condition_size");
+			const size_t headSize = arrayConfig.at("head_size");
+			const size_t channels = arrayConfig.at("channels");
+			const size_t kernelSize = arrayConfig.at("kernel_size");
+			const size_t numLayers = arrayConfig.at("dilations").size();
+
+			AddWeightBlock(layout, channels, inputSize);	// Rechannel
+
+			for (size_t layer = 0; layer < numLayers; layer++)
+			{
+				AddWeightBlock(layout, channels, channels, kernelSize);	// Dilated convolution
+				AddWeightBlock(layout, channels);
+				AddWeightBlock(layout, channels, conditionSize);	// Input mixin
+				AddWeightBlock(layout, channels, channels);	// 1x1
+				AddWeightBlock(layout, channels);
+			}
+
+			AddWeightBlock(layout, headSize, channels);	// Head rechannel
+
+			if (arrayConfig.at("head_bias"))
+				AddWeightBlock(layout, headSize);
+		}
+
+		AddWeightBlock(layout, 1);	// Head scale
+
+		return true;
+	}
+
+	// Layout the internal engines use for the weights of a NAM model. Returns false if they don't run it (or need its weights
+	// converting first, like ConvNet batchnorm).
+	inline bool GetNAMEngineWeightLayout(const nlohmann::json& modelJson, WeightLayout& layout)
+	{
+		layout.clear();
+
+		try
+		{
+			const std::string arch = modelJson.value("architecture", "");
+			const auto& config = modelJson.at("config");
+
+			if (arch == "WaveNet")
+				return GetA1WaveNetWeightLayout(config, layout);
+
+			if (arch == "LSTM")
+			{
+				if (config.value("input_size", 1) != 1)
+					return false;
+
+				layout = GetLSTMWeightLayout(config.at("num_layers"), config.at("hidden_size"));
+
+				return true;
+			}
+
+			if (arch == "ConvNet")
+			{
+				size_t channels;
+				std::vector<size_t> dilations;
+				bool batchNorm;
+				EConvNetActivation activation;
+
+				if (!ReadConvNetConfig(config, channels, dilations, batchNorm, activation) || batchNorm)
+					return false;
+
+				layout = GetConvNetWeightLayout(channels, dilations.size());
+
+				return true;
+			}
+		}
+		catch (const nlohmann::json::exception&)
+		{
+		}
+
+		layout.clear();
+
+		return false;
+	}
+
+	// Copy of the model json, with the weights of each model (including any submodels) moved into packedWeights. Weights the
+	// internal engines can use in place are stored packed in their layout (see GetNAMEngineWeightLayout()), with any ConvNet
+	// batchnorm folded in. Other weights are kept in NAM order.
+	inline nlohmann::json PackModelWeights(const nlohmann::json& modelJson, const ModelWeightsPtr& weights, std::vector<float>& packedWeights)
+	{
+		if (modelJson.is_array())
+		{
+			nlohmann::json packedJson = nlohmann::json::array();
+
+			for (auto& value : modelJson)
+				packedJson.push_back(PackModelWeights(value, weights, packedWeights));
+
+			return packedJson;
+		}
+
+		if (!modelJson.is_object())
+			return modelJson;
+
+		nlohmann::json packedJson = nlohmann::json::object();
+
+		for (auto& [key, value] : modelJson.items())
+		{
+			if ((key != "weights") || !IsWeightsReference(value))
+				packedJson[key] = PackModelWeights(value, weights, packedWeights);
+		}
+
+		if (!modelJson.contains("weights") || !IsWeightsReference(modelJson.at("weights")))
+			return packedJson;
+
+		std::vector<float> convertedWeights;
+		std::span<const float> namWeights = GetNAMWeights(modelJson.at("weights"), weights, convertedWeights);
+
+		if ((modelJson.value("architecture", "") == "ConvNet") && packedJson.contains("config"))
+		{
+			auto& config = packedJson.at("config");
+
+			size_t channels;
+			std::vector<size_t> dilations;
+			bool batchNorm;
+			EConvNetActivation activation;
+
+			if (ReadConvNetConfig(config, channels, dilations, batchNorm, activation) && batchNorm &&
+				(namWeights.size() == GetConvNetNumWeights(channels, dilations.size(), true)))
+			{
+				convertedWeights = FoldConvNetBatchNorm(namWeights, channels, dilations.size());
+				namWeights = convertedWeights;
+
+				config["batchnorm"] = false;
+			}
+		}
+
+		const size_t offset = packedWeights.size();
+
+		nlohmann::json weightsJson = { { "offset", offset }, { "count", namWeights.size() } };
+
+		WeightLayout layout;
+
+		if (GetNAMEngineWeightLayout(packedJson, layout) && (GetWeightLayoutSize(layout) == namWeights.size()))
+		{
+			packedWeights.resize(offset + namWeights.size());
+
+			PackWeights(namWeights, layout, packedWeights.data() + offset);
+
+			weightsJson["layout"] = WeightLayoutToJson(layout);
+		}
+		else
+		{
+			packedWeights.insert(packedWeights.end(), namWeights.begin(), namWeights.end());
+		}
+
+		packedJson["weights"] = weightsJson;
+
+		return packedJson;
+	}
+
+	class InternalModel : public NeuralModelImpl
+	{
+	public:
+		bool LoadFromKerasJson(const nlohmann::json& modelJson)
+		{
+			ReadKerasConfig(modelJson);
+
+			return CreateModelFromKerasJson(modelJson);
+		}
+
+		virtual bool CreateModelFromKerasJson(const nlohmann::json& modelJson)
+		{
+			(void)modelJson;
+
+			return false;
+		}
+
+		// The json refers to the weights buffer for its weights
+		virtual bool LoadFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights)
+		{
+			ReadNAMConfig(modelJson);
+
+			return CreateModelFromNAMJson(modelJson, weights);
+		}
+
+		virtual bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights)
+		{
+			(void)modelJson;
+			(void)weights;
+
+			return false;
+		}
+	};
+
+	template <typename ModelType>
+	class InternalWaveNetModelT : public InternalModel
+	{
+	public:
+		InternalWaveNetModelT()
+			: model(nullptr)
+		{
+		}
+
+		~InternalWaveNetModelT()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+		}
+
+		bool IsStatic() override
+		{
+			return true;
+		}
+
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+
+			model = new ModelType;
+
+			const auto& layersConfig = modelJson.at("config").at("layers");
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else if ((layersConfig.size() == 2) && ((layersConfig[0].at("channels") != ModelType::headLayerChannels) || (layersConfig[0].at("head_size") != ModelType::headLayerHeadSize)))
+			{
+				// Smaller A1 models are run zero-padded to our size
+				model->SetWeights(PadA1WaveNetNAMWeights(modelJson, weights, ModelType::headLayerChannels, ModelType::headLayerHeadSize));
+			}
+			else
+			{
+				std::vector<float> unpackedWeights;
+
+				model->SetWeights(GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights));
+			}
+
+			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
+
+			return true;
+		}
+
+		void SetMaxAudioBufferSize(const int maxSize) override
+		{
+			(void)maxSize;
+		}
+
+		int GetReceptiveFieldSize() override
+		{
+			return model->ReceptiveFieldSize;
+		}
+
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			ProcessDirect(this, input, output, numSamples);
+		}
+
+		void Prewarm() override
+		{
+			model->Prewarm();
+		}
+
+		NeuralModelProcessor GetProcessor() override
+		{
+			return { this, &ProcessDirect };
+		}
+
+		std::string GetArchitectureSignature() override
+		{
+			return model->GetArchitectureSignature();
+		}
+
+		std::vector<KernelTuning> GetKernelTuningCandidates() override
+		{
+			std::vector<KernelTuning> candidates;
+
+			candidates.push_back(GetDefaultKernelTuning());
+
+			for (int tileSize : { 0, 4, 8 })
+			{
+				for (int chunkSize = WAVENET_MAX_NUM_FRAMES; chunkSize >= 16; chunkSize /= 2)
+				{
+					KernelTuning tuning = { tileSize, chunkSize };
+
+					if (!(tuning == candidates[0]))
+						candidates.push_back(tuning);
+				}
+			}
+
+			return candidates;
+		}
+
+		void SetKernelTuning(const KernelTuning& tuning) override
+		{
+			KernelTuning defaultTuning = GetDefaultKernelTuning();
+
+			model->SetConvolutionTileSize(((tuning.ConvolutionTileSize == 4) || (tuning.ConvolutionTileSize == 8)) ? tuning.ConvolutionTileSize : 0);
+
+			frameChunkSize = (tuning.FrameChunkSize > 0) ? std::min((size_t)tuning.FrameChunkSize, (size_t)WAVENET_MAX_NUM_FRAMES) : defaultTuning.FrameChunkSize;
+		}
+
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalWaveNetModelT* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalWaveNetModelT(*this);
+
+			clone->model->CopyState(*model);
+			clone->frameChunkSize = frameChunkSize;
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalWaveNetModelT(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto wavenetClone = dynamic_cast<InternalWaveNetModelT*>(clone);
+
+			if ((wavenetClone == nullptr) || (wavenetClone == this) || (model == nullptr) || (wavenetClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(wavenetClone);
+		}
+
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalWaveNetModelT(const InternalWaveNetModelT& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance()),
+			frameChunkSize(other.frameChunkSize)
+		{
+		}
+
+		static KernelTuning GetDefaultKernelTuning()
+		{
+			return { MULTIFRAME_8X8_CONVOLUTION, WAVENET_MAX_NUM_FRAMES };
+		}
+
+		static void ProcessDirect(void* instance, float* input, float* output, size_t numSamples)
+		{
+			InternalWaveNetModelT* wavenet = static_cast<InternalWaveNetModelT*>(instance);
+			ModelType* model = wavenet->model;
+			const size_t frameChunkSize = wavenet->frameChunkSize;
+
+			if (numSamples <= frameChunkSize)	// Small blocks skip the chunking loop
+			{
+				model->Process(input, output, numSamples);
+
+				return;
+			}
+
+			size_t offset = 0;
+
+			while (numSamples > 0)
+			{
+				size_t toProcess = std::min(numSamples, frameChunkSize);
+
+				model->Process(input + offset, output + offset, toProcess);
+
+				offset += toProcess;
+				numSamples -= toProcess;
+			}
+		}
+
+		ModelType* model = nullptr;
+		size_t frameChunkSize = WAVENET_MAX_NUM_FRAMES;
+		ClonePool<InternalWaveNetModelT> clonePool;
+	};
+
+
+	class InternalWaveNetDefinitionBase
+	{
+	public:
+		virtual InternalModel* CreateModel()
+		{
+			return nullptr;
+		}
+
+		virtual size_t GetNumChannels()
+		{
+			return 0;
+		}
+
+		virtual size_t GetHeadSize()
+		{
+			return 0;
+		}
+
+		virtual bool HasStandardDilations()
+		{
+			return false;
+		}
+
+		virtual size_t GetFLOPsPerSample()
+		{
+			return 0;
+		}
+	};
+
+	template <int NumChannels, int HeadSize>
+	class InternalA1WaveNetDefinitionT : public InternalWaveNetDefinitionBase
+	{
+	public:
+		using ModelType = typename std::conditional<NumChannels == 16,
+			NeuralAudio::WaveNetModelT<float,
+				NeuralAudio::WaveNetLayerArrayT<float, 1, 1, HeadSize, 1, 1, NumChannels, IStdKernelSizes, IStdDilations, false, EActivationType::Tanh>,
+				NeuralAudio::WaveNetLayerArrayT<float, NumChannels, 1, 1, 1, 1, HeadSize, IStdKernelSizes, IStdDilations, true, EActivationType::Tanh>>,
+			NeuralAudio::WaveNetModelT<float,
+				NeuralAudio::WaveNetLayerArrayT<float, 1, 1, HeadSize, 1, 1, NumChannels, ILiteKernelSizes1, ILiteDilations1, false, EActivationType::Tanh>,
+				NeuralAudio::WaveNetLayerArrayT<float, NumChannels, 1, 1, 1, 1, HeadSize, ILiteKernelSizes2, ILiteDilations2, true, EActivationType::Tanh>>
+			>::type;
+
+		InternalModel* CreateModel() override
+		{
+			return new InternalWaveNetModelT<ModelType>;
+		}
+
+		virtual size_t GetNumChannels() override
+		{
+			return NumChannels;
+		}
+
+		virtual size_t GetHeadSize() override
+		{
+			return HeadSize;
+		}
+
+		virtual bool HasStandardDilations() override
+		{
+			return NumChannels == 16;
+		}
+
+		virtual size_t GetFLOPsPerSample() override
+		{
+			if constexpr (NumChannels == 16)
+			{
+				return GetA1WaveNetFLOPsPerSample(NumChannels, HeadSize, IStdDilations::size(), IStdDilations::size());
+			}
+			else
+			{
+				return GetA1WaveNetFLOPsPerSample(NumChannels, HeadSize, ILiteDilations1::size(), ILiteDilations2::size());
+			}
+		}
+	};
+
+	class InternalWaveNetModelDyn : public InternalModel
+	{
+	public:
+		InternalWaveNetModelDyn()
+		{
+		}
+
+		~InternalWaveNetModelDyn()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+		}
+
+		EModelLoadMode GetLoadMode() override
+		{
+			return EModelLoadMode::Internal;
+		}
+
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
+		{
+			auto& config = modelJson.at("config");
+
+			std::vector<WaveNetLayerArray> layerArrays;
+
+			for (size_t i = 0; i < config.at("layers").size(); i++)
+			{
+				auto& layerConfig = config.at("layers").at(i);
+
+				layerArrays.push_back(WaveNetLayerArray(layerConfig.at("input_size"), layerConfig.at("condition_size"), layerConfig.at("head_size"),
+					layerConfig.at("channels"), layerConfig.at("kernel_size"), layerConfig.at("head_bias"), layerConfig.at("dilations")));
+			}
+
+			model = new WaveNetModel(layerArrays);
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else
+			{
+				std::vector<float> unpackedWeights;
+
+				model->SetWeights(GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights));
+			}
+
+			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
+
+			return true;
+		}
+
+		void SetMaxAudioBufferSize(const int maxSize) override
+		{
+			model->SetMaxFrames(maxSize);
+		}
+
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			size_t offset = 0;
+
+			while (numSamples > 0)
+			{
+				size_t toProcess = std::min(numSamples, model->GetMaxFrames());
+
+				model->Process(input + offset, output + offset, toProcess);
+
+				offset += toProcess;
+				numSamples -= toProcess;
+			}
+		}
+
+		void Prewarm() override
+		{
+			model->Prewarm();
+		}
+
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalWaveNetModelDyn* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalWaveNetModelDyn(*this);
+
+			clone->model->CopyState(*model);
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalWaveNetModelDyn(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto wavenetClone = dynamic_cast<InternalWaveNetModelDyn*>(clone);
+
+			if ((wavenetClone == nullptr) || (wavenetClone == this) || (model == nullptr) || (wavenetClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(wavenetClone);
+		}
+
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalWaveNetModelDyn(const InternalWaveNetModelDyn& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
+
+		WaveNetModel* model = nullptr;
+		ClonePool<InternalWaveNetModelDyn> clonePool;
+	};
+
+
+	template <typename ModelType>
+	class InternalConvNetModelT : public InternalModel
+	{
+	public:
+		InternalConvNetModelT()
+			: model(nullptr)
+		{
+		}
+
+		~InternalConvNetModelT()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+		}
+
+		bool IsStatic() override
+		{
+			return true;
+		}
+
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+
+			model = new ModelType;
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else
+			{
+				std::vector<float> convertedWeights;
+
+				// Smaller models are run zero-padded to our size
+				model->SetWeights(GetConvNetNAMWeights(modelJson, weights, ModelType::NumChannelsP, convertedWeights));
+			}
+
+			return true;
+		}
+
+		void SetMaxAudioBufferSize(const int maxSize) override
+		{
+			(void)maxSize;
+		}
+
+		int GetReceptiveFieldSize() override
+		{
+			return model->ReceptiveFieldSize;
+		}
+
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			ProcessDirect(this, input, output, numSamples);
+		}
+
+		void Prewarm() override
+		{
+			model->Prewarm();
+		}
+
+		NeuralModelProcessor GetProcessor() override
+		{
+			return { this, &ProcessDirect };
+		}
+
+		std::string GetArchitectureSignature() override
+		{
+			return model->GetArchitectureSignature();
+		}
+
+		std::vector<KernelTuning> GetKernelTuningCandidates() override
+		{
+			std::vector<KernelTuning> candidates;
+
+			candidates.push_back(GetDefaultKernelTuning());
+
+			for (int tileSize : { 0, 4, 8 })
+			{
+				for (int chunkSize = WAVENET_MAX_NUM_FRAMES; chunkSize >= 16; chunkSize /= 2)
+				{
+					KernelTuning tuning = { tileSize, chunkSize };
+
+					if (!(tuning == candidates[0]))
+						candidates.push_back(tuning);
+				}
+			}
+
+			return candidates;
+		}
+
+		void SetKernelTuning(const KernelTuning& tuning) override
+		{
+			KernelTuning defaultTuning = GetDefaultKernelTuning();
+
+			model->SetConvolutionTileSize(((tuning.ConvolutionTileSize == 4) || (tuning.ConvolutionTileSize == 8)) ? tuning.ConvolutionTileSize : 0);
+
+			frameChunkSize = (tuning.FrameChunkSize > 0) ? std::min((size_t)tuning.FrameChunkSize, (size_t)WAVENET_MAX_NUM_FRAMES) : defaultTuning.FrameChunkSize;
+		}
+
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalConvNetModelT* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalConvNetModelT(*this);
+
+			clone->model->CopyState(*model);
+			clone->frameChunkSize = frameChunkSize;
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalConvNetModelT(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto convNetClone = dynamic_cast<InternalConvNetModelT*>(clone);
+
+			if ((convNetClone == nullptr) || (convNetClone == this) || (model == nullptr) || (convNetClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(convNetClone);
+		}
+
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalConvNetModelT(const InternalConvNetModelT& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance()),
+			frameChunkSize(other.frameChunkSize)
+		{
+		}
+
+		static KernelTuning GetDefaultKernelTuning()
+		{
+			return { MULTIFRAME_8X8_CONVOLUTION, WAVENET_MAX_NUM_FRAMES };
+		}
+
+		static void ProcessDirect(void* instance, float* input, float* output, size_t numSamples)
+		{
+			InternalConvNetModelT* convNet = static_cast<InternalConvNetModelT*>(instance);
+			ModelType* model = convNet->model;
+			const size_t frameChunkSize = convNet->frameChunkSize;
+
+			while (numSamples > 0)
+			{
+				size_t toProcess = std::min(numSamples, frameChunkSize);
+
+				model->Process(input, output, toProcess);
+
+				input += toProcess;
+				output += toProcess;
+				numSamples -= toProcess;
+			}
+		}
+
+		ModelType* model = nullptr;
+		size_t frameChunkSize = WAVENET_MAX_NUM_FRAMES;
+		ClonePool<InternalConvNetModelT> clonePool;
+	};
+
+	class InternalConvNetDefinitionBase
+	{
+	public:
+		virtual InternalModel* CreateModel()
+		{
+			return nullptr;
+		}
+
+		virtual size_t GetNumChannels()
+		{
+			return 0;
+		}
+
+		virtual size_t GetFLOPsPerSample()
+		{
+			return 0;
+		}
+	};
+
+	// Standard NAM trainer ConvNet presets - they only differ in the number of channels
+	template <int NumChannels>
+	class InternalConvNetDefinitionT : public InternalConvNetDefinitionBase
+	{
+	public:
+		using ModelType = NeuralAudio::ConvNetModelT<float, NumChannels, IConvNetDilations, EConvNetActivation::Tanh>;
+
+		InternalModel* CreateModel() override
+		{
+			return new InternalConvNetModelT<ModelType>;
+		}
+
+		virtual size_t GetNumChannels() override
+		{
+			return NumChannels;
+		}
+
+		virtual size_t GetFLOPsPerSample() override
+		{
+			return GetConvNetFLOPsPerSample(NumChannels, IConvNetDilations::size());
+		}
+	};
+
+	class InternalConvNetModelDyn : public InternalModel
+	{
+	public:
+		InternalConvNetModelDyn()
+			: model(nullptr)
+		{
+		}
+
+		~InternalConvNetModelDyn()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+		}
+
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+
+			size_t channels;
+			std::vector<size_t> dilations;
+			bool batchNorm;
+			EConvNetActivation activation;
+
+			if (!ReadConvNetConfig(modelJson.at("config"), channels, dilations, batchNorm, activation))
+				return false;
+
+			model = new ConvNetModel(channels, dilations, activation);
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else
+			{
+				std::vector<float> convertedWeights;
+
+				model->SetWeights(GetConvNetNAMWeights(modelJson, weights, channels, convertedWeights));
+			}
+
+			return true;
+		}
+
+		void SetMaxAudioBufferSize(const int maxSize) override
+		{
+			(void)maxSize;
+		}
+
+		int GetReceptiveFieldSize() override
+		{
+			return (int)model->ReceptiveFieldSize;
+		}
+
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			while (numSamples > 0)
+			{
+				size_t toProcess = std::min(numSamples, model->GetMaxFrames());
+
+				model->Process(input, output, toProcess);
+
+				input += toProcess;
+				output += toProcess;
+				numSamples -= toProcess;
+			}
+		}
+
+		void Prewarm() override
+		{
+			model->Prewarm();
+		}
+
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalConvNetModelDyn* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalConvNetModelDyn(*this);
+
+			clone->model->CopyState(*model);
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalConvNetModelDyn(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto convNetClone = dynamic_cast<InternalConvNetModelDyn*>(clone);
+
+			if ((convNetClone == nullptr) || (convNetClone == this) || (model == nullptr) || (convNetClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(convNetClone);
+		}
+
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalConvNetModelDyn(const InternalConvNetModelDyn& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
+
+		ConvNetModel* model = nullptr;
+		ClonePool<InternalConvNetModelDyn> clonePool;
+	};
+
+
+	// NAM Linear models are a single FIR filter (weights are the taps, starting with the current sample) and an optional bias
+	class InternalLinearModel : public InternalModel
 	{
 	public:
-		bool LoadFromKerasJson(const nlohmann::json& modelJson)
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
 		{
-			ReadKerasConfig(modelJson);
+			auto& config = modelJson.at("config");
 
-			return CreateModelFromKerasJson(modelJson);
+			const size_t receptiveField = config.at("receptive_field");
+			const bool hasBias = config.at("bias");
+
+			std::vector<float> unpackedWeights;
+			std::span<const float> taps = GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights);
+
+			size_t numWeights = receptiveField + (hasBias ? 1 : 0);
+
+			if (numWeights != taps.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numWeights << " but got " << taps.size();
+				throw std::runtime_error(str.str());
+			}
+
+			convolution.SetImpulseResponse(taps.data(), receptiveField);
+
+			bias = hasBias ? taps[receptiveField] : 0;
+
+			return true;
 		}
 
-		virtual bool CreateModelFromKerasJson(const nlohmann::json& modelJson)
+		int GetReceptiveFieldSize() override
 		{
-			(void)modelJson;
+			return (int)convolution.GetLength() - 1;
+		}
 
-			return false;
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			convolution.Process(input, output, numSamples);
+
+			if (bias != 0)
+			{
+				for (size_t i = 0; i < numSamples; i++)
+					output[i] += bias;
+			}
 		}
 
-		virtual bool LoadFromNAMJson(const nlohmann::json& modelJson)
+		void Prewarm() override
 		{
-			ReadNAMConfig(modelJson);
+			convolution.Reset();	// Silence in gives silence (plus the bias) out, so clearing the history is enough
+		}
+
+	private:
+		PartitionedConvolution convolution;
+		float bias = 0;
+	};
+
 
-			return CreateModelFromNAMJson(modelJson);
+	template <int NumLayers, int HiddenSize>
+	class InternalLSTMBatchT : public NeuralModelBatch
+	{
+	public:
+		InternalLSTMBatchT(const LSTMModelT<NumLayers, HiddenSize>& model, size_t numInstances) :
+			batch(model, numInstances)
+		{
 		}
 
-		virtual bool CreateModelFromNAMJson(const nlohmann::json& modelJson)
+		size_t GetNumInstances() override
 		{
-			(void)modelJson;
+			return batch.GetNumInstances();
+		}
 
-			return false;
+		void ResetInstance(size_t instance) override
+		{
+			batch.ResetInstance(instance);
 		}
+
+		void Process(float** inputs, float** outputs, size_t numSamples) override
+		{
+			batch.Process(inputs, outputs, numSamples);
+		}
+
+	private:
+		LSTMBatchT<NumLayers, HiddenSize> batch;
 	};
 
-	template <typename ModelType>
-	class InternalWaveNetModelT : public InternalModel
+	template <int NumLayers, int HiddenSize>
+	class InternalLSTMModelT : public InternalModel
 	{
 	public:
-		InternalWaveNetModelT()
+		InternalLSTMModelT()
 			: model(nullptr)
 		{
 		}
 
-		~InternalWaveNetModelT()
+		~InternalLSTMModelT()
 		{
 			if (model != nullptr)
 			{
@@ -74,7 +1393,7 @@ namespace NeuralAudio
 			return true;
 		}
 
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
 		{
 			if (model != nullptr)
 			{
@@ -82,182 +1401,255 @@ namespace NeuralAudio
 				model = nullptr;
 			}
 
-			model = new ModelType;
+			model = new LSTMModelT<NumLayers, HiddenSize>;
+
+			const size_t modelHiddenSize = modelJson.at("config").at("hidden_size");
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else
+			{
+				std::vector<float> unpackedWeights;
+				std::span<const float> namWeights = GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights);
+
+				const size_t numModelWeights = GetWeightLayoutSize(GetLSTMWeightLayout(NumLayers, modelHiddenSize));
+
+				if (numModelWeights != namWeights.size())
+				{
+					std::stringstream str;
+					str << "Wrong number of weights. Expected " << numModelWeights << " but got " << namWeights.size();
+					throw std::runtime_error(str.str());
+				}
 
-			model->SetWeights(modelJson.at("weights"));
+				// Smaller models are run zero-padded to our size
+				if (modelHiddenSize != HiddenSize)
+					model->SetNAMWeights(PadLSTMNAMWeights(namWeights, NumLayers, modelHiddenSize, HiddenSize));
+				else
+					model->SetNAMWeights(namWeights);
+			}
 
 			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
 
 			return true;
 		}
 
-		void SetMaxAudioBufferSize(const int maxSize) override
+		std::vector<float> FlattenWeights(const nlohmann::json& weights)
 		{
-			(void)maxSize;
-		}
+			std::vector<float> vec;
 
-		int GetReceptiveFieldSize() override
-		{
-			return model->ReceptiveFieldSize;
+			for (size_t i = 0; i < weights.size(); i++)
+			{
+				if (weights[i].is_array())
+				{
+					auto subVec = FlattenWeights(weights[i]);
+					vec.insert(vec.end(), subVec.begin(), subVec.end());
+				}
+				else
+				{
+					vec.push_back(weights[i]);
+				}
+			}
+
+			return vec;
 		}
 
-		void Process(float* input, float* output, size_t numSamples) override
+		bool CreateModelFromKerasJson(const nlohmann::json& modelJson) override
 		{
-			size_t offset = 0;
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
 
-			while (numSamples > 0)
+			model = new LSTMModelT<NumLayers, HiddenSize>;
+
+			const auto layers = modelJson.at("layers");
+			const size_t numLayers = layers.size();
+
+			if (numLayers < 2)
+				return false;
+
+			auto lastLayer = layers[numLayers - 1];
+
+			if (lastLayer.at("type") != "dense")
+				return false;
+
+			LSTMDef lstmDef;
+
+			lstmDef.HeadWeights = FlattenWeights(lastLayer.at("weights").at(0));
+			lstmDef.HeadBias = lastLayer.at("weights").at(1).at(0);
+
+			for (size_t i = 0; i < (numLayers - 1); i++)
 			{
-				size_t toProcess = std::min(numSamples, model->GetMaxFrames());
+				auto layer = layers[i];
 
-				model->Process(input + offset, output + offset, toProcess);
+				if (layer.at("type") != "lstm")
+					return false;
 
-				offset += toProcess;
-				numSamples -= toProcess;
+				LSTMLayerDef layerDef;
+
+				layerDef.InputWeights = FlattenWeights(layer.at("weights").at(0));
+				layerDef.HiddenWeights = FlattenWeights(layer.at("weights").at(1));
+				layerDef.BiasWeights = FlattenWeights(layer.at("weights").at(2));
+
+				lstmDef.Layers.push_back(layerDef);
 			}
-		}
 
-		void Prewarm() override
-		{
-			model->Prewarm();
-		}
+			const size_t modelHiddenSize = layers.at(0).at("shape").back();
 
-	private:
-		ModelType* model = nullptr;
-	};
+			if (modelHiddenSize != HiddenSize)
+			{
+				LSTMDef paddedDef = PadLSTMDef(lstmDef, modelHiddenSize, HiddenSize);
 
+				model->SetWeights(paddedDef);
+			}
+			else
+			{
+				model->SetWeights(lstmDef);
+			}
 
-	class InternalWaveNetDefinitionBase
-	{
-	public:
-		virtual InternalModel* CreateModel()
-		{
-			return nullptr;
+			return true;
 		}
 
-		virtual size_t GetNumChannels()
+		void SetMaxAudioBufferSize(const int maxSize) override
 		{
-			return 0;
+			(void)maxSize;
 		}
 
-		virtual size_t GetHeadSize()
+		void Process(float* input, float* output, size_t numSamples) override
 		{
-			return 0;
+			model->Process(input, output, numSamples);
 		}
-	};
-
-	template <int NumChannels, int HeadSize>
-	class InternalA1WaveNetDefinitionT : public InternalWaveNetDefinitionBase
-	{
-	public:
-		using ModelType = typename std::conditional<NumChannels == 16,
-			NeuralAudio::WaveNetModelT<float,
-				NeuralAudio::WaveNetLayerArrayT<float, 1, 1, HeadSize, 1, 1, NumChannels, IStdKernelSizes, IStdDilations, false, EActivationType::Tanh>,
-				NeuralAudio::WaveNetLayerArrayT<float, NumChannels, 1, 1, 1, 1, HeadSize, IStdKernelSizes, IStdDilations, true, EActivationType::Tanh>>,
-			NeuralAudio::WaveNetModelT<float,
-				NeuralAudio::WaveNetLayerArrayT<float, 1, 1, HeadSize, 1, 1, NumChannels, ILiteKernelSizes1, ILiteDilations1, false, EActivationType::Tanh>,
-				NeuralAudio::WaveNetLayerArrayT<float, NumChannels, 1, 1, 1, 1, HeadSize, ILiteKernelSizes2, ILiteDilations2, true, EActivationType::Tanh>>
-			>::type;
 
-		InternalModel* CreateModel() override
+		void Prewarm() override
 		{
-			return new InternalWaveNetModelT<ModelType>;
+			NeuralModelImpl::Prewarm(2048, 64);
 		}
 
-		virtual size_t GetNumChannels() override
+		NeuralModelProcessor GetProcessor() override
 		{
-			return NumChannels;
+			return { model, [](void* instance, float* input, float* output, size_t numSamples)
+				{
+					static_cast<LSTMModelT<NumLayers, HiddenSize>*>(instance)->Process(input, output, numSamples);
+				} };
 		}
 
-		virtual size_t GetHeadSize() override
+		NeuralModelBatch* CreateBatch(size_t numInstances) override
 		{
-			return HeadSize;
-		}
-	};
+			if (model == nullptr)
+				return nullptr;
 
-	class InternalWaveNetModelDyn : public InternalModel
-	{
-	public:
-		InternalWaveNetModelDyn()
-		{
+			return new InternalLSTMBatchT<NumLayers, HiddenSize>(*model, numInstances);
 		}
 
-		~InternalWaveNetModelDyn()
+		NeuralModel* Clone() override
 		{
-			if (model != nullptr)
-			{
-				delete model;
-				model = nullptr;
-			}
+			if (model == nullptr)
+				return nullptr;
+
+			InternalLSTMModelT* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalLSTMModelT(*this);
+
+			clone->model->CopyState(*model);
+
+			return clone;
 		}
 
-		EModelLoadMode GetLoadMode() override
+		size_t ReserveClones(size_t numClones) override
 		{
-			return EModelLoadMode::Internal;
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalLSTMModelT(*this); });
 		}
 
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool ReleaseClone(NeuralModel* clone) override
 		{
-			auto& config = modelJson.at("config");
-
-			std::vector<WaveNetLayerArray> layerArrays;
+			auto lstmClone = dynamic_cast<InternalLSTMModelT*>(clone);
 
-			for (size_t i = 0; i < config.at("layers").size(); i++)
-			{
-				auto& layerConfig = config.at("layers").at(i);
+			if ((lstmClone == nullptr) || (lstmClone == this) || (model == nullptr) || (lstmClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
 
-				layerArrays.push_back(WaveNetLayerArray(layerConfig.at("input_size"), layerConfig.at("condition_size"), layerConfig.at("head_size"),
-					layerConfig.at("channels"), layerConfig.at("kernel_size"), layerConfig.at("head_bias"), layerConfig.at("dilations")));
-			}
+			return clonePool.Release(lstmClone);
+		}
 
-			model = new WaveNetModel(layerArrays);
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalLSTMModelT(const InternalLSTMModelT& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
 
-			model->SetWeights(modelJson.at("weights"));
+		LSTMModelT<NumLayers, HiddenSize>* model = nullptr;
+		ClonePool<InternalLSTMModelT> clonePool;
+	};
 
-			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
 
-			return true;
+	class InternalLSTMDefinitionBase
+	{
+	public:
+		virtual InternalModel* CreateModel()
+		{
+			return nullptr;
 		}
 
-		void SetMaxAudioBufferSize(const int maxSize) override
+		virtual size_t GetNumLayers()
 		{
-			model->SetMaxFrames(maxSize);
+			return 0;
 		}
 
-		void Process(float* input, float* output, size_t numSamples) override
+		virtual size_t GetHiddenSize()
 		{
-			size_t offset = 0;
+			return 0;
+		}
 
-			while (numSamples > 0)
-			{
-				size_t toProcess = std::min(numSamples, model->GetMaxFrames());
+		virtual size_t GetFLOPsPerSample()
+		{
+			return 0;
+		}
+	};
 
-				model->Process(input + offset, output + offset, toProcess);
+	template <int NumLayers, int HiddenSize>
+	class InternalLSTMDefinitionT : public InternalLSTMDefinitionBase
+	{
+	public:
+		InternalModel* CreateModel() override
+		{
+			return new InternalLSTMModelT<NumLayers, HiddenSize>;
+		}
 
-				offset += toProcess;
-				numSamples -= toProcess;
-			}
+		virtual size_t GetNumLayers() override
+		{
+			return NumLayers;
 		}
 
-		void Prewarm() override
+		virtual size_t GetHiddenSize() override
 		{
-			model->Prewarm();
+			return HiddenSize;
 		}
 
-	private:
-		WaveNetModel* model = nullptr;
+		virtual size_t GetFLOPsPerSample() override
+		{
+			return GetLSTMFLOPsPerSample(NumLayers, HiddenSize);
+		}
 	};
 
-
-	template <int NumLayers, int HiddenSize>
-	class InternalLSTMModelT : public InternalModel
+	class InternalLSTMModelDyn : public InternalModel
 	{
 	public:
-		InternalLSTMModelT()
+		InternalLSTMModelDyn()
 			: model(nullptr)
 		{
 		}
 
-		~InternalLSTMModelT()
+		~InternalLSTMModelDyn()
 		{
 			if (model != nullptr)
 			{
@@ -266,12 +1658,7 @@ namespace NeuralAudio
 			}
 		}
 
-		bool IsStatic() override
-		{
-			return true;
-		}
-
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
 		{
 			if (model != nullptr)
 			{
@@ -279,9 +1666,27 @@ namespace NeuralAudio
 				model = nullptr;
 			}
 
-			model = new LSTMModelT<NumLayers, HiddenSize>;
+			auto& config = modelJson.at("config");
+
+			const size_t numLayers = config.at("num_layers");
+
+			if (numLayers == 0)
+				throw std::runtime_error("LSTM model has no layers");
+
+			model = new LSTMModel(numLayers, config.at("hidden_size"));
+
+			const float* packedWeights = GetPackedWeights(modelJson.at("weights"), weights, model->GetWeightLayout());
+
+			if (packedWeights != nullptr)
+			{
+				model->SetSharedWeights(packedWeights, weights);	// Already in our layout, so used in place
+			}
+			else
+			{
+				std::vector<float> unpackedWeights;
 
-			model->SetNAMWeights(modelJson.at("weights"));
+				model->SetNAMWeights(GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights));
+			}
 
 			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
 
@@ -316,10 +1721,9 @@ namespace NeuralAudio
 				model = nullptr;
 			}
 
-			model = new LSTMModelT<NumLayers, HiddenSize>;
-
 			const auto layers = modelJson.at("layers");
 			const size_t numLayers = layers.size();
+			const size_t hiddenSize = layers.at(0).at("shape").back();
 
 			if (numLayers < 2)
 				return false;
@@ -329,6 +1733,8 @@ namespace NeuralAudio
 			if (lastLayer.at("type") != "dense")
 				return false;
 
+			model = new LSTMModel(numLayers - 1, hiddenSize);
+
 			LSTMDef lstmDef;
 
 			lstmDef.HeadWeights = FlattenWeights(lastLayer.at("weights").at(0));
@@ -370,12 +1776,176 @@ namespace NeuralAudio
 			NeuralModelImpl::Prewarm(2048, 64);
 		}
 
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalLSTMModelDyn* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalLSTMModelDyn(*this);
+
+			clone->model->CopyState(*model);
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalLSTMModelDyn(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto lstmClone = dynamic_cast<InternalLSTMModelDyn*>(clone);
+
+			if ((lstmClone == nullptr) || (lstmClone == this) || (model == nullptr) || (lstmClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(lstmClone);
+		}
+
 	private:
-		LSTMModelT<NumLayers, HiddenSize>* model = nullptr;
+		// Clone with shared weights and copied settings/metadata
+		InternalLSTMModelDyn(const InternalLSTMModelDyn& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
+
+		LSTMModel* model = nullptr;
+		ClonePool<InternalLSTMModelDyn> clonePool;
 	};
 
+	template <int NumLayers, int HiddenSize>
+	class InternalGRUModelT : public InternalModel
+	{
+	public:
+		InternalGRUModelT()
+			: model(nullptr)
+		{
+		}
+
+		~InternalGRUModelT()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+		}
+
+		bool IsStatic() override
+		{
+			return true;
+		}
 
-	class InternalLSTMDefinitionBase
+		bool CreateModelFromKerasJson(const nlohmann::json& modelJson) override
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+
+			GRUDef gruDef;
+
+			if (!ReadKerasGRUDef(modelJson, gruDef) || (gruDef.Layers.size() != NumLayers))
+				return false;
+
+			model = new GRUModelT<NumLayers, HiddenSize>;
+
+			const size_t modelHiddenSize = gruDef.HeadWeights.size();
+
+			// Smaller models are run zero-padded to our size
+			if (modelHiddenSize != HiddenSize)
+			{
+				GRUDef paddedDef = PadGRUDef(gruDef, modelHiddenSize, HiddenSize);
+
+				model->SetWeights(paddedDef);
+			}
+			else
+			{
+				model->SetWeights(gruDef);
+			}
+
+			return true;
+		}
+
+		void SetMaxAudioBufferSize(const int maxSize) override
+		{
+			(void)maxSize;
+		}
+
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			model->Process(input, output, numSamples);
+		}
+
+		void Prewarm() override
+		{
+			NeuralModelImpl::Prewarm(2048, 64);
+		}
+
+		NeuralModelProcessor GetProcessor() override
+		{
+			return { model, [](void* instance, float* input, float* output, size_t numSamples)
+				{
+					static_cast<GRUModelT<NumLayers, HiddenSize>*>(instance)->Process(input, output, numSamples);
+				} };
+		}
+
+		NeuralModel* Clone() override
+		{
+			if (model == nullptr)
+				return nullptr;
+
+			InternalGRUModelT* clone = clonePool.Take();
+
+			if (clone == nullptr)
+				clone = new InternalGRUModelT(*this);
+
+			clone->model->CopyState(*model);
+
+			return clone;
+		}
+
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
+
+			return clonePool.Reserve(numClones, [this] { return new InternalGRUModelT(*this); });
+		}
+
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto gruClone = dynamic_cast<InternalGRUModelT*>(clone);
+
+			if ((gruClone == nullptr) || (gruClone == this) || (model == nullptr) || (gruClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
+
+			return clonePool.Release(gruClone);
+		}
+
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalGRUModelT(const InternalGRUModelT& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
+
+		GRUModelT<NumLayers, HiddenSize>* model = nullptr;
+		ClonePool<InternalGRUModelT> clonePool;
+	};
+
+
+	class InternalGRUDefinitionBase
 	{
 	public:
 		virtual InternalModel* CreateModel()
@@ -392,15 +1962,20 @@ namespace NeuralAudio
 		{
 			return 0;
 		}
+
+		virtual size_t GetFLOPsPerSample()
+		{
+			return 0;
+		}
 	};
 
 	template <int NumLayers, int HiddenSize>
-	class InternalLSTMDefinitionT : public InternalLSTMDefinitionBase
+	class InternalGRUDefinitionT : public InternalGRUDefinitionBase
 	{
 	public:
 		InternalModel* CreateModel() override
 		{
-			return new InternalLSTMModelT<NumLayers, HiddenSize>;
+			return new InternalGRUModelT<NumLayers, HiddenSize>;
 		}
 
 		virtual size_t GetNumLayers() override
@@ -412,17 +1987,22 @@ namespace NeuralAudio
 		{
 			return HiddenSize;
 		}
+
+		virtual size_t GetFLOPsPerSample() override
+		{
+			return GetGRUFLOPsPerSample(NumLayers, HiddenSize);
+		}
 	};
 
-	class InternalLSTMModelDyn : public InternalModel
+	class InternalGRUModelDyn : public InternalModel
 	{
 	public:
-		InternalLSTMModelDyn()
+		InternalGRUModelDyn()
 			: model(nullptr)
 		{
 		}
 
-		~InternalLSTMModelDyn()
+		~InternalGRUModelDyn()
 		{
 			if (model != nullptr)
 			{
@@ -431,7 +2011,7 @@ namespace NeuralAudio
 			}
 		}
 
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool CreateModelFromKerasJson(const nlohmann::json& modelJson) override
 		{
 			if (model != nullptr)
 			{
@@ -439,85 +2019,118 @@ namespace NeuralAudio
 				model = nullptr;
 			}
 
-			auto& config = modelJson.at("config");
+			GRUDef gruDef;
 
-			model = new LSTMModel(config.at("num_layers"), config.at("hidden_size"));
+			if (!ReadKerasGRUDef(modelJson, gruDef))
+				return false;
 
-			model->SetNAMWeights(modelJson.at("weights"));
+			model = new GRUModel(gruDef.Layers.size(), gruDef.HeadWeights.size());
 
-			SetMaxAudioBufferSize(loader->GetDefaultMaxAudioBufferSize());
+			model->SetWeights(gruDef);
 
 			return true;
 		}
 
-		std::vector<float> FlattenWeights(const nlohmann::json& weights)
+		void SetMaxAudioBufferSize(const int maxSize) override
 		{
-			std::vector<float> vec;
+			(void)maxSize;
+		}
 
-			for (size_t i = 0; i < weights.size(); i++)
-			{
-				if (weights[i].is_array())
-				{
-					auto subVec = FlattenWeights(weights[i]);
-					vec.insert(vec.end(), subVec.begin(), subVec.end());
-				}
-				else
-				{
-					vec.push_back(weights[i]);
-				}
-			}
+		void Process(float* input, float* output, size_t numSamples) override
+		{
+			model->Process(input, output, numSamples);
+		}
 
-			return vec;
+		void Prewarm() override
+		{
+			NeuralModelImpl::Prewarm(2048, 64);
 		}
 
-		bool CreateModelFromKerasJson(const nlohmann::json& modelJson) override
+		NeuralModel* Clone() override
 		{
-			if (model != nullptr)
-			{
-				delete model;
-				model = nullptr;
-			}
+			if (model == nullptr)
+				return nullptr;
 
-			const auto layers = modelJson.at("layers");
-			const size_t numLayers = layers.size();
-			const size_t hiddenSize = layers.at(0).at("shape").back();
+			InternalGRUModelDyn* clone = clonePool.Take();
 
-			if (numLayers < 2)
-				return false;
+			if (clone == nullptr)
+				clone = new InternalGRUModelDyn(*this);
 
-			auto lastLayer = layers[numLayers - 1];
+			clone->model->CopyState(*model);
 
-			if (lastLayer.at("type") != "dense")
-				return false;
+			return clone;
+		}
 
-			model = new LSTMModel(numLayers - 1, hiddenSize);
+		size_t ReserveClones(size_t numClones) override
+		{
+			if (model == nullptr)
+				return 0;
 
-			LSTMDef lstmDef;
+			return clonePool.Reserve(numClones, [this] { return new InternalGRUModelDyn(*this); });
+		}
 
-			lstmDef.HeadWeights = FlattenWeights(lastLayer.at("weights").at(0));
-			lstmDef.HeadBias = lastLayer.at("weights").at(1).at(0);
+		bool ReleaseClone(NeuralModel* clone) override
+		{
+			auto gruClone = dynamic_cast<InternalGRUModelDyn*>(clone);
 
-			for (size_t i = 0; i < (numLayers - 1); i++)
-			{
-				auto layer = layers[i];
+			if ((gruClone == nullptr) || (gruClone == this) || (model == nullptr) || (gruClone->model->GetSharedWeights() != model->GetSharedWeights()))
+				return false;
 
-				if (layer.at("type") != "lstm")
-					return false;
+			return clonePool.Release(gruClone);
+		}
 
-				LSTMLayerDef layerDef;
+	private:
+		// Clone with shared weights and copied settings/metadata
+		InternalGRUModelDyn(const InternalGRUModelDyn& other) :
+			InternalModel(other),
+			model(other.model->CreateSharedInstance())
+		{
+		}
 
-				layerDef.InputWeights = FlattenWeights(layer.at("weights").at(0));
-				layerDef.HiddenWeights = FlattenWeights(layer.at("weights").at(1));
-				layerDef.BiasWeights = FlattenWeights(layer.at("weights").at(2));
+		GRUModel* model = nullptr;
+		ClonePool<InternalGRUModelDyn> clonePool;
+	};
 
-				lstmDef.Layers.push_back(layerDef);
+	class InternalKerasModelDyn : public InternalModel
+	{
+	public:
+		InternalKerasModelDyn()
+			: model(nullptr)
+		{
+		}
+
+		~InternalKerasModelDyn()
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
 			}
+		}
 
-			model->SetWeights(lstmDef);
+		bool CreateModelFromKerasJson(const nlohmann::json& modelJson) override
+		{
+			if (model != nullptr)
+			{
+				delete model;
+				model = nullptr;
+			}
+
+			KerasModelDef modelDef;
+
+			if (!ReadKerasModelDef(modelJson, modelDef))
+				return false;
+
+			model = new KerasModel(modelDef);
 
 			return true;
 		}
 
+		int GetReceptiveFieldSize() override
+		{
+			return (int)model->GetReceptiveFieldSize();
+		}
+
 		void SetMaxAudioBufferSize(const int maxSize) override
 		{
 			(void)maxSize;
@@ -530,12 +2143,11 @@ namespace NeuralAudio
 
 		void Prewarm() override
 		{
-			NeuralModelImpl::Prewarm(2048, 64);
+			// Fill the convolution history
+			NeuralModelImpl::Prewarm(std::max((size_t)2048, model->GetReceptiveFieldSize() + 64), 64);
 		}
 
 	private:
-		LSTMModel* model = nullptr;
+		KerasModel* model = nullptr;
 	};
 }
-
-
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <Eigen/Dense>
+#include "Activation.h"
+#include "MatMul.h"
+
+#ifndef KERAS_MAX_NUM_FRAMES
+#define KERAS_MAX_NUM_FRAMES 64
+#endif
+
+// Number of blocks of input history kept before it is rewound to the start of the buffer
+#ifndef KERAS_HISTORY_BLOCKS
+#define KERAS_HISTORY_BLOCKS 16
+#endif
+
+namespace NeuralAudio
+{
+	enum class EKerasActivation
+	{
+		Linear,
+		Tanh,
+		ReLU,
+		Sigmoid,
+		ELU
+	};
+
+	// A keras conv1d or dense layer (a dense layer is a conv1d with a kernel size of 1) with its activation
+	struct KerasLayerDef
+	{
+		size_t InSize;
+		size_t OutSize;
+		size_t KernelSize = 1;
+		size_t Dilation = 1;
+		std::vector<float> Weights;	// Keras layout - [kernel][in][out]
+		std::vector<float> Bias;	// Empty if the layer has no bias
+		EKerasActivation Activation = EKerasActivation::Linear;
+	};
+
+	struct KerasModelDef
+	{
+		std::vector<KerasLayerDef> Layers;
+	};
+
+	inline void ApplyKerasActivation(float* data, const size_t size, const EKerasActivation activation)
+	{
+		switch (activation)
+		{
+			case EKerasActivation::Tanh:
+				WAVENET_MATH<float>::Tanh(data, size);
+				break;
+
+			case EKerasActivation::Sigmoid:
+				WAVENET_MATH<float>::Sigmoid(data, size);
+				break;
+
+			case EKerasActivation::ReLU:
+				for (size_t i = 0; i < size; i++)
+					data[i] = std::max(data[i], 0.0f);
+				break;
+
+			case EKerasActivation::ELU:
+				for (size_t i = 0; i < size; i++)
+					data[i] = (data[i] > 0) ? data[i] : (std::exp(data[i]) - 1);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// Zero-pad a layer to larger input and output sizes. Padded outputs only feed zero weights in the next layer,
+	// so they don't change the output whatever the activation does to them.
+	inline KerasLayerDef PadKerasLayerDef(const KerasLayerDef& def, size_t paddedInSize, size_t paddedOutSize)
+	{
+		KerasLayerDef padded = def;
+
+		padded.InSize = paddedInSize;
+		padded.OutSize = paddedOutSize;
+		padded.Weights.assign(def.KernelSize * paddedInSize * paddedOutSize, 0.0f);
+
+		for (size_t k = 0; k < def.KernelSize; k++)
+			for (size_t j = 0; j < def.InSize; j++)
+				for (size_t i = 0; i < def.OutSize; i++)
+					padded.Weights[(((k * paddedInSize) + j) * paddedOutSize) + i] = def.Weights[(((k * def.InSize) + j) * def.OutSize) + i];
+
+		if (!def.Bias.empty())
+			padded.Bias.resize(paddedOutSize, 0.0f);
+
+		return padded;
+	}
+
+	// Causal dilated convolution over a block of frames. Kernel tap 0 is the oldest input, as in keras.
+	template<int InSize, int OutSize>
+	class KerasConv1DLayerT
+	{
+	private:
+		size_t kernelSize = 1;
+		size_t dilation = 1;
+		size_t receptiveFieldSize = 0;
+		EKerasActivation activation = EKerasActivation::Linear;
+		std::vector<Eigen::Matrix<float, OutSize, InSize>> weights;
+		Eigen::Vector<float, OutSize> bias;
+		Eigen::Matrix<float, InSize, Eigen::Dynamic> history;	// Only used if the layer has a receptive field
+		size_t historyStart = 0;
+		Eigen::Matrix<float, OutSize, KERAS_MAX_NUM_FRAMES> outputs;
+
+	public:
+		const float* GetOutputs() const { return outputs.data(); }
+
+		size_t GetReceptiveFieldSize() const
+		{
+			return receptiveFieldSize;
+		}
+
+		void SetWeights(const KerasLayerDef& def)
+		{
+			kernelSize = def.KernelSize;
+			dilation = def.Dilation;
+			receptiveFieldSize = (kernelSize - 1) * dilation;
+			activation = def.Activation;
+
+			weights.resize(kernelSize);
+
+			for (size_t k = 0; k < kernelSize; k++)
+				for (int j = 0; j < InSize; j++)
+					for (int i = 0; i < OutSize; i++)
+						weights[k](i, j) = def.Weights[(((k * InSize) + j) * OutSize) + i];
+
+			for (int i = 0; i < OutSize; i++)
+				bias[i] = def.Bias.empty() ? 0 : def.Bias[i];
+
+			if (receptiveFieldSize > 0)
+			{
+				history.setZero(InSize, receptiveFieldSize + (KERAS_HISTORY_BLOCKS * KERAS_MAX_NUM_FRAMES));
+				historyStart = receptiveFieldSize;
+			}
+		}
+
+		// Input is InSize x numFrames (column major), numFrames <= KERAS_MAX_NUM_FRAMES
+		void Process(const float* input, const size_t numFrames)
+		{
+			auto inputMap = Eigen::Map<const Eigen::Matrix<float, InSize, Eigen::Dynamic>>(input, InSize, numFrames);
+			auto outputMap = outputs.leftCols(numFrames);
+
+			if (receptiveFieldSize == 0)
+			{
+				if constexpr (MatMul<float, InSize, OutSize>::HasKernel())
+				{
+					MatMul<float, InSize, OutSize>::MultiplyInitColwise(input, outputs.data(), weights[0].data(), bias.data(), numFrames);
+				}
+				else
+				{
+					outputMap.noalias() = weights[0] * inputMap;
+					outputMap.colwise() += bias;
+				}
+			}
+			else
+			{
+				history.middleCols(historyStart, numFrames) = inputMap;
+
+				for (size_t k = 0; k < kernelSize; k++)
+				{
+					const size_t start = historyStart - ((kernelSize - 1 - k) * dilation);
+
+					if constexpr (MatMul<float, InSize, OutSize>::HasKernel())
+					{
+						if (k == 0)
+							MatMul<float, InSize, OutSize>::MultiplyInitColwise(history.col(start).data(), outputs.data(), weights[k].data(), bias.data(), numFrames);
+						else
+							MatMul<float, InSize, OutSize>::MultiplyAccumlulate(history.col(start).data(), outputs.data(), weights[k].data(), numFrames);
+					}
+					else
+					{
+						if (k == 0)
+							outputMap.noalias() = weights[k] * history.middleCols(start, numFrames);
+						else
+							outputMap.noalias() += weights[k] * history.middleCols(start, numFrames);
+					}
+				}
+
+				if constexpr (!MatMul<float, InSize, OutSize>::HasKernel())
+					outputMap.colwise() += bias;
+
+				historyStart += numFrames;
+
+				if ((historyStart + KERAS_MAX_NUM_FRAMES) > (size_t)history.cols())
+				{
+					history.leftCols(receptiveFieldSize) = history.middleCols(historyStart - receptiveFieldSize, receptiveFieldSize).eval();
+					historyStart = receptiveFieldSize;
+				}
+			}
+
+			ApplyKerasActivation(outputs.data(), OutSize * numFrames, activation);
+		}
+	};
+}
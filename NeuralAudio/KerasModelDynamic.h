@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <Eigen/Dense>
+#include "KerasModel.h"
+
+// Layer sizes up to this are rounded up to a multiple of KERAS_BUCKET_SIZE_STEP and run with fixed-size kernels
+#ifndef KERAS_BUCKET_MAX_SIZE
+#define KERAS_BUCKET_MAX_SIZE 16
+#endif
+
+#ifndef KERAS_BUCKET_SIZE_STEP
+#define KERAS_BUCKET_SIZE_STEP 4
+#endif
+
+namespace NeuralAudio
+{
+	class KerasLayerBase
+	{
+	public:
+		virtual ~KerasLayerBase()
+		{
+		}
+
+		virtual const float* GetOutputs() const = 0;
+		virtual size_t GetReceptiveFieldSize() const = 0;
+		virtual void SetWeights(const KerasLayerDef& def) = 0;
+		virtual void Process(const float* input, const size_t numFrames) = 0;
+	};
+
+	// Fixed-size layer used for bucketed layer sizes
+	template<int InSize, int OutSize>
+	class KerasBucketLayerT : public KerasLayerBase
+	{
+	private:
+		KerasConv1DLayerT<InSize, OutSize> layer;
+
+	public:
+		const float* GetOutputs() const override { return layer.GetOutputs(); }
+		size_t GetReceptiveFieldSize() const override { return layer.GetReceptiveFieldSize(); }
+
+		void SetWeights(const KerasLayerDef& def) override
+		{
+			layer.SetWeights(def);
+		}
+
+		void Process(const float* input, const size_t numFrames) override
+		{
+			layer.Process(input, numFrames);
+		}
+	};
+
+	class KerasConv1DLayer : public KerasLayerBase
+	{
+	private:
+		size_t inSize;
+		size_t outSize;
+		size_t kernelSize = 1;
+		size_t dilation = 1;
+		size_t receptiveFieldSize = 0;
+		EKerasActivation activation = EKerasActivation::Linear;
+		std::vector<Eigen::MatrixXf> weights;
+		Eigen::VectorXf bias;
+		Eigen::MatrixXf history;
+		size_t historyStart = 0;
+		Eigen::MatrixXf outputs;
+
+	public:
+		KerasConv1DLayer(size_t inSize, size_t outSize) :
+			inSize(inSize),
+			outSize(outSize),
+			bias(outSize),
+			outputs(outSize, KERAS_MAX_NUM_FRAMES)
+		{
+		}
+
+		const float* GetOutputs() const override { return outputs.data(); }
+
+		size_t GetReceptiveFieldSize() const override
+		{
+			return receptiveFieldSize;
+		}
+
+		void SetWeights(const KerasLayerDef& def) override
+		{
+			kernelSize = def.KernelSize;
+			dilation = def.Dilation;
+			receptiveFieldSize = (kernelSize - 1) * dilation;
+			activation = def.Activation;
+
+			weights.resize(kernelSize, Eigen::MatrixXf(outSize, inSize));
+
+			for (size_t k = 0; k < kernelSize; k++)
+				for (size_t j = 0; j < inSize; j++)
+					for (size_t i = 0; i < outSize; i++)
+						weights[k](i, j) = def.Weights[(((k * inSize) + j) * outSize) + i];
+
+			for (size_t i = 0; i < outSize; i++)
+				bias[i] = def.Bias.empty() ? 0 : def.Bias[i];
+
+			if (receptiveFieldSize > 0)
+			{
+				history.setZero(inSize, receptiveFieldSize + (KERAS_HISTORY_BLOCKS * KERAS_MAX_NUM_FRAMES));
+				historyStart = receptiveFieldSize;
+			}
+		}
+
+		// Input is inSize x numFrames (column major), numFrames <= KERAS_MAX_NUM_FRAMES
+		void Process(const float* input, const size_t numFrames) override
+		{
+			auto inputMap = Eigen::Map<const Eigen::MatrixXf>(input, inSize, numFrames);
+			auto outputMap = outputs.leftCols(numFrames);
+
+			if (receptiveFieldSize == 0)
+			{
+				outputMap.noalias() = weights[0] * inputMap;
+			}
+			else
+			{
+				history.middleCols(historyStart, numFrames) = inputMap;
+
+				for (size_t k = 0; k < kernelSize; k++)
+				{
+					const size_t start = historyStart - ((kernelSize - 1 - k) * dilation);
+
+					if (k == 0)
+						outputMap.noalias() = weights[k] * history.middleCols(start, numFrames);
+					else
+						outputMap.noalias() += weights[k] * history.middleCols(start, numFrames);
+				}
+
+				historyStart += numFrames;
+
+				if ((historyStart + KERAS_MAX_NUM_FRAMES) > (size_t)history.cols())
+				{
+					history.leftCols(receptiveFieldSize) = history.middleCols(historyStart - receptiveFieldSize, receptiveFieldSize).eval();
+					historyStart = receptiveFieldSize;
+				}
+			}
+
+			outputMap.colwise() += bias;
+
+			ApplyKerasActivation(outputs.data(), outSize * numFrames, activation);
+		}
+	};
+
+	// Sequential stack of keras conv1d/dense layers with a single input and output
+	class KerasModel
+	{
+	private:
+		std::vector<std::unique_ptr<KerasLayerBase>> layers;
+		size_t receptiveFieldSize = 0;
+
+	public:
+		static size_t GetBucketSize(size_t size)
+		{
+			if ((size == 1) || (size > KERAS_BUCKET_MAX_SIZE))
+				return size;
+
+			return ((size + KERAS_BUCKET_SIZE_STEP - 1) / KERAS_BUCKET_SIZE_STEP) * KERAS_BUCKET_SIZE_STEP;
+		}
+
+		KerasModel(const KerasModelDef& def)
+		{
+			size_t inSize = 1;
+
+			for (size_t i = 0; i < def.Layers.size(); i++)
+			{
+				const KerasLayerDef& layerDef = def.Layers[i];
+
+				// The model input and output are never padded
+				const size_t outSize = (i == (def.Layers.size() - 1)) ? layerDef.OutSize : GetBucketSize(layerDef.OutSize);
+
+				layers.push_back(CreateLayer(inSize, outSize));
+
+				if ((inSize != layerDef.InSize) || (outSize != layerDef.OutSize))
+					layers.back()->SetWeights(PadKerasLayerDef(layerDef, inSize, outSize));
+				else
+					layers.back()->SetWeights(layerDef);
+
+				receptiveFieldSize += layers.back()->GetReceptiveFieldSize();
+
+				inSize = outSize;
+			}
+		}
+
+		size_t GetReceptiveFieldSize() const
+		{
+			return receptiveFieldSize;
+		}
+
+		void Process(const float* input, float* output, size_t numSamples)
+		{
+			while (numSamples > 0)
+			{
+				size_t numFrames = std::min(numSamples, (size_t)KERAS_MAX_NUM_FRAMES);
+
+				layers[0]->Process(input, numFrames);
+
+				for (size_t layer = 1; layer < layers.size(); layer++)
+				{
+					layers[layer]->Process(layers[layer - 1]->GetOutputs(), numFrames);
+				}
+
+				std::memcpy(output, layers.back()->GetOutputs(), numFrames * sizeof(float));
+
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		static constexpr int NextBucketSize(int size)
+		{
+			return (size == 1) ? KERAS_BUCKET_SIZE_STEP : (size + KERAS_BUCKET_SIZE_STEP);
+		}
+
+		template<int InSize, int OutSize = 1>
+		static KerasLayerBase* CreateBucketLayerForOutput(size_t outSize)
+		{
+			if constexpr (OutSize > KERAS_BUCKET_MAX_SIZE)
+			{
+				return nullptr;
+			}
+			else
+			{
+				if (outSize != OutSize)
+					return CreateBucketLayerForOutput<InSize, NextBucketSize(OutSize)>(outSize);
+
+				return new KerasBucketLayerT<InSize, OutSize>;
+			}
+		}
+
+		template<int InSize = 1>
+		static KerasLayerBase* CreateBucketLayer(size_t inSize, size_t outSize)
+		{
+			if constexpr (InSize > KERAS_BUCKET_MAX_SIZE)
+			{
+				return nullptr;
+			}
+			else
+			{
+				if (inSize != InSize)
+					return CreateBucketLayer<NextBucketSize(InSize)>(inSize, outSize);
+
+				return CreateBucketLayerForOutput<InSize>(outSize);
+			}
+		}
+
+		static std::unique_ptr<KerasLayerBase> CreateLayer(size_t inSize, size_t outSize)
+		{
+			KerasLayerBase* layer = CreateBucketLayer(inSize, outSize);
+
+			if (layer == nullptr)
+				layer = new KerasConv1DLayer(inSize, outSize);
+
+			return std::unique_ptr<KerasLayerBase>(layer);
+		}
+	};
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include "KernelTuning.h"
+#include "NeuralModelImpl.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+namespace NeuralAudio
+{
+	static std::mutex tuningCacheMutex;
+	static nlohmann::json tuningCacheJson;
+	static std::filesystem::path tuningCachePath;
+	static bool tuningCacheIsLoaded = false;
+
+	static std::string TrimString(const std::string& str)
+	{
+		size_t start = str.find_first_not_of(" \t");
+
+		if (start == std::string::npos)
+			return "";
+
+		size_t end = str.find_last_not_of(" \t\r\n");
+
+		return str.substr(start, end - start + 1);
+	}
+
+	std::string GetCPUModelName()
+	{
+		std::string name;
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int regs[4];
+		char brand[49] = { 0 };
+
+		__cpuid(regs, 0x80000000);
+
+		if ((unsigned int)regs[0] >= 0x80000004)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				__cpuid(regs, 0x80000002 + i);
+				std::memcpy(brand + (i * 16), regs, sizeof(regs));
+			}
+
+			name = brand;
+		}
+#elif defined(__x86_64__) || defined(__i386__)
+		unsigned int regs[4];
+		char brand[49] = { 0 };
+
+		if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004)
+		{
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				__get_cpuid(0x80000002 + i, &regs[0], &regs[1], &regs[2], &regs[3]);
+				std::memcpy(brand + (i * 16), regs, sizeof(regs));
+			}
+
+			name = brand;
+		}
+#elif defined(__APPLE__)
+		char brand[256] = { 0 };
+		size_t size = sizeof(brand);
+
+		if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0)
+			name = brand;
+#elif defined(__linux__)
+		// ARM cpuinfo has no "model name" on most kernels, so fall back to the implementer/part ids
+		std::ifstream cpuInfo("/proc/cpuinfo");
+		std::string line;
+		std::string implementer, part;
+
+		while (std::getline(cpuInfo, line))
+		{
+			size_t colon = line.find(':');
+
+			if (colon == std::string::npos)
+				continue;
+
+			std::string key = TrimString(line.substr(0, colon));
+			std::string value = TrimString(line.substr(colon + 1));
+
+			if ((key == "model name") || (key == "Model"))
+			{
+				name = value;
+
+				break;
+			}
+			else if (key == "CPU implementer")
+			{
+				implementer = value;
+			}
+			else if (key == "CPU part")
+			{
+				part = value;
+			}
+		}
+
+		if (name.empty() && !implementer.empty())
+			name = "ARM " + implementer + ":" + part;
+#endif
+
+		name = TrimString(name);
+
+		if (name.empty())
+			name = "Unknown";
+
+		return name;
+	}
+
+	static void EnsureTuningCacheIsLoaded(const std::filesystem::path& cachePath)
+	{
+		if (tuningCacheIsLoaded && (cachePath == tuningCachePath))
+			return;
+
+		tuningCacheJson = nlohmann::json::object();
+		tuningCachePath = cachePath;
+		tuningCacheIsLoaded = true;
+
+		if (cachePath.empty() || !std::filesystem::exists(cachePath))
+			return;
+
+		try
+		{
+			std::ifstream jsonStream(cachePath, std::ifstream::binary);
+
+			jsonStream >> tuningCacheJson;
+
+			if (!tuningCacheJson.is_object())
+				tuningCacheJson = nlohmann::json::object();
+		}
+		catch (const std::exception&)
+		{
+			// A corrupt cache just means we tune again
+			tuningCacheJson = nlohmann::json::object();
+		}
+	}
+
+	static void SaveTuningCache()
+	{
+		if (tuningCachePath.empty())
+			return;
+
+		std::error_code error;
+
+		if (tuningCachePath.has_parent_path())
+			std::filesystem::create_directories(tuningCachePath.parent_path(), error);
+
+		std::ofstream jsonStream(tuningCachePath, std::ofstream::binary | std::ofstream::trunc);
+
+		if (jsonStream)
+			jsonStream << tuningCacheJson.dump(1, '\t');
+	}
+
+	bool FindKernelTuning(const std::filesystem::path& cachePath, const std::string& architectureSignature, KernelTuning& tuning)
+	{
+		std::lock_guard<std::mutex> lock(tuningCacheMutex);
+
+		EnsureTuningCacheIsLoaded(cachePath);
+
+		auto cpuIt = tuningCacheJson.find(GetCPUModelName());
+
+		if ((cpuIt == tuningCacheJson.end()) || !cpuIt->is_object())
+			return false;
+
+		auto archIt = cpuIt->find(architectureSignature);
+
+		if ((archIt == cpuIt->end()) || !archIt->is_object())
+			return false;
+
+		tuning.ConvolutionTileSize = archIt->value("conv_tile_size", 0);
+		tuning.FrameChunkSize = archIt->value("frame_chunk_size", 0);
+
+		return true;
+	}
+
+	void StoreKernelTuning(const std::filesystem::path& cachePath, const std::string& architectureSignature, const KernelTuning& tuning)
+	{
+		std::lock_guard<std::mutex> lock(tuningCacheMutex);
+
+		EnsureTuningCacheIsLoaded(cachePath);
+
+		auto& archJson = tuningCacheJson[GetCPUModelName()][architectureSignature];
+
+		archJson["conv_tile_size"] = tuning.ConvolutionTileSize;
+		archJson["frame_chunk_size"] = tuning.FrameChunkSize;
+
+		SaveTuningCache();
+	}
+
+	bool FindAutoLoadMode(const std::filesystem::path& cachePath, const std::string& autoLoadKey, int& loadMode)
+	{
+		std::lock_guard<std::mutex> lock(tuningCacheMutex);
+
+		EnsureTuningCacheIsLoaded(cachePath);
+
+		auto cpuIt = tuningCacheJson.find(GetCPUModelName());
+
+		if ((cpuIt == tuningCacheJson.end()) || !cpuIt->is_object())
+			return false;
+
+		auto modesIt = cpuIt->find("auto_load_modes");
+
+		if ((modesIt == cpuIt->end()) || !modesIt->is_object())
+			return false;
+
+		auto modeIt = modesIt->find(autoLoadKey);
+
+		if ((modeIt == modesIt->end()) || !modeIt->is_number_integer())
+			return false;
+
+		loadMode = modeIt->get<int>();
+
+		return true;
+	}
+
+	void StoreAutoLoadMode(const std::filesystem::path& cachePath, const std::string& autoLoadKey, int loadMode)
+	{
+		std::lock_guard<std::mutex> lock(tuningCacheMutex);
+
+		EnsureTuningCacheIsLoaded(cachePath);
+
+		tuningCacheJson[GetCPUModelName()]["auto_load_modes"][autoLoadKey] = loadMode;
+
+		SaveTuningCache();
+	}
+
+	double TimeModelProcessing(NeuralModel* model, const float* input, float* output, size_t numSamples, size_t blockSize)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t offset = 0; offset < numSamples; offset += blockSize)
+		{
+			model->Process(const_cast<float*>(input + offset), output + offset, std::min(blockSize, numSamples - offset));
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	KernelTuning BenchmarkKernelTuning(NeuralModelImpl* model, const std::vector<KernelTuning>& candidates, size_t blockSize)
+	{
+		const size_t numBenchSamples = 4096;
+		const int numReps = 3;
+		const double minImprovement = 0.97;	// Only move away from the default for a clear win
+
+		if (candidates.empty())
+			return KernelTuning();
+
+		if (blockSize == 0)
+			blockSize = 128;
+
+		size_t numSamples = std::max(blockSize, numBenchSamples);
+
+		std::vector<float> input(numSamples, 0.0f);
+		std::vector<float> output(numSamples);
+
+		KernelTuning bestTuning = candidates[0];
+		double bestTime = 0;
+
+		for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+		{
+			model->SetKernelTuning(candidates[candidate]);
+
+			// Warm up caches before timing
+			model->Process(input.data(), output.data(), blockSize);
+
+			double minTime = 0;
+
+			for (int rep = 0; rep < numReps; rep++)
+			{
+				double time = TimeModelProcessing(model, input.data(), output.data(), numSamples, blockSize);
+
+				if ((rep == 0) || (time < minTime))
+					minTime = time;
+			}
+
+			if (candidate == 0)
+			{
+				bestTime = minTime;
+			}
+			else if (minTime < (bestTime * minImprovement))
+			{
+				bestTime = minTime;
+				bestTuning = candidates[candidate];
+			}
+		}
+
+		return bestTuning;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace NeuralAudio
+{
+	// Kernel variants that can be switched at runtime
+	struct KernelTuning
+	{
+		int ConvolutionTileSize = 0;	// Multi-frame convolution tile size (0 disables multi-frame convolution)
+		int FrameChunkSize = 0;			// Number of frames processed per internal WaveNet call (0 uses the default)
+
+		bool operator==(const KernelTuning& other) const
+		{
+			return (ConvolutionTileSize == other.ConvolutionTileSize) && (FrameChunkSize == other.FrameChunkSize);
+		}
+	};
+
+	class NeuralModel;
+	class NeuralModelImpl;
+
+	// Returns a description of the running CPU, used to key the tuning cache
+	std::string GetCPUModelName();
+
+	// Look up a previously stored tuning for an architecture on this CPU. An empty cache path uses an in-memory cache only.
+	bool FindKernelTuning(const std::filesystem::path& cachePath, const std::string& architectureSignature, KernelTuning& tuning);
+	void StoreKernelTuning(const std::filesystem::path& cachePath, const std::string& architectureSignature, const KernelTuning& tuning);
+
+	// Look up a previously stored EModelLoadMode::Auto backend choice for a model architecture on this CPU. Uses the same cache as kernel tunings.
+	bool FindAutoLoadMode(const std::filesystem::path& cachePath, const std::string& autoLoadKey, int& loadMode);
+	void StoreAutoLoadMode(const std::filesystem::path& cachePath, const std::string& autoLoadKey, int loadMode);
+
+	// Returns the time (in seconds) taken to process the input in blocks of blockSize
+	double TimeModelProcessing(NeuralModel* model, const float* input, float* output, size_t numSamples, size_t blockSize);
+
+	// Time each candidate on the model and return the fastest. The first candidate is treated as the default.
+	KernelTuning BenchmarkKernelTuning(NeuralModelImpl* model, const std::vector<KernelTuning>& candidates, size_t blockSize);
+}
@@ -1,8 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 #include <Eigen/Dense>
 #include "Activation.h"
 #include "TemplateHelper.h"
+#include "WeightLayout.h"
+
+#ifndef LSTM_MAX_NUM_FRAMES
+#define LSTM_MAX_NUM_FRAMES 64
+#endif
+
+// Largest hidden size that uses the small (register-resident) step kernel
+#ifndef LSTM_SMALL_KERNEL_MAX_HIDDEN
+#define LSTM_SMALL_KERNEL_MAX_HIDDEN 16
+#endif
 
 namespace NeuralAudio
 {
@@ -20,94 +38,438 @@ namespace NeuralAudio
 		float HeadBias;
 	};
 
+	// Gates are stored in i, f, o, g order (PyTorch and Keras use i, f, g, o) so that the sigmoid gates are contiguous
+	inline int LSTMGateRow(int row, int hiddenSize)
+	{
+		if (row < (2 * hiddenSize))
+			return row;
+
+		if (row < (3 * hiddenSize))
+			return row + hiddenSize;	// g
+
+		return row - hiddenSize;	// o
+	}
+
+	// Zero-pad NAM LSTM weights to a larger hidden size. Padded units have zero weights, bias and initial state, so their
+	// cell and hidden state stay at zero and the padded model produces exactly the same output.
+	inline std::vector<float> PadLSTMNAMWeights(std::span<const float> weights, size_t numLayers, size_t hiddenSize, size_t paddedHiddenSize)
+	{
+		std::vector<float> padded;
+		auto it = weights.begin();
+
+		for (size_t layer = 0; layer < numLayers; layer++)
+		{
+			const size_t inputSize = (layer == 0) ? 1 : hiddenSize;
+			const size_t paddedInputSize = (layer == 0) ? 1 : paddedHiddenSize;
+
+			for (size_t gate = 0; gate < 4; gate++)
+			{
+				for (size_t unit = 0; unit < paddedHiddenSize; unit++)
+				{
+					if (unit < hiddenSize)
+					{
+						padded.insert(padded.end(), it, it + inputSize);
+						padded.insert(padded.end(), paddedInputSize - inputSize, 0.0f);
+						it += inputSize;
+
+						padded.insert(padded.end(), it, it + hiddenSize);
+						padded.insert(padded.end(), paddedHiddenSize - hiddenSize, 0.0f);
+						it += hiddenSize;
+					}
+					else
+					{
+						padded.insert(padded.end(), paddedInputSize + paddedHiddenSize, 0.0f);
+					}
+				}
+			}
+
+			// Bias, then initial hidden and cell state
+			for (size_t vec = 0; vec < 6; vec++)
+			{
+				padded.insert(padded.end(), it, it + hiddenSize);
+				padded.insert(padded.end(), paddedHiddenSize - hiddenSize, 0.0f);
+				it += hiddenSize;
+			}
+		}
+
+		// Head weights and bias
+		padded.insert(padded.end(), it, it + hiddenSize);
+		padded.insert(padded.end(), paddedHiddenSize - hiddenSize, 0.0f);
+		it += hiddenSize;
+
+		padded.insert(padded.end(), it, weights.end());
+
+		return padded;
+	}
+
+	// Keras layout - numCols x (4 x hiddenSize) gates
+	inline std::vector<float> PadLSTMGateMatrix(const std::vector<float>& weights, size_t numCols, size_t paddedNumCols, size_t hiddenSize, size_t paddedHiddenSize)
+	{
+		std::vector<float> padded(paddedNumCols * 4 * paddedHiddenSize, 0.0f);
+
+		for (size_t col = 0; col < numCols; col++)
+		{
+			for (size_t gate = 0; gate < 4; gate++)
+			{
+				for (size_t unit = 0; unit < hiddenSize; unit++)
+				{
+					padded[(col * 4 * paddedHiddenSize) + (gate * paddedHiddenSize) + unit] = weights[(col * 4 * hiddenSize) + (gate * hiddenSize) + unit];
+				}
+			}
+		}
+
+		return padded;
+	}
+
+	inline LSTMDef PadLSTMDef(const LSTMDef& def, size_t hiddenSize, size_t paddedHiddenSize)
+	{
+		LSTMDef padded;
+
+		for (size_t layer = 0; layer < def.Layers.size(); layer++)
+		{
+			const LSTMLayerDef& layerDef = def.Layers[layer];
+			LSTMLayerDef paddedLayerDef;
+
+			const size_t inputSize = (layer == 0) ? 1 : hiddenSize;
+			const size_t paddedInputSize = (layer == 0) ? 1 : paddedHiddenSize;
+
+			paddedLayerDef.InputWeights = PadLSTMGateMatrix(layerDef.InputWeights, inputSize, paddedInputSize, hiddenSize, paddedHiddenSize);
+			paddedLayerDef.HiddenWeights = PadLSTMGateMatrix(layerDef.HiddenWeights, hiddenSize, paddedHiddenSize, hiddenSize, paddedHiddenSize);
+			paddedLayerDef.BiasWeights = PadLSTMGateMatrix(layerDef.BiasWeights, 1, 1, hiddenSize, paddedHiddenSize);
+
+			padded.Layers.push_back(paddedLayerDef);
+		}
+
+		padded.HeadWeights = def.HeadWeights;
+		padded.HeadWeights.resize(paddedHiddenSize, 0.0f);
+		padded.HeadBias = def.HeadBias;
+
+		return padded;
+	}
+
+	// Approximate cost of running an LSTM model, used to choose between model implementations
+	inline size_t GetLSTMFLOPsPerSample(size_t numLayers, size_t hiddenSize)
+	{
+		size_t flops = 0;
+
+		for (size_t layer = 0; layer < numLayers; layer++)
+		{
+			const size_t inputSize = (layer == 0) ? 1 : hiddenSize;
+
+			flops += 2 * (4 * hiddenSize) * (inputSize + hiddenSize);
+		}
+
+		return flops + (2 * hiddenSize);
+	}
+
+	// Layout of the packed weights of a layer - the gate rows of the input and hidden weights (a column-major
+	// (4 x hiddenSize) x (inputSize + hiddenSize) matrix), the bias, then the initial hidden and cell state
+	inline void AddLSTMLayerWeightLayout(WeightLayout& layout, size_t inputSize, size_t hiddenSize)
+	{
+		AddWeightBlock(layout, 4 * hiddenSize, inputSize + hiddenSize, 1, hiddenSize);
+		AddWeightBlock(layout, 4 * hiddenSize, 1, 1, hiddenSize);
+		AddWeightBlock(layout, 2 * hiddenSize);
+	}
+
+	// Layout of the packed weights of a model - each layer in turn, then the head weights and bias
+	inline WeightLayout GetLSTMWeightLayout(size_t numLayers, size_t hiddenSize)
+	{
+		WeightLayout layout;
+
+		for (size_t layer = 0; layer < numLayers; layer++)
+			AddLSTMLayerWeightLayout(layout, (layer == 0) ? 1 : hiddenSize, hiddenSize);
+
+		AddWeightBlock(layout, hiddenSize + 1);
+
+		return layout;
+	}
+
+	// Pack Keras LSTM weights (inputs x gates, row major) into the layout of GetLSTMWeightLayout(). Keras has no initial state.
+	inline std::vector<float> PackLSTMDef(const LSTMDef& def, size_t hiddenSize)
+	{
+		const size_t numGates = 4 * hiddenSize;
+
+		std::vector<float> packed;
+
+		auto packGates = [&](const std::vector<float>& weights, size_t numCols)
+		{
+			assert(weights.size() == (numCols * numGates));
+
+			const size_t offset = packed.size();
+
+			packed.resize(offset + weights.size());
+
+			for (size_t col = 0; col < numCols; col++)
+				for (size_t row = 0; row < numGates; row++)
+					packed[offset + (col * numGates) + (size_t)LSTMGateRow((int)row, (int)hiddenSize)] = weights[(col * numGates) + row];
+		};
+
+		for (size_t layer = 0; layer < def.Layers.size(); layer++)
+		{
+			const LSTMLayerDef& layerDef = def.Layers[layer];
+
+			packGates(layerDef.InputWeights, (layer == 0) ? 1 : hiddenSize);
+			packGates(layerDef.HiddenWeights, hiddenSize);
+			packGates(layerDef.BiasWeights, 1);
+
+			packed.insert(packed.end(), 2 * hiddenSize, 0.0f);
+		}
+
+		packed.insert(packed.end(), def.HeadWeights.begin(), def.HeadWeights.begin() + hiddenSize);
+		packed.push_back(def.HeadBias);
+
+		return packed;
+	}
+
+	// Weights (and initial state) of a layer, in the layout of AddLSTMLayerWeightLayout(). They are referenced, not owned -
+	// the model weights keep them alive, and they can be shared between model instances.
+	template<int InputSize, int HiddenSize>
+	struct LSTMLayerWeightsT
+	{
+		static constexpr size_t NumWeights = (4 * HiddenSize * (InputSize + HiddenSize)) + (4 * HiddenSize) + (2 * HiddenSize);
+
+		const float* Data = nullptr;
+
+		auto InputWeights() const
+		{
+			return Eigen::Map<const Eigen::Matrix<float, 4 * HiddenSize, InputSize>>(Data);
+		}
+
+		auto HiddenWeights() const
+		{
+			return Eigen::Map<const Eigen::Matrix<float, 4 * HiddenSize, HiddenSize>>(Data + (4 * HiddenSize * InputSize));
+		}
+
+		auto Bias() const
+		{
+			return Eigen::Map<const Eigen::Vector<float, 4 * HiddenSize>>(Data + (4 * HiddenSize * (InputSize + HiddenSize)));
+		}
+
+		auto InitialHiddenState() const
+		{
+			return Eigen::Map<const Eigen::Vector<float, HiddenSize>>(Data + (4 * HiddenSize * (InputSize + HiddenSize + 1)));
+		}
+
+		auto InitialCellState() const
+		{
+			return Eigen::Map<const Eigen::Vector<float, HiddenSize>>(Data + (4 * HiddenSize * (InputSize + HiddenSize + 1)) + HiddenSize);
+		}
+
+		void BindWeights(const float*& packed)
+		{
+			Data = packed;
+			packed += NumWeights;
+		}
+	};
+
+	// Streaming state of a layer. The weights are referenced, not owned.
 	template<int InputSize, int HiddenSize>
 	class LSTMLayerT
 	{
+	public:
+		using Weights = LSTMLayerWeightsT<InputSize, HiddenSize>;
+
 	private:
-		Eigen::Matrix<float, 4 * HiddenSize, InputSize + HiddenSize>  inputHiddenWeights;
-		Eigen::Vector<float, 4 * HiddenSize> bias;
-		Eigen::Vector<float, InputSize + HiddenSize> state;
+		const Weights* weights = nullptr;
+		Eigen::Vector<float, HiddenSize> hiddenState;
 		Eigen::Vector<float, 4 * HiddenSize> gates;
 		Eigen::Vector<float, HiddenSize> cellState;
+		Eigen::Vector<float, HiddenSize> cellTanh;
+		Eigen::Matrix<float, 4 * HiddenSize, LSTM_MAX_NUM_FRAMES> inputGates;	// Input projection (plus bias) for the whole block
+		Eigen::Matrix<float, HiddenSize, LSTM_MAX_NUM_FRAMES> outputs;
 
 		constexpr static long iOffset = 0;
 		constexpr static long fOffset = HiddenSize;
-		constexpr static long gOffset = 2 * HiddenSize;
-		constexpr static long oOffset = 3 * HiddenSize;
-		constexpr static long hOffset = InputSize;
+		constexpr static long oOffset = 2 * HiddenSize;
+		constexpr static long gOffset = 3 * HiddenSize;
 
 	public:
-		auto GetHiddenState() const { return state(Eigen::placeholders::lastN(HiddenSize)); };
+		const float* GetOutputs() const { return outputs.data(); }
+		const float* GetInputWeights() const { return weights->InputWeights().data(); }
+		const float* GetHiddenWeights() const { return weights->HiddenWeights().data(); }
+		const float* GetBias() const { return weights->Bias().data(); }
+		const float* GetHiddenState() const { return hiddenState.data(); }
+		const float* GetCellState() const { return cellState.data(); }
+
+		// Weights must outlive the layer
+		void SetWeights(const Weights& layerWeights)
+		{
+			weights = &layerWeights;
+
+			ResetState();
+		}
+
+		void ResetState()
+		{
+			hiddenState = weights->InitialHiddenState();
+			cellState = weights->InitialCellState();
+		}
 
-		void SetNAMWeights(std::vector<float>::iterator& weights)
+		void CopyState(const LSTMLayerT& other)
 		{
-			for (int i = 0; i < inputHiddenWeights.rows(); i++)
-				for (int j = 0; j < inputHiddenWeights.cols(); j++)
-					inputHiddenWeights(i, j) = *(weights++);
+			hiddenState = other.hiddenState;
+			cellState = other.cellState;
+		}
 
-			for (int i = 0; i < bias.size(); i++)
-				bias[i] = *(weights++);
+		// Recurrent state, held locally by the caller for the duration of a block
+		struct StepState
+		{
+			alignas(32) float Hidden[HiddenSize];
+			alignas(32) float Cell[HiddenSize];
+		};
 
+		inline void LoadState(StepState& state) const
+		{
 			for (int i = 0; i < HiddenSize; i++)
-				state[i + InputSize] = *(weights++);
+			{
+				state.Hidden[i] = hiddenState[i];
+				state.Cell[i] = cellState[i];
+			}
+		}
 
+		inline void StoreState(const StepState& state)
+		{
 			for (int i = 0; i < HiddenSize; i++)
-				cellState[i] = *(weights++);
+			{
+				hiddenState[i] = state.Hidden[i];
+				cellState[i] = state.Cell[i];
+			}
+		}
+
+		// Input is InputSize x numFrames (column major), numFrames <= LSTM_MAX_NUM_FRAMES
+		inline void Process(const float* input, const size_t numFrames)
+		{
+			ProjectInputs(input, numFrames);
+
+			StepState state;
+
+			LoadState(state);
+
+			for (size_t frame = 0; frame < numFrames; frame++)
+				Step(frame, state);
+
+			StoreState(state);
 		}
 
-		void SetWeights(LSTMLayerDef& def)
+		// The input doesn't depend on the recurrent state, so project the whole block at once
+		inline void ProjectInputs(const float* input, const size_t numFrames)
 		{
-			std::vector<float>::iterator it = def.InputWeights.begin();
+			auto inputMap = Eigen::Map<const Eigen::Matrix<float, InputSize, Eigen::Dynamic>>(input, InputSize, numFrames);
+
+			inputGates.leftCols(numFrames).noalias() = weights->InputWeights() * inputMap;
+			inputGates.leftCols(numFrames).colwise() += weights->Bias();
+		}
+
+		inline void ProjectInput(const float* input, const size_t frame)
+		{
+			inputGates.col(frame).noalias() = weights->InputWeights() * Eigen::Map<const Eigen::Vector<float, InputSize>>(input);
+			inputGates.col(frame) += weights->Bias();
+		}
+
+		// Run the recurrent update for a frame whose input has already been projected
+		inline void Step(const size_t frame, StepState& state)
+		{
+			if constexpr (HiddenSize <= LSTM_SMALL_KERNEL_MAX_HIDDEN)
+			{
+				// Small layers - fully unrolled fixed-size loops over local arrays so that the state and gates
+				// stay in registers from frame to frame instead of round-tripping through the layer members
+				alignas(32) float g[4 * HiddenSize];
+				alignas(32) float cTanh[HiddenSize];
 
-			for (int j = 0; j < InputSize; j++)
-				for (int i = 0; i < inputHiddenWeights.rows(); i++)
+				const float* __restrict in = inputGates.data() + (frame * 4 * HiddenSize);
+				const float* __restrict w = weights->HiddenWeights().data();
+
+				for (int row = 0; row < (4 * HiddenSize); row++)
+					g[row] = in[row];
+
+				for (int col = 0; col < HiddenSize; col++)
+				{
+					const float h = state.Hidden[col];
+
+					for (int row = 0; row < (4 * HiddenSize); row++)
+						g[row] += w[(col * 4 * HiddenSize) + row] * h;
+				}
+
+				LSTM_MATH<float>::Sigmoid(g, 3 * HiddenSize);
+				LSTM_MATH<float>::Tanh(g + gOffset, HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
 				{
-					inputHiddenWeights(i, j) = *(it++);
+					state.Cell[i] = (g[i + fOffset] * state.Cell[i]) + (g[i + iOffset] * g[i + gOffset]);
+					cTanh[i] = state.Cell[i];
 				}
 
-			assert(std::distance(def.InputWeights.begin(), it) == (long)def.InputWeights.size());
+				LSTM_MATH<float>::Tanh(cTanh, HiddenSize);
 
-			it = def.HiddenWeights.begin();
+				float* __restrict out = outputs.data() + (frame * HiddenSize);
 
-			for (int j = 0; j < HiddenSize; j++)
-				for (int i = 0; i < inputHiddenWeights.rows(); i++)
+				for (int i = 0; i < HiddenSize; i++)
 				{
-					inputHiddenWeights(i, j + InputSize) = *(it++);
+					state.Hidden[i] = g[i + oOffset] * cTanh[i];
+					out[i] = state.Hidden[i];
 				}
+			}
+			else
+			{
+				auto hidden = Eigen::Map<Eigen::Vector<float, HiddenSize>>(state.Hidden);
+				auto cell = Eigen::Map<Eigen::Vector<float, HiddenSize>>(state.Cell);
+
+				gates = inputGates.col(frame);
+				gates.noalias() += weights->HiddenWeights() * hidden;
 
-			assert(std::distance(def.HiddenWeights.begin(), it) == (long)def.HiddenWeights.size());
+				LSTM_MATH<float>::Sigmoid(gates.data(), 3 * HiddenSize);
+				LSTM_MATH<float>::Tanh(gates.data() + gOffset, HiddenSize);
+
+				for (int i = 0; i < HiddenSize; i++)
+				{
+					cell[i] = (gates[i + fOffset] * cell[i]) + (gates[i + iOffset] * gates[i + gOffset]);
+					cellTanh[i] = cell[i];
+				}
 
-			for (int i = 0; i < bias.rows(); i++)
-				bias[i] = def.BiasWeights[i];
+				LSTM_MATH<float>::Tanh(cellTanh.data(), HiddenSize);
 
-			state.setZero();
-			cellState.setZero();
+				for (int i = 0; i < HiddenSize; i++)
+					hidden[i] = gates[i + oOffset] * cellTanh[i];
+
+				outputs.col(frame) = hidden;
+			}
 		}
+	};
 
-		inline void Process(const float* input)
+	template<int NumLayers, int HiddenSize>
+	struct LSTMModelWeightsT
+	{
+		LSTMLayerWeightsT<1, HiddenSize> FirstLayer;
+		std::array<LSTMLayerWeightsT<HiddenSize, HiddenSize>, NumLayers - 1> RemainingLayers;
+		const float* HeadWeights = nullptr;
+		float HeadBias = 0;
+		std::shared_ptr<const void> Owner;	// Keeps the packed weights alive
+
+		// Use weights in the layout of GetLSTMWeightLayout() in place
+		void BindWeights(const float* packed, std::shared_ptr<const void> owner)
 		{
-			for (int i = 0; i < InputSize; i++)
-				state(i) = input[i];
+			Owner = std::move(owner);
 
-			gates = (inputHiddenWeights * state) + bias;
+			FirstLayer.BindWeights(packed);
 
-			for (auto i = 0; i < HiddenSize; i++)
-				cellState[i] = (LSTM_MATH<float>::Sigmoid(gates[i + fOffset]) * cellState[i]) + 
-					(LSTM_MATH<float>::Sigmoid(gates[i + iOffset]) * LSTM_MATH<float>::Tanh(gates[i + gOffset]));
+			for (auto& layer : RemainingLayers)
+				layer.BindWeights(packed);
 
-			for (int i = 0; i < HiddenSize; i++)
-				state[i + hOffset] = LSTM_MATH<float>::Sigmoid(gates[i + oOffset]) * LSTM_MATH<float>::Tanh(cellState[i]);
+			HeadWeights = packed;
+			HeadBias = packed[HiddenSize];
 		}
 	};
 
 	template<int NumLayers, int HiddenSize>
 	class LSTMModelT
 	{
+	public:
+		using Weights = LSTMModelWeightsT<NumLayers, HiddenSize>;
+
 	private:
+		std::shared_ptr<const Weights> weights;
 		LSTMLayerT<1, HiddenSize> firstLayer;
 		std::vector<LSTMLayerT<HiddenSize, HiddenSize>> remainingLayers;
-		Eigen::Vector<float, HiddenSize> headWeights;
-		float headBias;
 
 	public:
 		LSTMModelT()
@@ -115,79 +477,172 @@ namespace NeuralAudio
 			if constexpr (NumLayers > 1)
 			{
 				remainingLayers.resize(NumLayers - 1);
+			}
+		}
 
-				ForEachIndex<NumLayers - 1>([&](auto layerIndex)
-					{
-						(void)layerIndex;
+		LSTMModelT(std::shared_ptr<const Weights> sharedWeights) :
+			LSTMModelT()
+		{
+			SetSharedWeights(std::move(sharedWeights));
+		}
 
-						LSTMLayerT<HiddenSize, HiddenSize> layer;
+		const LSTMLayerT<1, HiddenSize>& GetFirstLayer() const { return firstLayer; }
+		const std::vector<LSTMLayerT<HiddenSize, HiddenSize>>& GetRemainingLayers() const { return remainingLayers; }
+		const float* GetHeadWeights() const { return weights->HeadWeights; }
+		float GetHeadBias() const { return weights->HeadBias; }
+		const std::shared_ptr<const Weights>& GetSharedWeights() const { return weights; }
 
-						remainingLayers.push_back(layer);
-					});
-			}
+		// New instance that shares our weights
+		LSTMModelT* CreateSharedInstance() const
+		{
+			return new LSTMModelT(weights);
 		}
 
-		void SetNAMWeights(std::vector<float> weights)
+		// Use weights that may be shared with other instances. Resets the state.
+		void SetSharedWeights(std::shared_ptr<const Weights> sharedWeights)
 		{
-			std::vector<float>::iterator it = weights.begin();
+			weights = std::move(sharedWeights);
 
-			firstLayer.SetNAMWeights(it);
+			firstLayer.SetWeights(weights->FirstLayer);
 
 			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
 				{
-					remainingLayers[layerIndex].SetNAMWeights(it);
+					remainingLayers[layerIndex].SetWeights(weights->RemainingLayers[layerIndex]);
 				});
+		}
 
-			for (int i = 0; i < HiddenSize; i++)
-				headWeights[i] = *(it++);
+		static WeightLayout GetWeightLayout()
+		{
+			return GetLSTMWeightLayout(NumLayers, HiddenSize);
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive.
+		void SetSharedWeights(const float* packedWeights, std::shared_ptr<const void> owner)
+		{
+			auto newWeights = std::make_shared<Weights>();
+
+			newWeights->BindWeights(packedWeights, std::move(owner));
+
+			SetSharedWeights(std::move(newWeights));
+		}
+
+		void SetNAMWeights(std::span<const float> modelWeights)
+		{
+			const WeightLayout layout = GetWeightLayout();
+			const size_t numWeights = GetWeightLayoutSize(layout);
+
+			if (numWeights != modelWeights.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numWeights << " but got " << modelWeights.size();
+				throw std::runtime_error(str.str());
+			}
 
-			headBias = *(it++);
+			auto packedWeights = std::make_shared<std::vector<float>>(numWeights);
 
-			assert(std::distance(weights.begin(), it) == (long)weights.size());
+			PackWeights(modelWeights, layout, packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
 		}
 
 		void SetWeights(LSTMDef& def)
 		{
-			for (int i = 0; i < HiddenSize; i++)
-				headWeights[i] = def.HeadWeights[i];
+			auto packedWeights = std::make_shared<std::vector<float>>(PackLSTMDef(def, HiddenSize));
 
-			headBias = def.HeadBias;
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
 
-			firstLayer.SetWeights(def.Layers[0]);
+		void CopyState(const LSTMModelT& other)
+		{
+			firstLayer.CopyState(other.firstLayer);
 
 			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
 				{
-					remainingLayers[layerIndex].SetWeights(def.Layers[layerIndex + 1]);
+					remainingLayers[layerIndex].CopyState(other.remainingLayers[layerIndex]);
 				});
 		}
 
-		void Process(const float* input, float* output, const size_t numSamples)
+		void Process(const float* input, float* output, size_t numSamples)
 		{
-			for (size_t i = 0; i < numSamples; i++)
+			while (numSamples > 0)
 			{
-				firstLayer.Process(input + i);
+				size_t numFrames = std::min(numSamples, (size_t)LSTM_MAX_NUM_FRAMES);
 
-				ForEachIndex<NumLayers - 1>([&](auto layerIndex)
-					{
-						if constexpr (layerIndex == 0)
-						{
-							remainingLayers[layerIndex].Process(firstLayer.GetHiddenState().data());
-						}
-						else
-						{
-							remainingLayers[layerIndex].Process(remainingLayers[layerIndex - 1].GetHiddenState().data());
-						}
-					});
+				ProcessBlock(input, output, numFrames);
 
-				if constexpr (NumLayers == 1)
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		void ProcessBlock(const float* input, float* output, const size_t numFrames)
+		{
+			firstLayer.ProjectInputs(input, numFrames);
+
+			// Keep the recurrent state local for the whole block
+			typename LSTMLayerT<1, HiddenSize>::StepState firstState;
+			std::array<typename LSTMLayerT<HiddenSize, HiddenSize>::StepState, NumLayers - 1> remainingStates;
+
+			firstLayer.LoadState(firstState);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
 				{
-					output[i] = headWeights.dot(firstLayer.GetHiddenState()) + headBias;
-				}
-				else
+					remainingLayers[layerIndex].LoadState(remainingStates[layerIndex]);
+				});
+
+			if constexpr (NumLayers == 1)
+			{
+				for (size_t frame = 0; frame < numFrames; frame++)
+					firstLayer.Step(frame, firstState);
+			}
+			else
+			{
+				// Wavefront schedule - layer N works on frame (t - N), so the layer updates within an iteration
+				// are independent of each other and their dependency chains can overlap
+				for (size_t t = 0; t < (numFrames + NumLayers - 1); t++)
 				{
-					output[i] = headWeights.dot(remainingLayers[NumLayers - 2].GetHiddenState()) + headBias;
+					if (t < numFrames)
+						firstLayer.Step(t, firstState);
+
+					ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+						{
+							if ((t > layerIndex) && ((t - layerIndex - 1) < numFrames))
+							{
+								const size_t frame = t - layerIndex - 1;
+
+								if constexpr (layerIndex == 0)
+								{
+									remainingLayers[layerIndex].ProjectInput(firstLayer.GetOutputs() + (frame * HiddenSize), frame);
+								}
+								else
+								{
+									remainingLayers[layerIndex].ProjectInput(remainingLayers[layerIndex - 1].GetOutputs() + (frame * HiddenSize), frame);
+								}
+
+								remainingLayers[layerIndex].Step(frame, remainingStates[layerIndex]);
+							}
+						});
 				}
 			}
+
+			firstLayer.StoreState(firstState);
+
+			ForEachIndex<NumLayers - 1>([&](auto layerIndex)
+				{
+					remainingLayers[layerIndex].StoreState(remainingStates[layerIndex]);
+				});
+
+			const float* layerOutputs = firstLayer.GetOutputs();
+
+			if constexpr (NumLayers > 1)
+				layerOutputs = remainingLayers[NumLayers - 2].GetOutputs();
+
+			auto outputMap = Eigen::Map<Eigen::Matrix<float, 1, Eigen::Dynamic>>(output, 1, numFrames);
+
+			outputMap.noalias() = Eigen::Map<const Eigen::Vector<float, HiddenSize>>(weights->HeadWeights).transpose() * Eigen::Map<const Eigen::Matrix<float, HiddenSize, Eigen::Dynamic>>(layerOutputs, HiddenSize, numFrames);
+			outputMap.array() += weights->HeadBias;
 		}
 	};
 }
\ No newline at end of file
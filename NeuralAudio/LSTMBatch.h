@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "LSTM.h"
+
+#ifndef LSTM_BATCH_LANES
+#define LSTM_BATCH_LANES 8
+#endif
+
+namespace NeuralAudio
+{
+	// Runs several independent instances of an LSTMModelT that share its weights. Instances are processed in groups
+	// of LSTM_BATCH_LANES, with the lane (instance) index innermost so that each SIMD lane holds one instance's state.
+	template<int NumLayers, int HiddenSize>
+	class LSTMBatchT
+	{
+	private:
+		static constexpr int Lanes = LSTM_BATCH_LANES;
+		static constexpr int NumGates = 4 * HiddenSize;
+
+		struct LayerWeights
+		{
+			const float* InputWeights;	// NumGates x InputSize, column major
+			const float* HiddenWeights;	// NumGates x HiddenSize, column major
+			const float* Bias;
+		};
+
+		// State for one group of lanes - all arrays are [row][lane]
+		struct LaneGroup
+		{
+			alignas(32) float Hidden[NumLayers][HiddenSize * Lanes];
+			alignas(32) float Cell[NumLayers][HiddenSize * Lanes];
+		};
+
+		const LSTMModelT<NumLayers, HiddenSize>& model;
+		LayerWeights layerWeights[NumLayers];
+		size_t numInstances;
+		std::vector<LaneGroup> laneGroups;
+		LaneGroup initialState;
+
+		constexpr static int iOffset = 0;
+		constexpr static int fOffset = HiddenSize;
+		constexpr static int oOffset = 2 * HiddenSize;
+		constexpr static int gOffset = 3 * HiddenSize;
+
+		template<int InputSize>
+		void SetLayer(const int layer, const LSTMLayerT<InputSize, HiddenSize>& lstmLayer)
+		{
+			layerWeights[layer] = { lstmLayer.GetInputWeights(), lstmLayer.GetHiddenWeights(), lstmLayer.GetBias() };
+
+			// Every instance starts from the model's current (ie: prewarmed) state
+			for (int i = 0; i < HiddenSize; i++)
+			{
+				for (int lane = 0; lane < Lanes; lane++)
+				{
+					initialState.Hidden[layer][(i * Lanes) + lane] = lstmLayer.GetHiddenState()[i];
+					initialState.Cell[layer][(i * Lanes) + lane] = lstmLayer.GetCellState()[i];
+				}
+			}
+		}
+
+		template<int InputSize>
+		static inline void StepLayer(const LayerWeights& weights, const float* __restrict input, float* __restrict hidden, float* __restrict cell)
+		{
+			alignas(32) float gates[NumGates * Lanes];
+			alignas(32) float cellTanh[HiddenSize * Lanes];
+
+			// Each gate row accumulates all lanes at once, so the accumulators stay in registers
+			for (int row = 0; row < NumGates; row++)
+			{
+				float acc[Lanes];
+
+				for (int lane = 0; lane < Lanes; lane++)
+					acc[lane] = weights.Bias[row];
+
+				for (int col = 0; col < InputSize; col++)
+				{
+					const float w = weights.InputWeights[(col * NumGates) + row];
+
+					for (int lane = 0; lane < Lanes; lane++)
+						acc[lane] += w * input[(col * Lanes) + lane];
+				}
+
+				for (int col = 0; col < HiddenSize; col++)
+				{
+					const float w = weights.HiddenWeights[(col * NumGates) + row];
+
+					for (int lane = 0; lane < Lanes; lane++)
+						acc[lane] += w * hidden[(col * Lanes) + lane];
+				}
+
+				for (int lane = 0; lane < Lanes; lane++)
+					gates[(row * Lanes) + lane] = acc[lane];
+			}
+
+			LSTM_MATH<float>::Sigmoid(gates, 3 * HiddenSize * Lanes);
+			LSTM_MATH<float>::Tanh(gates + (gOffset * Lanes), HiddenSize * Lanes);
+
+			for (int i = 0; i < (HiddenSize * Lanes); i++)
+			{
+				cell[i] = (gates[i + (fOffset * Lanes)] * cell[i]) + (gates[i + (iOffset * Lanes)] * gates[i + (gOffset * Lanes)]);
+				cellTanh[i] = cell[i];
+			}
+
+			LSTM_MATH<float>::Tanh(cellTanh, HiddenSize * Lanes);
+
+			for (int i = 0; i < (HiddenSize * Lanes); i++)
+				hidden[i] = gates[i + (oOffset * Lanes)] * cellTanh[i];
+		}
+
+	public:
+		// The batch references the model's weights, so it is only valid for the lifetime of the model
+		LSTMBatchT(const LSTMModelT<NumLayers, HiddenSize>& model, const size_t numInstances) :
+			model(model),
+			numInstances(numInstances)
+		{
+			SetLayer(0, model.GetFirstLayer());
+
+			for (int layer = 1; layer < NumLayers; layer++)
+				SetLayer(layer, model.GetRemainingLayers()[layer - 1]);
+
+			laneGroups.resize((numInstances + Lanes - 1) / Lanes);
+
+			for (size_t instance = 0; instance < numInstances; instance++)
+				ResetInstance(instance);
+		}
+
+		size_t GetNumInstances() const
+		{
+			return numInstances;
+		}
+
+		void ResetInstance(const size_t instance)
+		{
+			LaneGroup& group = laneGroups[instance / Lanes];
+			const size_t lane = instance % Lanes;
+
+			for (int layer = 0; layer < NumLayers; layer++)
+			{
+				for (int i = 0; i < HiddenSize; i++)
+				{
+					group.Hidden[layer][(i * Lanes) + lane] = initialState.Hidden[layer][(i * Lanes) + lane];
+					group.Cell[layer][(i * Lanes) + lane] = initialState.Cell[layer][(i * Lanes) + lane];
+				}
+			}
+		}
+
+		// inputs and outputs are arrays of GetNumInstances() sample buffers
+		void Process(const float* const* inputs, float* const* outputs, const size_t numSamples)
+		{
+			const float* headWeights = model.GetHeadWeights();
+			const float headBias = model.GetHeadBias();
+
+			for (size_t groupIndex = 0; groupIndex < laneGroups.size(); groupIndex++)
+			{
+				LaneGroup& group = laneGroups[groupIndex];
+
+				const size_t firstInstance = groupIndex * Lanes;
+				const int numLanes = (int)std::min((size_t)Lanes, numInstances - firstInstance);
+
+				// Unused lanes in the last group run on silence
+				alignas(32) float laneInput[Lanes] = { 0 };
+
+				for (size_t frame = 0; frame < numSamples; frame++)
+				{
+					for (int lane = 0; lane < numLanes; lane++)
+						laneInput[lane] = inputs[firstInstance + lane][frame];
+
+					StepLayer<1>(layerWeights[0], laneInput, group.Hidden[0], group.Cell[0]);
+
+					for (int layer = 1; layer < NumLayers; layer++)
+						StepLayer<HiddenSize>(layerWeights[layer], group.Hidden[layer - 1], group.Hidden[layer], group.Cell[layer]);
+
+					const float* hidden = group.Hidden[NumLayers - 1];
+
+					float out[Lanes];
+
+					for (int lane = 0; lane < Lanes; lane++)
+						out[lane] = headBias;
+
+					for (int i = 0; i < HiddenSize; i++)
+					{
+						for (int lane = 0; lane < Lanes; lane++)
+							out[lane] += headWeights[i] * hidden[(i * Lanes) + lane];
+					}
+
+					for (int lane = 0; lane < numLanes; lane++)
+						outputs[firstInstance + lane][frame] = out[lane];
+				}
+			}
+		}
+	};
+}
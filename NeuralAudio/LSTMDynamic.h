@@ -1,181 +1,425 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <Eigen/Dense>
 #include "Activation.h"
 #include "LSTM.h"
 
+// Hidden sizes up to this are rounded up to a multiple of LSTM_BUCKET_HIDDEN_STEP and run with fixed-size kernels
+#ifndef LSTM_BUCKET_MAX_HIDDEN
+#define LSTM_BUCKET_MAX_HIDDEN 32
+#endif
+
+#ifndef LSTM_BUCKET_HIDDEN_STEP
+#define LSTM_BUCKET_HIDDEN_STEP 4
+#endif
+
 namespace NeuralAudio
 {
-	class LSTMLayer
+	class LSTMLayerBase
+	{
+	public:
+		virtual ~LSTMLayerBase()
+		{
+		}
+
+		virtual const float* GetOutputs() const = 0;
+		virtual void CopyState(const LSTMLayerBase& other) = 0;
+		virtual void Process(const float* input, const size_t numFrames) = 0;
+	};
+
+	// Layer weights, shareable between model instances. Each instance creates its own layer state from them.
+	class LSTMLayerWeightsBase
+	{
+	public:
+		virtual ~LSTMLayerWeightsBase()
+		{
+		}
+
+		// Use packed weights (see AddLSTMLayerWeightLayout()) in place. They must outlive the layer weights.
+		virtual void BindWeights(const float*& packed) = 0;
+		virtual std::unique_ptr<LSTMLayerBase> CreateLayer() const = 0;
+	};
+
+	// Fixed-size layer used for bucketed hidden sizes
+	template<int InputSize, int HiddenSize>
+	class LSTMBucketLayerT : public LSTMLayerBase
 	{
 	private:
-		size_t inputSize;
+		LSTMLayerT<InputSize, HiddenSize> layer;
+
+	public:
+		LSTMBucketLayerT(const LSTMLayerWeightsT<InputSize, HiddenSize>& weights)
+		{
+			layer.SetWeights(weights);
+		}
+
+		const float* GetOutputs() const override { return layer.GetOutputs(); }
+
+		void CopyState(const LSTMLayerBase& other) override
+		{
+			layer.CopyState(static_cast<const LSTMBucketLayerT&>(other).layer);
+		}
+
+		void Process(const float* input, const size_t numFrames) override
+		{
+			layer.Process(input, numFrames);
+		}
+	};
+
+	template<int InputSize, int HiddenSize>
+	class LSTMBucketLayerWeightsT : public LSTMLayerWeightsBase
+	{
+	private:
+		LSTMLayerWeightsT<InputSize, HiddenSize> weights;
+
+	public:
+		void BindWeights(const float*& packed) override
+		{
+			weights.BindWeights(packed);
+		}
+
+		std::unique_ptr<LSTMLayerBase> CreateLayer() const override
+		{
+			return std::make_unique<LSTMBucketLayerT<InputSize, HiddenSize>>(weights);
+		}
+	};
+
+	class LSTMLayerWeights : public LSTMLayerWeightsBase
+	{
+	public:
+		size_t InputSize;
+		size_t HiddenSize;
+		const float* Data = nullptr;
+
+		LSTMLayerWeights(size_t inputSize, size_t hiddenSize) :
+			InputSize(inputSize),
+			HiddenSize(hiddenSize)
+		{
+		}
+
+		auto InputWeights() const
+		{
+			return Eigen::Map<const Eigen::MatrixXf>(Data, 4 * HiddenSize, InputSize);
+		}
+
+		auto HiddenWeights() const
+		{
+			return Eigen::Map<const Eigen::MatrixXf>(Data + (4 * HiddenSize * InputSize), 4 * HiddenSize, HiddenSize);
+		}
+
+		auto Bias() const
+		{
+			return Eigen::Map<const Eigen::VectorXf>(Data + (4 * HiddenSize * (InputSize + HiddenSize)), 4 * HiddenSize);
+		}
+
+		auto InitialHiddenState() const
+		{
+			return Eigen::Map<const Eigen::VectorXf>(Data + (4 * HiddenSize * (InputSize + HiddenSize + 1)), HiddenSize);
+		}
+
+		auto InitialCellState() const
+		{
+			return Eigen::Map<const Eigen::VectorXf>(Data + (4 * HiddenSize * (InputSize + HiddenSize + 1)) + HiddenSize, HiddenSize);
+		}
+
+		void BindWeights(const float*& packed) override
+		{
+			Data = packed;
+			packed += (4 * HiddenSize * (InputSize + HiddenSize + 1)) + (2 * HiddenSize);
+		}
+
+		std::unique_ptr<LSTMLayerBase> CreateLayer() const override;
+	};
+
+	class LSTMLayer : public LSTMLayerBase
+	{
+	private:
+		const LSTMLayerWeights& weights;
 		size_t hiddenSize;
-		size_t inputHiddenSize;
-		size_t gateSize;
-		Eigen::MatrixXf inputHiddenWeights;
-		Eigen::VectorXf bias;
-		Eigen::VectorXf state;
+		Eigen::VectorXf hiddenState;
 		Eigen::VectorXf gates;
 		Eigen::VectorXf cellState;
+		Eigen::VectorXf cellTanh;
+		Eigen::MatrixXf inputGates;	// Input projection (plus bias) for the whole block
+		Eigen::MatrixXf outputs;
 
 		size_t iOffset;
 		size_t fOffset;
-		size_t gOffset;
 		size_t oOffset;
-		size_t hOffset;
+		size_t gOffset;
 
 	public:
-		LSTMLayer(size_t inputSize, size_t hiddenSize) :
-			inputSize(inputSize),
-			hiddenSize(hiddenSize),
-			inputHiddenSize(inputSize + hiddenSize),
-			gateSize(4 * hiddenSize),
-			inputHiddenWeights(gateSize, inputHiddenSize),
-			bias(gateSize),
-			state(inputHiddenSize),
-			gates(gateSize),
-			cellState(hiddenSize),
+		LSTMLayer(const LSTMLayerWeights& weights) :
+			weights(weights),
+			hiddenSize(weights.HiddenSize),
+			hiddenState(weights.InitialHiddenState()),
+			gates(4 * hiddenSize),
+			cellState(weights.InitialCellState()),
+			cellTanh(hiddenSize),
+			inputGates(4 * hiddenSize, LSTM_MAX_NUM_FRAMES),
+			outputs(hiddenSize, LSTM_MAX_NUM_FRAMES),
 			iOffset(0),
 			fOffset(hiddenSize),
-			gOffset(2 * hiddenSize),
-			oOffset(3 * hiddenSize),
-			hOffset(inputSize)
+			oOffset(2 * hiddenSize),
+			gOffset(3 * hiddenSize)
 		{
 		}
 
-		auto GetHiddenState() const { return state(Eigen::placeholders::lastN(hiddenSize)); };
+		const float* GetOutputs() const override { return outputs.data(); }
 
-		void SetNAMWeights(std::vector<float>::iterator& weights)
+		void CopyState(const LSTMLayerBase& other) override
 		{
-			for (size_t i = 0; i < gateSize; i++)
-				for (size_t j = 0; j < inputHiddenSize; j++)
-					inputHiddenWeights(i, j) = *(weights++);
-
-			for (size_t i = 0; i < gateSize; i++)
-				bias[i] = *(weights++);
+			const LSTMLayer& otherLayer = static_cast<const LSTMLayer&>(other);
 
-			for (size_t i = 0; i < hiddenSize; i++)
-				state[i + inputSize] = *(weights++);
-
-			for (size_t i = 0; i < hiddenSize; i++)
-				cellState[i] = *(weights++);
+			hiddenState = otherLayer.hiddenState;
+			cellState = otherLayer.cellState;
 		}
 
-		void SetWeights(LSTMLayerDef& def)
+		// Input is inputSize x numFrames (column major), numFrames <= LSTM_MAX_NUM_FRAMES
+		void Process(const float* input, const size_t numFrames) override
 		{
-			std::vector<float>::iterator it = def.InputWeights.begin();
+			auto inputMap = Eigen::Map<const Eigen::MatrixXf>(input, weights.InputSize, numFrames);
 
-			for (size_t j = 0; j < inputSize; j++)
-				for (size_t i = 0; i < gateSize; i++)
-				{
-					inputHiddenWeights(i, j) = *(it++);
-				}
+			// The input doesn't depend on the recurrent state, so project the whole block at once
+			inputGates.leftCols(numFrames).noalias() = weights.InputWeights() * inputMap;
+			inputGates.leftCols(numFrames).colwise() += weights.Bias();
 
-			assert(std::distance(def.InputWeights.begin(), it) == (long)def.InputWeights.size());
+			for (size_t frame = 0; frame < numFrames; frame++)
+			{
+				gates = inputGates.col(frame);
+				gates.noalias() += weights.HiddenWeights() * hiddenState;
 
-			it = def.HiddenWeights.begin();
+				LSTM_MATH<float>::Sigmoid(gates.data(), 3 * hiddenSize);
+				LSTM_MATH<float>::Tanh(gates.data() + gOffset, hiddenSize);
 
-			for (size_t j = 0; j < hiddenSize; j++)
-				for (size_t i = 0; i < gateSize; i++)
+				for (size_t i = 0; i < hiddenSize; i++)
 				{
-					inputHiddenWeights(i, j + inputSize) = *(it++);
+					cellState[i] = (gates[i + fOffset] * cellState[i]) + (gates[i + iOffset] * gates[i + gOffset]);
+					cellTanh[i] = cellState[i];
 				}
 
-			assert(std::distance(def.HiddenWeights.begin(), it) == (long)def.HiddenWeights.size());
+				LSTM_MATH<float>::Tanh(cellTanh.data(), hiddenSize);
 
-			for (size_t i = 0; i < gateSize; i++)
-				bias[i] = def.BiasWeights[i];
+				for (size_t i = 0; i < hiddenSize; i++)
+					hiddenState[i] = gates[i + oOffset] * cellTanh[i];
 
-			state.setZero();
-			cellState.setZero();
+				outputs.col(frame) = hiddenState;
+			}
 		}
+	};
 
-		inline void Process(const float* input)
-		{
-			for (size_t i = 0; i < inputSize; i++)
-				state(i) = input[i];
-
-			gates = (inputHiddenWeights * state) + bias;
-
-			for (size_t i = 0; i < hiddenSize; i++)
-				cellState[i] = (LSTM_MATH<float>::Sigmoid(gates[i + fOffset]) * cellState[i]) + (LSTM_MATH<float>::Sigmoid(gates[i + iOffset]) *
-					LSTM_MATH<float>::Tanh(gates[i + gOffset]));
+	inline std::unique_ptr<LSTMLayerBase> LSTMLayerWeights::CreateLayer() const
+	{
+		return std::make_unique<LSTMLayer>(*this);
+	}
 
-			for (size_t i = 0; i < hiddenSize; i++)
-				state[i + hOffset] = LSTM_MATH<float>::Sigmoid(gates[i + oOffset]) * LSTM_MATH<float>::Tanh(cellState[i]);
-		}
+	struct LSTMModelWeights
+	{
+		std::vector<std::unique_ptr<LSTMLayerWeightsBase>> Layers;
+		const float* HeadWeights = nullptr;
+		float HeadBias = 0;
+		std::shared_ptr<const void> Owner;	// Keeps the packed weights alive
 	};
 
 	class LSTMModel
 	{
 	private:
 		size_t numLayers;
-		size_t lastLayer;
-		size_t hiddenSize;
-		std::vector<LSTMLayer> layers;
-		Eigen::VectorXf headWeights;
-		float headBias;
+		size_t modelHiddenSize;
+		size_t hiddenSize;	// Hidden size we run at - larger than the model's if it has been padded to a bucket size
+		std::shared_ptr<const LSTMModelWeights> weights;
+		std::vector<std::unique_ptr<LSTMLayerBase>> layers;
 
 	public:
+		static size_t GetBucketHiddenSize(size_t hiddenSize)
+		{
+			if (hiddenSize > LSTM_BUCKET_MAX_HIDDEN)
+				return hiddenSize;
+
+			return ((hiddenSize + LSTM_BUCKET_HIDDEN_STEP - 1) / LSTM_BUCKET_HIDDEN_STEP) * LSTM_BUCKET_HIDDEN_STEP;
+		}
+
 		LSTMModel(size_t numLayers, size_t hiddenSize) :
 			numLayers(numLayers),
-			lastLayer(numLayers - 1),
-			hiddenSize(hiddenSize),
-			headWeights(hiddenSize)
+			modelHiddenSize(hiddenSize),
+			hiddenSize(GetBucketHiddenSize(hiddenSize))
 		{
-			layers.push_back(LSTMLayer(1, hiddenSize));
-				
-			for (size_t i = 0; i < numLayers - 1; i++)
+		}
+
+		LSTMModel(size_t numLayers, size_t hiddenSize, std::shared_ptr<const LSTMModelWeights> sharedWeights) :
+			LSTMModel(numLayers, hiddenSize)
+		{
+			SetSharedWeights(std::move(sharedWeights));
+		}
+
+		const std::shared_ptr<const LSTMModelWeights>& GetSharedWeights() const { return weights; }
+
+		// New instance that shares our weights
+		LSTMModel* CreateSharedInstance() const
+		{
+			return new LSTMModel(numLayers, modelHiddenSize, weights);
+		}
+
+		// Use weights that may be shared with other instances. Resets the state.
+		void SetSharedWeights(std::shared_ptr<const LSTMModelWeights> sharedWeights)
+		{
+			weights = std::move(sharedWeights);
+
+			layers.clear();
+
+			for (auto& layerWeights : weights->Layers)
 			{
-				layers.push_back(LSTMLayer(hiddenSize, hiddenSize));
+				layers.push_back(layerWeights->CreateLayer());
 			}
 		}
 
-		void SetNAMWeights(std::vector<float> weights)
+		// Layout of the weights we run with - padded to the bucket hidden size if it is larger than the model's
+		WeightLayout GetWeightLayout() const
+		{
+			return GetLSTMWeightLayout(numLayers, hiddenSize);
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive.
+		void SetSharedWeights(const float* packedWeights, std::shared_ptr<const void> owner)
 		{
-			std::vector<float>::iterator it = weights.begin();
+			auto newWeights = CreateWeights();
+
+			const float* packed = packedWeights;
 
-			for (auto& layer : layers)
+			for (auto& layerWeights : newWeights->Layers)
 			{
-				layer.SetNAMWeights(it);
+				layerWeights->BindWeights(packed);
 			}
 
-			for (size_t i = 0; i < hiddenSize; i++)
-				headWeights[i] = *(it++);
+			newWeights->HeadWeights = packed;
+			newWeights->HeadBias = packed[hiddenSize];
+			newWeights->Owner = std::move(owner);
+
+			SetSharedWeights(std::move(newWeights));
+		}
+
+		void SetNAMWeights(std::span<const float> modelWeights)
+		{
+			const size_t numModelWeights = GetWeightLayoutSize(GetLSTMWeightLayout(numLayers, modelHiddenSize));
+
+			if (numModelWeights != modelWeights.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numModelWeights << " but got " << modelWeights.size();
+				throw std::runtime_error(str.str());
+			}
+
+			std::vector<float> paddedWeights;
+
+			if (hiddenSize != modelHiddenSize)
+				paddedWeights = PadLSTMNAMWeights(modelWeights, numLayers, modelHiddenSize, hiddenSize);
+
+			std::span<const float> namWeights = (hiddenSize != modelHiddenSize) ? std::span<const float>(paddedWeights) : modelWeights;
+
+			const WeightLayout layout = GetWeightLayout();
 
-			headBias = *(it++);
+			auto packedWeights = std::make_shared<std::vector<float>>(GetWeightLayoutSize(layout));
 
-			assert(std::distance(weights.begin(), it) == (long)weights.size());
+			PackWeights(namWeights, layout, packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
 		}
 
 		void SetWeights(LSTMDef& def)
 		{
-			for (size_t i = 0; i < hiddenSize; i++)
-				headWeights[i] = def.HeadWeights[i];
+			std::shared_ptr<std::vector<float>> packedWeights;
+
+			if (hiddenSize != modelHiddenSize)
+				packedWeights = std::make_shared<std::vector<float>>(PackLSTMDef(PadLSTMDef(def, modelHiddenSize, hiddenSize), hiddenSize));
+			else
+				packedWeights = std::make_shared<std::vector<float>>(PackLSTMDef(def, hiddenSize));
 
-			headBias = def.HeadBias;
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
 
+		void CopyState(const LSTMModel& other)
+		{
 			for (size_t i = 0; i < numLayers; i++)
 			{
-				layers[i].SetWeights(def.Layers[i]);
+				layers[i]->CopyState(*other.layers[i]);
 			}
 		}
 
-		void Process(const float* input, float* output, const size_t numSamples)
+		void Process(const float* input, float* output, size_t numSamples)
 		{
-			for (size_t i = 0; i < numSamples; i++)
+			while (numSamples > 0)
 			{
-				layers[0].Process(input + i);
+				size_t numFrames = std::min(numSamples, (size_t)LSTM_MAX_NUM_FRAMES);
 
-				for (size_t layer = 1; layer < numLayers; layer++)
-				{
-					layers[layer].Process(layers[layer - 1].GetHiddenState().data());
-				}
+				ProcessBlock(input, output, numFrames);
+
+				input += numFrames;
+				output += numFrames;
+				numSamples -= numFrames;
+			}
+		}
+
+	private:
+		template<int BucketSize = LSTM_BUCKET_HIDDEN_STEP>
+		static LSTMLayerWeightsBase* CreateBucketLayerWeights(size_t inputSize, size_t hiddenSize)
+		{
+			if constexpr (BucketSize > LSTM_BUCKET_MAX_HIDDEN)
+			{
+				return nullptr;
+			}
+			else
+			{
+				if (hiddenSize != BucketSize)
+					return CreateBucketLayerWeights<BucketSize + LSTM_BUCKET_HIDDEN_STEP>(inputSize, hiddenSize);
+
+				if (inputSize == 1)
+					return new LSTMBucketLayerWeightsT<1, BucketSize>;
+
+				return new LSTMBucketLayerWeightsT<BucketSize, BucketSize>;
+			}
+		}
 
-				output[i] = headWeights.dot(layers[lastLayer].GetHiddenState()) + headBias;
+		static std::unique_ptr<LSTMLayerWeightsBase> CreateLayerWeights(size_t inputSize, size_t hiddenSize)
+		{
+			LSTMLayerWeightsBase* layerWeights = CreateBucketLayerWeights(inputSize, hiddenSize);
+
+			if (layerWeights == nullptr)
+				layerWeights = new LSTMLayerWeights(inputSize, hiddenSize);
+
+			return std::unique_ptr<LSTMLayerWeightsBase>(layerWeights);
+		}
+
+		std::shared_ptr<LSTMModelWeights> CreateWeights() const
+		{
+			auto newWeights = std::make_shared<LSTMModelWeights>();
+
+			newWeights->Layers.push_back(CreateLayerWeights(1, hiddenSize));
+
+			for (size_t i = 0; i < numLayers - 1; i++)
+			{
+				newWeights->Layers.push_back(CreateLayerWeights(hiddenSize, hiddenSize));
 			}
+
+			return newWeights;
+		}
+
+		void ProcessBlock(const float* input, float* output, const size_t numFrames)
+		{
+			layers[0]->Process(input, numFrames);
+
+			for (size_t layer = 1; layer < numLayers; layer++)
+			{
+				layers[layer]->Process(layers[layer - 1]->GetOutputs(), numFrames);
+			}
+
+			auto outputMap = Eigen::Map<Eigen::RowVectorXf>(output, numFrames);
+
+			outputMap.noalias() = Eigen::Map<const Eigen::VectorXf>(weights->HeadWeights, hiddenSize).transpose() * Eigen::Map<const Eigen::MatrixXf>(layers[numLayers - 1]->GetOutputs(), hiddenSize, numFrames);
+			outputMap.array() += weights->HeadBias;
 		}
 	};
-}
\ No newline at end of file
+}
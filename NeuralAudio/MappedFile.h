@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NeuralAudio
+{
+	// Read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile()
+		{
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile()
+		{
+			Close();
+		}
+
+		bool Open(const std::filesystem::path& path)
+		{
+			Close();
+
+#ifdef _WIN32
+			HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize;
+
+			if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0))
+			{
+				CloseHandle(file);
+
+				return false;
+			}
+
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			CloseHandle(file);	// The mapping keeps the file open
+
+			if (mapping == nullptr)
+				return false;
+
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+			CloseHandle(mapping);	// The view keeps the mapping open
+
+			if (data == nullptr)
+				return false;
+
+			size = (size_t)fileSize.QuadPart;
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+
+			if (fd < 0)
+				return false;
+
+			struct stat fileStat;
+
+			if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0))
+			{
+				close(fd);
+
+				return false;
+			}
+
+			void* mapped = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			close(fd);	// The mapping keeps the file open
+
+			if (mapped == MAP_FAILED)
+				return false;
+
+			data = static_cast<const uint8_t*>(mapped);
+			size = (size_t)fileStat.st_size;
+#endif
+
+			return true;
+		}
+
+		void Close()
+		{
+			if (data != nullptr)
+			{
+#ifdef _WIN32
+				UnmapViewOfFile(data);
+#else
+				munmap(const_cast<uint8_t*>(data), size);
+#endif
+			}
+
+			data = nullptr;
+			size = 0;
+		}
+
+		const uint8_t* GetData() const
+		{
+			return data;
+		}
+
+		size_t GetSize() const
+		{
+			return size;
+		}
+
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+	};
+}
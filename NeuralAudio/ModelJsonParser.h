@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#include "json.hpp"
+#include "ModelWeights.h"
+
+namespace NeuralAudio
+{
+	namespace ModelJsonParserDetail
+	{
+		inline const char* SkipSpace(const char* pos, const char* end)
+		{
+			while ((pos < end) && ((*pos == ' ') || (*pos == '\t') || (*pos == '\n') || (*pos == '\r')))
+				pos++;
+
+			return pos;
+		}
+
+		inline const char* ParseFloat(const char* pos, const char* end, float& value)
+		{
+			// Parse as double and round to float, to get the same values as the regular json path
+			double doubleValue;
+
+#if defined(__cpp_lib_to_chars)
+			auto result = std::from_chars(pos, end, doubleValue);
+
+			if (result.ec != std::errc())
+				return nullptr;
+
+			value = (float)doubleValue;
+
+			return result.ptr;
+#else
+			char buffer[64];
+			size_t length = 0;
+
+			while (((pos + length) < end) && (length < (sizeof(buffer) - 1)) && (std::strchr("+-.0123456789eE", pos[length]) != nullptr))
+			{
+				buffer[length] = pos[length];
+				length++;
+			}
+
+			buffer[length] = 0;
+
+			char* parseEnd;
+			doubleValue = std::strtod(buffer, &parseEnd);
+
+			if (parseEnd == buffer)
+				return nullptr;
+
+			value = (float)doubleValue;
+
+			return pos + (parseEnd - buffer);
+#endif
+		}
+
+		// Parse a flat array of numbers starting at '['. Returns the position after the ']', or nullptr if it isn't a flat number array.
+		inline const char* ParseFloatArray(const char* pos, const char* end, std::vector<float>& weights)
+		{
+			pos = SkipSpace(pos + 1, end);
+
+			if ((pos < end) && (*pos == ']'))
+				return pos + 1;
+
+			while (pos < end)
+			{
+				float value;
+
+				pos = ParseFloat(pos, end, value);
+
+				if (pos == nullptr)
+					return nullptr;
+
+				weights.push_back(value);
+
+				pos = SkipSpace(pos, end);
+
+				if (pos >= end)
+					return nullptr;
+
+				if (*pos == ']')
+					return pos + 1;
+
+				if (*pos != ',')
+					return nullptr;
+
+				pos = SkipSpace(pos + 1, end);
+			}
+
+			return nullptr;
+		}
+	}
+
+	// Parse model json text, reading flat "weights" arrays straight into a weights buffer instead of building a json value for
+	// every weight. The json refers to the buffer the same way as for binary models.
+	inline bool ParseModelJson(const char* start, const char* end, nlohmann::json& modelJson, ModelWeightsPtr& modelWeights)
+	{
+		using namespace ModelJsonParserDetail;
+
+		std::vector<float> weights;
+		std::string reducedJson;
+
+		const char* copyStart = start;
+		const char* pos = start;
+
+		while (pos < end)
+		{
+			if (*pos != '"')
+			{
+				pos++;
+
+				continue;
+			}
+
+			const char* keyStart = ++pos;
+
+			while ((pos < end) && (*pos != '"'))
+			{
+				if (*pos == '\\')
+					pos++;
+
+				pos++;
+			}
+
+			if (pos >= end)
+				break;
+
+			const char* keyEnd = pos++;
+
+			if (((keyEnd - keyStart) != 7) || (std::memcmp(keyStart, "weights", 7) != 0))
+				continue;
+
+			const char* arrayStart = SkipSpace(pos, end);
+
+			if ((arrayStart >= end) || (*arrayStart != ':'))
+				continue;
+
+			arrayStart = SkipSpace(arrayStart + 1, end);
+
+			if ((arrayStart >= end) || (*arrayStart != '['))
+				continue;
+
+			const size_t offset = weights.size();
+
+			const char* arrayEnd = ParseFloatArray(arrayStart, end, weights);
+
+			if (arrayEnd == nullptr)
+			{
+				// Not a flat array (ie: keras layer weights) - leave it to the json parser
+				weights.resize(offset);
+
+				continue;
+			}
+
+			reducedJson.append(copyStart, arrayStart);
+			reducedJson += "{\"offset\":" + std::to_string(offset) + ",\"count\":" + std::to_string(weights.size() - offset) + "}";
+
+			copyStart = pos = arrayEnd;
+		}
+
+		reducedJson.append(copyStart, end);
+
+		modelJson = nlohmann::json::parse(reducedJson, nullptr, false);
+
+		if (modelJson.is_discarded())
+			return false;
+
+		modelWeights = std::make_shared<ModelWeights>(std::move(weights));
+
+		return true;
+	}
+}
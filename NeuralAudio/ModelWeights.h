@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "json.hpp"
+#include "WeightLayout.h"
+
+namespace NeuralAudio
+{
+	// Flat buffer holding all of the weights of a model (including any submodels). The model json refers to ranges of it
+	// with { "offset", "count" } objects in place of its "weights" arrays, so the weights are only stored once however many
+	// times the json is copied.
+	//
+	// A reference with a "layout" ([ [ rows, cols, taps, gateSize ], ... ], see WeightBlock) holds the weights already packed
+	// for the internal engines, so that they can use them in place.
+	//
+	// The buffer either owns its weights, or references memory that is kept alive by an owner (ie: a memory mapped binary model).
+	class ModelWeights
+	{
+	public:
+		ModelWeights(std::vector<float>&& weights) :
+			ownedWeights(std::move(weights)),
+			data(ownedWeights.data()),
+			size(ownedWeights.size())
+		{
+		}
+
+		ModelWeights(const float* weightData, size_t numWeights, std::shared_ptr<const void> dataOwner) :
+			data(weightData),
+			size(numWeights),
+			owner(std::move(dataOwner))
+		{
+		}
+
+		ModelWeights(const ModelWeights&) = delete;
+		ModelWeights& operator=(const ModelWeights&) = delete;
+
+		const float* GetData() const
+		{
+			return data;
+		}
+
+		size_t GetSize() const
+		{
+			return size;
+		}
+
+		std::span<const float> GetWeights(size_t offset, size_t count) const
+		{
+			if ((offset > size) || (count > (size - offset)))
+			{
+				std::stringstream str;
+				str << "Weights [" << offset << ", " << (offset + count) << ") are outside the " << size << " model weights";
+				throw std::runtime_error(str.str());
+			}
+
+			return std::span<const float>(data + offset, count);
+		}
+
+	private:
+		std::vector<float> ownedWeights;
+		const float* data = nullptr;
+		size_t size = 0;
+		std::shared_ptr<const void> owner;
+	};
+
+	using ModelWeightsPtr = std::shared_ptr<const ModelWeights>;
+
+	inline bool IsWeightsReference(const nlohmann::json& weightsJson)
+	{
+		return weightsJson.is_object() && weightsJson.contains("offset") && weightsJson.contains("count");
+	}
+
+	// Returns false if the referenced weights are in NAM order
+	inline bool GetWeightLayout(const nlohmann::json& weightsJson, WeightLayout& layout)
+	{
+		layout.clear();
+
+		if (!weightsJson.contains("layout"))
+			return false;
+
+		for (auto& block : weightsJson.at("layout"))
+			layout.push_back({ block.at(0).get<size_t>(), block.at(1).get<size_t>(), block.at(2).get<size_t>(), block.at(3).get<size_t>() });
+
+		return true;
+	}
+
+	inline nlohmann::json WeightLayoutToJson(const WeightLayout& layout)
+	{
+		nlohmann::json layoutJson = nlohmann::json::array();
+
+		for (auto& block : layout)
+			layoutJson.push_back({ block.Rows, block.Cols, block.Taps, block.GateSize });
+
+		return layoutJson;
+	}
+
+	// The NAM weights referenced by a model's "weights" value. If they are stored packed, they are converted back into
+	// unpackedWeights - otherwise they are used straight from the weights buffer.
+	inline std::span<const float> GetNAMWeights(const nlohmann::json& weightsJson, const ModelWeightsPtr& weights, std::vector<float>& unpackedWeights)
+	{
+		if (!IsWeightsReference(weightsJson) || !weights)
+			throw std::runtime_error("Model weights are not in the weights buffer");
+
+		std::span<const float> referencedWeights = weights->GetWeights(weightsJson.at("offset").get<size_t>(), weightsJson.at("count").get<size_t>());
+
+		WeightLayout layout;
+
+		if (!GetWeightLayout(weightsJson, layout))
+			return referencedWeights;
+
+		if (GetWeightLayoutSize(layout) != referencedWeights.size())
+			throw std::runtime_error("Model weights layout doesn't match the number of weights");
+
+		unpackedWeights.resize(referencedWeights.size());
+
+		UnpackWeights(referencedWeights, layout, unpackedWeights.data());
+
+		return unpackedWeights;
+	}
+
+	// The referenced weights, if they are stored packed in exactly this layout. Otherwise nullptr.
+	inline const float* GetPackedWeights(const nlohmann::json& weightsJson, const ModelWeightsPtr& weights, const WeightLayout& layout)
+	{
+		WeightLayout storedLayout;
+
+		if (!IsWeightsReference(weightsJson) || !weights || !GetWeightLayout(weightsJson, storedLayout) || (storedLayout != layout))
+			return nullptr;
+
+		return weights->GetWeights(weightsJson.at("offset").get<size_t>(), weightsJson.at("count").get<size_t>()).data();
+	}
+
+	namespace ModelWeightsDetail
+	{
+		inline bool IsWeightArray(const nlohmann::json& weightsJson)
+		{
+			if (!weightsJson.is_array())
+				return false;
+
+			for (auto& value : weightsJson)
+			{
+				if (!value.is_number())
+					return false;
+			}
+
+			return true;
+		}
+
+		inline nlohmann::json ExtractWeights(const nlohmann::json& modelJson, std::vector<float>& weights)
+		{
+			if (modelJson.is_object())
+			{
+				nlohmann::json reducedJson = nlohmann::json::object();
+
+				for (auto& [key, value] : modelJson.items())
+				{
+					if ((key == "weights") && IsWeightArray(value))
+					{
+						reducedJson[key] = { { "offset", weights.size() }, { "count", value.size() } };
+
+						for (auto& weight : value)
+							weights.push_back(weight.get<float>());
+					}
+					else
+					{
+						reducedJson[key] = ExtractWeights(value, weights);
+					}
+				}
+
+				return reducedJson;
+			}
+
+			if (modelJson.is_array() && !IsWeightArray(modelJson))
+			{
+				nlohmann::json reducedJson = nlohmann::json::array();
+
+				for (auto& value : modelJson)
+					reducedJson.push_back(ExtractWeights(value, weights));
+
+				return reducedJson;
+			}
+
+			return modelJson;
+		}
+
+		inline bool CheckLayout(const nlohmann::json& layoutJson, size_t count)
+		{
+			if (!layoutJson.is_array())
+				return false;
+
+			size_t layoutSize = 0;
+
+			for (auto& block : layoutJson)
+			{
+				if (!block.is_array() || (block.size() != 4))
+					return false;
+
+				for (auto& value : block)
+				{
+					if (!value.is_number_unsigned())
+						return false;
+				}
+
+				const size_t rows = block.at(0);
+				const size_t cols = block.at(1);
+				const size_t taps = block.at(2);
+				const size_t gateSize = block.at(3);
+
+				if ((rows == 0) || (cols == 0) || (taps == 0) || ((gateSize != 0) && (rows != (4 * gateSize))))
+					return false;
+
+				const size_t remaining = count - layoutSize;
+
+				if ((rows > remaining) || (cols > (remaining / rows)) || (taps > (remaining / (rows * cols))))
+					return false;
+
+				layoutSize += rows * cols * taps;
+			}
+
+			return layoutSize == count;
+		}
+
+		inline bool CheckWeights(const nlohmann::json& modelJson, size_t numWeights)
+		{
+			if (modelJson.is_object())
+			{
+				for (auto& [key, value] : modelJson.items())
+				{
+					if ((key == "weights") && IsWeightsReference(value))
+					{
+						if (!value.at("offset").is_number_unsigned() || !value.at("count").is_number_unsigned())
+							return false;
+
+						const size_t offset = value.at("offset");
+						const size_t count = value.at("count");
+
+						if ((offset > numWeights) || (count > (numWeights - offset)))
+							return false;
+
+						if (value.contains("layout") && !CheckLayout(value.at("layout"), count))
+							return false;
+					}
+					else if (!CheckWeights(value, numWeights))
+					{
+						return false;
+					}
+				}
+			}
+			else if (modelJson.is_array())
+			{
+				for (auto& value : modelJson)
+				{
+					if (!CheckWeights(value, numWeights))
+						return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	// Copy of the model json with its flat "weights" arrays (including those of any submodels) moved into a weights buffer
+	inline nlohmann::json ExtractModelWeights(const nlohmann::json& modelJson, ModelWeightsPtr& weights)
+	{
+		std::vector<float> weightData;
+
+		nlohmann::json reducedJson = ModelWeightsDetail::ExtractWeights(modelJson, weightData);
+
+		weights = std::make_shared<ModelWeights>(std::move(weightData));
+
+		return reducedJson;
+	}
+
+	// Check that all weight references are inside a buffer of numWeights weights, and that their layouts fit them
+	inline bool CheckModelWeights(const nlohmann::json& modelJson, size_t numWeights)
+	{
+		return ModelWeightsDetail::CheckWeights(modelJson, numWeights);
+	}
+
+	// Turn weight references back into json arrays, for code that needs the standard model json
+	inline void ExpandModelWeights(nlohmann::json& modelJson, const ModelWeightsPtr& weights)
+	{
+		if (modelJson.is_object())
+		{
+			for (auto& [key, value] : modelJson.items())
+			{
+				if ((key == "weights") && IsWeightsReference(value))
+				{
+					std::vector<float> unpackedWeights;
+					std::span<const float> namWeights = GetNAMWeights(value, weights, unpackedWeights);
+
+					value = std::vector<float>(namWeights.begin(), namWeights.end());
+				}
+				else
+				{
+					ExpandModelWeights(value, weights);
+				}
+			}
+		}
+		else if (modelJson.is_array())
+		{
+			for (auto& value : modelJson)
+				ExpandModelWeights(value, weights);
+		}
+	}
+}
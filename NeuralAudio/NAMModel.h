@@ -2,6 +2,8 @@
 
 #include "NeuralModel.h"
 #include "NeuralModelImpl.h"
+#include "ModelWeights.h"
+#include <mutex>
 #include <NAM/activations.h>
 #include <NAM/get_dsp.h>
 #include <NAM/dsp.h>
@@ -34,15 +36,43 @@ namespace NeuralAudio
 			return namModel->GetPrewarmSamples();
 		}
 
-		bool LoadFromJson(const nlohmann::json& modelJson)
+		// The json refers to the weights buffer for its weights
+		bool LoadFromJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights)
 		{
 			slimmableSize = loader->GetDefaultQualityScaleFactor();
 
 			ReadNAMConfig(modelJson);
 
-			nam::ScopedPrewarmOnResetDefault scoped_prewarm_default(false);
+			{
+				// NAM Core doesn't document the prewarm default as thread-local, and composite submodels can load on several threads
+				std::lock_guard<std::mutex> lock(GetNAMLoadMutex());
+
+				nam::ScopedPrewarmOnResetDefault scoped_prewarm_default(false);
+
+				// NAM Core takes the model weights as a float vector, so only submodel weights (in the config) need to be json arrays
+				nam::dspData dspData;
+
+				dspData.version = modelJson.at("version");
+				dspData.architecture = modelJson.at("architecture");
+				dspData.config = modelJson.at("config");
+
+				ExpandModelWeights(dspData.config, weights);
+
+				if (modelJson.contains("metadata"))
+					dspData.metadata = modelJson.at("metadata");
+
+				if (modelJson.contains("weights"))
+				{
+					std::vector<float> unpackedWeights;
+					std::span<const float> namWeights = GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights);
 
-			namModel = nam::get_dsp(modelJson);
+					dspData.weights.assign(namWeights.begin(), namWeights.end());
+				}
+
+				dspData.expected_sample_rate = (modelJson.contains("sample_rate") && modelJson.at("sample_rate").is_number()) ? modelJson.at("sample_rate").get<double>() : -1.0;
+
+				namModel = nam::get_dsp(dspData);
+			}
 
 			auto* slim = dynamic_cast<nam::SlimmableModel*>(namModel.get());
 
@@ -109,6 +139,13 @@ namespace NeuralAudio
 		}
 
 	private:
+		static std::mutex& GetNAMLoadMutex()
+		{
+			static std::mutex loadMutex;
+
+			return loadMutex;
+		}
+
 		std::unique_ptr<nam::DSP> namModel = nullptr;
 		int currentMaxSize = -1;
 		float slimmableSize = 1.0f;
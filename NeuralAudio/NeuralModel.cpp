@@ -1,4 +1,12 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
 #include <list>
+#include <sstream>
 #include "NeuralModel.h"
 #ifdef BUILD_NAMCORE
 #include "NAMModel.h"
@@ -9,17 +17,38 @@
 #include "RTNeuralModel.h"
 #include "InternalModel.h"
 #include "CompositeModel.h"
+#include "FixedQuantumModel.h"
+#include "ImpulseResponseModel.h"
+#include "ChainModel.h"
+#include "BinaryModel.h"
+#include "ModelWeights.h"
+#include "MappedFile.h"
+#include "SharedMemory.h"
+#include "ModelJsonParser.h"
 
 namespace NeuralAudio
 {
-	static bool modelDefsAreLoaded;
+	static std::once_flag modelDefsLoadedFlag;
 
 	static std::list<InternalWaveNetDefinitionBase*> internalWavenetModelDefs;
 	static std::list<InternalLSTMDefinitionBase*> internalLSTMModelDefs;
+	static std::list<InternalGRUDefinitionBase*> internalGRUModelDefs;
+	static std::list<InternalConvNetDefinitionBase*> internalConvNetModelDefs;
+
+	// Backends being tried by an EModelLoadMode::Auto load on this thread. They override the loader settings without
+	// changing them, so loads running on other threads aren't affected.
+	static thread_local EModelLoadMode autoLSTMLoadMode = EModelLoadMode::Auto;
+	static thread_local EModelLoadMode autoWaveNetLoadMode = EModelLoadMode::Auto;
+
+	// Set on threads running a parallel load, so that nested parallel loads (ie: composite models in a batch) run serially
+	static thread_local bool inParallelLoad = false;
+
+	// Held while timing models (Auto backend selection and kernel tuning), so benchmarks from parallel loads don't skew each other
+	static std::mutex benchmarkMutex;
 
 	static void EnsureModelDefsAreLoaded()
 	{
-		if (!modelDefsAreLoaded)
+		std::call_once(modelDefsLoadedFlag, []()
 		{
 #ifdef BUILD_INTERNAL_STATIC_WAVENET
 			internalWavenetModelDefs.push_back(new InternalA1WaveNetDefinitionT<16, 8>);	// Standard
@@ -38,40 +67,147 @@ namespace NeuralAudio
 			internalLSTMModelDefs.push_back(new InternalLSTMDefinitionT<2, 16>);
 #endif
 
+#ifdef BUILD_INTERNAL_STATIC_GRU
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<1, 8>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<1, 12>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<1, 16>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<1, 24>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<2, 8>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<2, 12>);
+			internalGRUModelDefs.push_back(new InternalGRUDefinitionT<2, 16>);
+#endif
+
+#ifdef BUILD_INTERNAL_STATIC_CONVNET
+			internalConvNetModelDefs.push_back(new InternalConvNetDefinitionT<32>);	// Standard
+			internalConvNetModelDefs.push_back(new InternalConvNetDefinitionT<16>);	// Lite
+			internalConvNetModelDefs.push_back(new InternalConvNetDefinitionT<8>);	// Feather
+			internalConvNetModelDefs.push_back(new InternalConvNetDefinitionT<4>);	// Nano
+#endif
+
 #ifdef BUILD_STATIC_RTNEURAL
 			EnsureRTNeuralModelDefsAreLoaded();
 #endif
-
-			modelDefsAreLoaded = true;
-		}
+		});
 	}
 
-	static InternalWaveNetDefinitionBase* FindInternalWaveNetDefinition(size_t NumChannels, size_t HeadSize)
+	// Relative cost of the dynamic implementations compared to the static ones, used to decide when it is worth running
+	// a model zero-padded in a larger static definition
+	static const double dynamicWaveNetCostFactor = 1.5;
+	static const double dynamicLSTMCostFactor = 1.2;
+	static const double dynamicGRUCostFactor = 1.2;
+	static const double dynamicConvNetCostFactor = 1.5;
+
+	// Returns an exact match if there is one. Otherwise returns the cheapest larger definition that can run the model
+	// zero-padded, as long as it doesn't cost more than maxFLOPsPerSample.
+	static InternalWaveNetDefinitionBase* FindInternalWaveNetDefinition(size_t numChannels, size_t headSize, bool standardDilations, size_t maxFLOPsPerSample)
 	{
+		InternalWaveNetDefinitionBase* bestModel = nullptr;
+
 		for (auto const& model : internalWavenetModelDefs)
 		{
-			if ((NumChannels == model->GetNumChannels()) && (HeadSize == model->GetHeadSize()))
+			if (model->HasStandardDilations() != standardDilations)
+				continue;
+
+			if ((numChannels == model->GetNumChannels()) && (headSize == model->GetHeadSize()))
 				return model;
+
+			if ((model->GetNumChannels() >= numChannels) && (model->GetHeadSize() >= headSize) && (model->GetFLOPsPerSample() <= maxFLOPsPerSample))
+			{
+				if ((bestModel == nullptr) || (model->GetFLOPsPerSample() < bestModel->GetFLOPsPerSample()))
+					bestModel = model;
+			}
 		}
 
-		return nullptr;
+		return bestModel;
 	}
 
 	static InternalLSTMDefinitionBase* FindInternalLSTMDefinition(size_t numLayers, size_t hiddenSize)
 	{
+		InternalLSTMDefinitionBase* bestModel = nullptr;
+
+		// The dynamic LSTM runs at its bucketed size
+		const size_t maxFLOPsPerSample = (size_t)(GetLSTMFLOPsPerSample(numLayers, LSTMModel::GetBucketHiddenSize(hiddenSize)) * dynamicLSTMCostFactor);
+
 		for (auto const& model : internalLSTMModelDefs)
 		{
-			if ((numLayers == model->GetNumLayers()) && (hiddenSize == model->GetHiddenSize()))
+			if (numLayers != model->GetNumLayers())
+				continue;
+
+			if (hiddenSize == model->GetHiddenSize())
+				return model;
+
+			if ((model->GetHiddenSize() > hiddenSize) && (model->GetFLOPsPerSample() <= maxFLOPsPerSample))
+			{
+				if ((bestModel == nullptr) || (model->GetFLOPsPerSample() < bestModel->GetFLOPsPerSample()))
+					bestModel = model;
+			}
+		}
+
+		return bestModel;
+	}
+
+	static InternalGRUDefinitionBase* FindInternalGRUDefinition(size_t numLayers, size_t hiddenSize)
+	{
+		InternalGRUDefinitionBase* bestModel = nullptr;
+
+		// The dynamic GRU runs at its bucketed size
+		const size_t maxFLOPsPerSample = (size_t)(GetGRUFLOPsPerSample(numLayers, GRUModel::GetBucketHiddenSize(hiddenSize)) * dynamicGRUCostFactor);
+
+		for (auto const& model : internalGRUModelDefs)
+		{
+			if (numLayers != model->GetNumLayers())
+				continue;
+
+			if (hiddenSize == model->GetHiddenSize())
+				return model;
+
+			if ((model->GetHiddenSize() > hiddenSize) && (model->GetFLOPsPerSample() <= maxFLOPsPerSample))
+			{
+				if ((bestModel == nullptr) || (model->GetFLOPsPerSample() < bestModel->GetFLOPsPerSample()))
+					bestModel = model;
+			}
+		}
+
+		return bestModel;
+	}
+
+	static InternalConvNetDefinitionBase* FindInternalConvNetDefinition(size_t numChannels, size_t numBlocks)
+	{
+		InternalConvNetDefinitionBase* bestModel = nullptr;
+
+		const size_t maxFLOPsPerSample = (size_t)(GetConvNetFLOPsPerSample(numChannels, numBlocks) * dynamicConvNetCostFactor);
+
+		for (auto const& model : internalConvNetModelDefs)
+		{
+			if (numChannels == model->GetNumChannels())
 				return model;
+
+			if ((model->GetNumChannels() > numChannels) && (model->GetFLOPsPerSample() <= maxFLOPsPerSample))
+			{
+				if ((bestModel == nullptr) || (model->GetFLOPsPerSample() < bestModel->GetFLOPsPerSample()))
+					bestModel = model;
+			}
 		}
 
-		return nullptr;
+		return bestModel;
+	}
+
+	// Checks that the layer arrays are connected the way the static A1 definitions expect, so the model can be zero-padded
+	static bool IsPaddableA1WaveNet(const nlohmann::json& firstLayerConfig, const nlohmann::json& secondLayerConfig)
+	{
+		return (firstLayerConfig.at("input_size") == 1) && (firstLayerConfig.at("condition_size") == 1) && (firstLayerConfig.at("kernel_size") == 3) &&
+			(secondLayerConfig.at("input_size") == firstLayerConfig.at("channels")) && (secondLayerConfig.at("condition_size") == 1) &&
+			(secondLayerConfig.at("channels") == firstLayerConfig.at("head_size")) && (secondLayerConfig.at("head_size") == 1) && (secondLayerConfig.at("kernel_size") == 3) &&
+			(firstLayerConfig.at("activation") == "Tanh") && (secondLayerConfig.at("activation") == "Tanh") &&
+			!firstLayerConfig.at("gated") && !secondLayerConfig.at("gated");
 	}
 
 	static std::vector<int> stdDilations = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 };
 	static std::vector<int> liteDilations = { 1, 2, 4, 8, 16, 32, 64 };
 	static std::vector<int> liteDilations2 = { 128, 256, 512, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 };
 
+	static std::vector<int> convNetDilations = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048 };
+
 	static std::vector<int> a2KernelSizes = { 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 15, 15, 6, 6, 6, 6, 6, 6, 6 };
 	static std::vector<int> a2Dilations = { 1, 3, 7, 17, 41, 101, 239, 1, 3, 7, 17, 41, 101, 239, 1, 13, 1, 3, 7, 17, 41, 101, 239 };
 
@@ -321,247 +457,976 @@ namespace NeuralAudio
 		if (!std::filesystem::exists(modelPath))
 			return nullptr;
 
-		std::ifstream jsonStream(modelPath, std::ifstream::binary);
+		auto mappedFile = std::make_shared<MappedFile>();
 
-		return CreateFromStream(jsonStream, modelPath.extension(), doPrewarm);
-	}
+		if (!mappedFile->Open(modelPath))
+			return nullptr;
 
+		std::filesystem::path extension = modelPath.extension();
+
+		// Binary model weights are used straight from the mapping, so it stays open for as long as they are in use
+		std::shared_ptr<const void> dataOwner = (extension == ".namb") ? mappedFile : nullptr;
+
+		return CreateFromModelData(mappedFile->GetData(), mappedFile->GetSize(), extension, std::move(dataOwner), doPrewarm);
+	}
 
 	NeuralModel* NeuralModelLoader::CreateFromStream(std::basic_istream<char>& jsonStream, const std::filesystem::path& extension, bool doPrewarm)
 	{
-		nlohmann::json modelJson;
-		jsonStream >> modelJson;
+		std::string data((std::istreambuf_iterator<char>(jsonStream)), std::istreambuf_iterator<char>());
 
-		return CreateFromJson(modelJson, extension, doPrewarm);
+		std::filesystem::path modelExtension = extension;
+
+		return CreateFromModelData(data.data(), data.size(), modelExtension, nullptr, doPrewarm);
 	}
 
-	NeuralModel* NeuralModelLoader::CreateFromJson(nlohmann::json& modelJson, const std::filesystem::path& extension, bool doPrewarm)
+	std::future<NeuralModel*> NeuralModelLoader::LoadAsync(const std::filesystem::path& modelPath, bool doPrewarm)
 	{
-		EnsureModelDefsAreLoaded();
+		return std::async(std::launch::async, [this, modelPath, doPrewarm]() -> NeuralModel*
+		{
+			try
+			{
+				return CreateFromFile(modelPath, doPrewarm);
+			}
+			catch (...)
+			{
+				return nullptr;
+			}
+		});
+	}
 
-		NeuralModelImpl* newModel = nullptr;
+	std::vector<NeuralModel*> NeuralModelLoader::CreateFromFiles(const std::vector<std::filesystem::path>& modelPaths, bool doPrewarm)
+	{
+		std::vector<NeuralModel*> models(modelPaths.size(), nullptr);
 
-		if (extension == ".nam")
+		try
 		{
-			OversampleNAMConfig(modelJson, externalSampleRate);
+			RunParallel(modelPaths.size(), [&](size_t index)
+			{
+				try
+				{
+					models[index] = CreateFromFile(modelPaths[index], doPrewarm);
+				}
+				catch (...)
+				{
+				}
+			});
+		}
+		catch (...)
+		{
+			for (auto model : models)
+				delete model;
 
-			std::string arch = modelJson.at("architecture");
+			throw;
+		}
 
-			if (arch == "SlimmableContainer")	// Packed A2 multi-model file 
-			{
-				ScalableCompositeModel* model = new ScalableCompositeModel;
+		return models;
+	}
 
-				model->SetModelLoader(this);
-				model->LoadFromJson(modelJson);
+	void NeuralModelLoader::RunParallel(size_t numTasks, const std::function<void(size_t)>& task)
+	{
+		size_t numThreads = (maxLoadThreads > 0) ? (size_t)maxLoadThreads : (size_t)std::max(std::thread::hardware_concurrency(), 1u);
 
-				newModel = model;
-			}
+		numThreads = std::min(numThreads, numTasks);
 
+		if (inParallelLoad || (numThreads <= 1))
+		{
+			for (size_t index = 0; index < numTasks; index++)
+				task(index);
 
-			if (newModel == nullptr)
-			{
-				std::string version = modelJson.at("version");
+			return;
+		}
 
-#ifdef BUILD_NAMCORE
-				bool loadA2WithNAMCore = true;
+		std::atomic<size_t> nextTask = 0;
+		std::mutex errorMutex;
+		std::exception_ptr taskError;
 
-#ifdef BUILD_STATIC_INTERNAL_NAMA2
-				loadA2WithNAMCore = false;
-#endif
-				if ((wavenetLoadMode == EModelLoadMode::NAMCore) || (NAMIsA2(version) && (loadA2WithNAMCore || !NAMIsA2Standard(modelJson))))
-				{
-					NAMModel* model = new NAMModel;
+		// Workers need to try the same backends as this thread, if it is in the middle of an Auto load
+		const EModelLoadMode lstmMode = autoLSTMLoadMode;
+		const EModelLoadMode wavenetMode = autoWaveNetLoadMode;
 
-					model->SetModelLoader(this);
-					model->LoadFromJson(modelJson);
+		auto worker = [&]()
+		{
+			autoLSTMLoadMode = lstmMode;
+			autoWaveNetLoadMode = wavenetMode;
+			inParallelLoad = true;
 
-					newModel = model;
+			size_t index;
+
+			while ((index = nextTask++) < numTasks)
+			{
+				try
+				{
+					task(index);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(errorMutex);
+
+					if (!taskError)
+						taskError = std::current_exception();
 				}
-#endif
 			}
 
-			auto& config = modelJson.at("config");
+			inParallelLoad = false;
+		};
 
-			if (newModel == nullptr)
-			{
-				if (arch == "WaveNet")
-				{
-					if (config.at("layers").size() == 1)
-					{
-#ifdef BUILD_STATIC_INTERNAL_NAMA2
-						auto& layerConfig = config.at("layers").at(0);
+		std::vector<std::thread> threads;
 
-						if (CheckIntegerSequence(layerConfig.at("dilations"), a2Dilations))
-						{
-							if (layerConfig.at("channels") == 3)
-							{
-								auto model = new InternalWaveNetModelT<NeuralAudio::WaveNetModelT<float, NeuralAudio::WaveNetLayerArrayT<float, 1, 1, 1, 16, 1, 3, A2KernelSizes, A2Dilations, true, EActivationType::LeakyReLU>>>();
+		try
+		{
+			for (size_t thread = 1; thread < numThreads; thread++)
+				threads.emplace_back(worker);
+		}
+		catch (...)
+		{
+			// Destroying a joinable thread terminates the program, so stop handing out tasks and wait for the started workers
+			nextTask = numTasks;
 
-								if (model != nullptr)
-								{
-									model->SetModelLoader(this);
-									model->LoadFromNAMJson(modelJson);
+			for (auto& thread : threads)
+				thread.join();
 
-									newModel = model;
-								}
-							}
-							else if (layerConfig.at("channels") == 8)
-							{
-								auto model = new InternalWaveNetModelT <NeuralAudio::WaveNetModelT<float, NeuralAudio::WaveNetLayerArrayT<float, 1, 1, 1, 16, 1, 8, A2KernelSizes, A2Dilations, true, EActivationType::LeakyReLU>>>();
+			throw;
+		}
 
-								if (model != nullptr)
-								{
-									model->SetModelLoader(this);
-									model->LoadFromNAMJson(modelJson);
+		worker();	// This thread does its share too
 
-									newModel = model;
-								}
-							}
-						}
-#endif
-					}
-					else if (config.at("layers").size() == 2)
-					{
-						auto& firstLayerConfig = config.at("layers").at(0);
-						auto& secondLayerConfig = config.at("layers").at(1);
+		for (auto& thread : threads)
+			thread.join();
 
-						if (!firstLayerConfig.at("gated") && !secondLayerConfig.at("gated") && !firstLayerConfig.at("head_bias") && secondLayerConfig.at("head_bias"))
-						{
-							bool isOfficialArchitecture = false;
+		if (taskError)
+			std::rethrow_exception(taskError);
+	}
 
-							if (firstLayerConfig.at("channels") == 16)
-							{
-								if (CheckIntegerSequence(firstLayerConfig.at("dilations"), stdDilations) && CheckIntegerSequence(secondLayerConfig.at("dilations"), stdDilations))
-								{
-									isOfficialArchitecture = true;
-								}
-							}
-							else
-							{
-								if (CheckIntegerSequence(firstLayerConfig.at("dilations"), liteDilations) && CheckIntegerSequence(secondLayerConfig.at("dilations"), liteDilations2))
-								{
-									isOfficialArchitecture = true;
-								}
-							}
+	NeuralModel* NeuralModelLoader::CreateFromBinary(const void* data, size_t size, bool doPrewarm)
+	{
+		std::filesystem::path extension = ".namb";
 
-							if (isOfficialArchitecture)
-							{
-								if (newModel == nullptr)
-								{
-									auto modelDef = FindInternalWaveNetDefinition(firstLayerConfig.at("channels"), firstLayerConfig.at("head_size"));
+		return CreateFromModelData(data, size, extension, nullptr, doPrewarm);
+	}
 
-									if (modelDef != nullptr)
-									{
-										auto model = modelDef->CreateModel();
+	static uint64_t GetModelDataHash(const void* data, size_t size)
+	{
+		// 64-bit FNV-1a
+		const uint64_t prime = 0x100000001b3ull;
+		uint64_t hash = 0xcbf29ce484222325ull;
 
-										model->SetModelLoader(this);
-										model->LoadFromNAMJson(modelJson);
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
 
-										newModel = model;
-									}
-								}
-							}
-						}
-					}
+		for (size_t pos = 0; pos < size; pos++)
+			hash = (hash ^ bytes[pos]) * prime;
 
-					if (newModel == nullptr)
-					{
-						// Use a dynamic model if we had no static definition
-						InternalWaveNetModelDyn* model = new InternalWaveNetModelDyn;
+		return hash;
+	}
 
-						model->SetModelLoader(this);
+	static std::string GetModelDataKey(uint64_t hash, size_t size, const std::filesystem::path& extension)
+	{
+		return extension.string() + ":" + std::to_string(size) + ":" + std::to_string(hash);
+	}
 
-						if (model->LoadFromNAMJson(modelJson))
-						{
-							newModel = model;
-						}
-					}
-				}
-				else if (arch == "LSTM")
-				{
-#ifdef BUILD_STATIC_RTNEURAL
-					if (lstmLoadMode == EModelLoadMode::RTNeural)
-					{
-						newModel = RTNeuralLoadNAMLSTM(modelJson, this);
-					}
-#endif
+	// Loader settings change the models that are built from the same data, so they are part of the key
+	std::string NeuralModelLoader::GetModelCacheKey(uint64_t hash, size_t size, const std::filesystem::path& extension)
+	{
+		std::ostringstream key;
 
-					if (newModel == nullptr)
-					{
-						auto modelDef = FindInternalLSTMDefinition(config.at("num_layers"), config.at("hidden_size"));
+		key.precision(9);
 
-						if (modelDef != nullptr)
-						{
-							auto model = modelDef->CreateModel();
+		key << GetModelDataKey(hash, size, extension) << ":" << externalSampleRate << ":" << (int)lstmLoadMode << ":" << (int)wavenetLoadMode << ":"
+			<< (int)compositeLoadMode << ":" << audioInputLevelDBu << ":" << defaultMaxAudioBufferSize << ":" << defaultQualityScaleFactor << ":"
+			<< fixedProcessingQuantum << ":" << kernelAutoTuning << ":" << kernelTuningCachePath.string();
 
-							model->SetModelLoader(this);
-							model->LoadFromNAMJson(modelJson);
+		return key.str();
+	}
 
-							newModel = model;
-						}
+	static std::string GetSharedSegmentName(uint64_t hash, size_t size, const std::filesystem::path& extension)
+	{
+		// Fold the size and extension into the hash to keep the name short (macOS limits names to 31 characters)
+		std::string key = GetModelDataKey(hash, size, extension);
 
-						// Use a dynamic model if we had no static definition
-						if (newModel == nullptr)
-						{
-							InternalLSTMModelDyn* model = new InternalLSTMModelDyn;
+		char name[32];
+		std::snprintf(name, sizeof(name), "/NeuralAudio%d-%016llx", BINARY_MODEL_VERSION, (unsigned long long)GetModelDataHash(key.data(), key.size()));
 
-							model->SetModelLoader(this);
+		return name;
+	}
 
-							if (model->LoadFromNAMJson(modelJson))
-							{
-								newModel = model;
-							}
-						}
-					}
-				}
-			}
+	// Store the weights of a .nam model ready for the internal engines to use in place. Leaves the model as it is if it can't
+	// be packed.
+	static bool PackNAMModelWeights(nlohmann::json& modelJson, ModelWeightsPtr& weights)
+	{
+		try
+		{
+			std::vector<float> packedWeights;
+
+			nlohmann::json packedJson = PackModelWeights(modelJson, weights, packedWeights);
+
+			modelJson = std::move(packedJson);
+			weights = std::make_shared<ModelWeights>(std::move(packedWeights));
 		}
-		else if ((extension == ".json") || (extension == ".aidax"))
+		catch (const std::exception&)
 		{
-			const auto layers = modelJson.at("layers");
-			const size_t numLayers = layers.size() - 1;
-			const std::string modelType = layers.at(0).at("type");
-			const int hiddenSize = layers.at(0).at("shape").back();
+			return false;
+		}
 
-			if (modelType == "lstm")
-			{
-#ifdef BUILD_STATIC_RTNEURAL
-				if (lstmLoadMode == EModelLoadMode::RTNeural)
-				{
-					newModel = RTNeuralLoadKeras(modelJson, this);
-				}
-#endif
+		return true;
+	}
 
-				if (newModel == nullptr && lstmLoadMode == EModelLoadMode::Internal)
-				{
-					if (numLayers == 1)
-					{
-						auto modelDef = FindInternalLSTMDefinition(numLayers, hiddenSize);
+	// Extension is updated to that of the original model for binary models. If there is a data owner, binary model weights
+	// reference the data in place.
+	bool NeuralModelLoader::ReadModelData(const void* data, size_t size, std::filesystem::path& extension, nlohmann::json& modelJson, ModelWeightsPtr& weights,
+		std::shared_ptr<const void> dataOwner)
+	{
+		std::string segmentName;
 
-						if (modelDef != nullptr)
-						{
-							auto model = modelDef->CreateModel();
+		// Binary models are already in the packed format, and memory mapped when loaded from a file
+		const bool useSharedData = sharedModelData && (extension != ".namb");
 
-							if (model->LoadFromKerasJson(modelJson))
-							{
-								newModel = model;
-							}
-						}
-					}
+		if (useSharedData)
+			segmentName = GetSharedSegmentName(GetModelDataHash(data, size), size, extension);
 
-					if (newModel == nullptr)
-					{
-						// Use a dynamic model if we had no static definition
-						InternalLSTMModelDyn* model = new InternalLSTMModelDyn;
+		const bool haveSharedData = useSharedData && ReadSharedModelData(segmentName, extension, modelJson, weights);
 
-						if (model->LoadFromKerasJson(modelJson))
-						{
-							newModel = model;
-						}
+		if (!haveSharedData)
+		{
+			const char* text = static_cast<const char*>(data);
+
+			if (extension == ".namb")
+			{
+				if (!ReadBinaryModel(data, size, modelJson, weights, extension, std::move(dataOwner)))
+					return false;
+			}
+			else if (extension == ".nam")
+			{
+				if (!ParseModelJson(text, text + size, modelJson, weights))
+					return false;
+
+				// Cached and shared weights are referenced by every model built from them. If packing fails, the load will too.
+				if (modelCaching || useSharedData)
+					PackNAMModelWeights(modelJson, weights);
+			}
+			else
+			{
+				modelJson = nlohmann::json::parse(text, text + size, nullptr, false);
+
+				if (modelJson.is_discarded())
+					return false;
+
+				weights = std::make_shared<ModelWeights>(std::vector<float>());	// Keras models keep their weights in the json
+			}
+
+			if (useSharedData)
+				StoreSharedModelData(segmentName, extension, modelJson, weights);
+		}
+
+		return true;
+	}
+
+	// With model caching, a model that has been loaded before is cloned from a cached copy that shares its weights, so only
+	// its state is allocated. Models that can't be cloned are built again from the cached model data.
+	NeuralModel* NeuralModelLoader::CreateFromModelData(const void* data, size_t size, std::filesystem::path& extension, std::shared_ptr<const void> dataOwner, bool doPrewarm)
+	{
+		nlohmann::json modelJson;
+		ModelWeightsPtr weights;
+
+		if (!modelCaching)
+		{
+			if (!ReadModelData(data, size, extension, modelJson, weights, std::move(dataOwner)))
+				return nullptr;
+
+			return CreateFromJson(modelJson, weights, extension, doPrewarm);
+		}
+
+		const std::string cacheKey = GetModelCacheKey(GetModelDataHash(data, size), size, extension);
+
+		NeuralModel* clonedModel = nullptr;
+		bool cloneIsPrewarmed = false;
+		std::shared_ptr<const nlohmann::json> cachedJson;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			auto cached = modelCache.find(cacheKey);
+
+			if (cached != modelCache.end())
+			{
+				// Cloning isn't thread safe, so it is done under the lock
+				if (cached->second.Model)
+				{
+					clonedModel = cached->second.Model->Clone();
+					cloneIsPrewarmed = cached->second.IsPrewarmed;
+				}
+
+				cachedJson = cached->second.ModelJson;
+				weights = cached->second.Weights;
+				extension = cached->second.Extension;
+			}
+		}
+
+		if (clonedModel != nullptr)
+		{
+			if (doPrewarm && !cloneIsPrewarmed)
+				clonedModel->Prewarm();
+
+			return clonedModel;
+		}
+
+		// Copy outside the lock - the cached data is immutable. The weights aren't in the json, so they are shared, not copied.
+		if (cachedJson)
+		{
+			modelJson = *cachedJson;
+
+			return CreateFromJson(modelJson, weights, extension, doPrewarm);
+		}
+
+		if (!ReadModelData(data, size, extension, modelJson, weights, std::move(dataOwner)))
+			return nullptr;
+
+		CachedModelData cachedData;
+
+		cachedData.ModelJson = std::make_shared<const nlohmann::json>(modelJson);	// Loading can modify the json
+
+		NeuralModel* newModel = CreateFromJson(modelJson, weights, extension, doPrewarm);
+
+		if (newModel == nullptr)
+			return nullptr;
+
+		// The cached copy is never processed, so it keeps the state the model was loaded with
+		cachedData.Model.reset(newModel->Clone());
+		cachedData.IsPrewarmed = doPrewarm;
+
+		if (cachedData.Model)
+		{
+			cachedData.ModelJson = nullptr;
+		}
+		else
+		{
+			cachedData.Weights = weights;
+			cachedData.Extension = extension;
+		}
+
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		modelCache[cacheKey] = std::move(cachedData);
+
+		return newModel;
+	}
+
+	bool NeuralModelLoader::ReadSharedModelData(const std::string& segmentName, std::filesystem::path& extension, nlohmann::json& modelJson, ModelWeightsPtr& weights)
+	{
+		std::shared_ptr<SharedMemorySegment> segment;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			auto existing = sharedSegments.find(segmentName);
+
+			if (existing != sharedSegments.end())
+				segment = existing->second;
+		}
+
+		if (!segment)
+		{
+			segment = std::make_shared<SharedMemorySegment>();
+
+			if (!segment->Open(segmentName))
+				return false;
+		}
+
+		// The weights reference the segment in place, and keep it mapped while they are in use
+		if (!ReadBinaryModel(segment->GetData(), segment->GetSize(), modelJson, weights, extension, segment))
+			return false;
+
+		// Keep it mapped - on Windows, that is what keeps the segment around for other processes
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		sharedSegments[segmentName] = segment;
+
+		return true;
+	}
+
+	// If the segment is created, the model json and weights are switched over to it, so this process doesn't keep its own copy
+	void NeuralModelLoader::StoreSharedModelData(const std::string& segmentName, std::filesystem::path& extension, nlohmann::json& modelJson, ModelWeightsPtr& weights)
+	{
+		std::ostringstream stream;
+
+		WriteBinaryModel(modelJson, *weights, extension, stream);
+
+		const std::string data = stream.str();
+
+		auto segment = std::make_shared<SharedMemorySegment>();
+
+		// Fails if another process got there first, which is fine
+		if (!segment->Create(segmentName, data.data(), data.size()))
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			sharedSegments[segmentName] = segment;
+			createdSharedSegments.push_back(segmentName);
+		}
+
+		nlohmann::json sharedJson;
+		ModelWeightsPtr sharedWeights;
+		std::filesystem::path sharedExtension;
+
+		if (ReadBinaryModel(segment->GetData(), segment->GetSize(), sharedJson, sharedWeights, sharedExtension, segment))
+		{
+			modelJson = std::move(sharedJson);
+			weights = std::move(sharedWeights);
+			extension = sharedExtension;
+		}
+	}
+
+	void NeuralModelLoader::ClearSharedModelData()
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		for (const auto& segmentName : createdSharedSegments)
+			SharedMemorySegment::Remove(segmentName);
+
+		createdSharedSegments.clear();
+		sharedSegments.clear();
+	}
+
+	bool NeuralModelLoader::ConvertToBinaryModel(const std::filesystem::path& modelPath, const std::filesystem::path& binaryModelPath)
+	{
+		if (!std::filesystem::exists(modelPath))
+			return false;
+
+		nlohmann::json modelJson;
+		ModelWeightsPtr weights;
+
+		{
+			MappedFile mappedFile;
+
+			if (!mappedFile.Open(modelPath))
+				return false;
+
+			const char* text = reinterpret_cast<const char*>(mappedFile.GetData());
+
+			if (modelPath.extension() == ".nam")
+			{
+				if (!ParseModelJson(text, text + mappedFile.GetSize(), modelJson, weights) || !PackNAMModelWeights(modelJson, weights))
+					return false;
+			}
+			else
+			{
+				modelJson = nlohmann::json::parse(text, text + mappedFile.GetSize(), nullptr, false);
+
+				if (modelJson.is_discarded())
+					return false;
+
+				weights = std::make_shared<ModelWeights>(std::vector<float>());	// Keras models keep their weights in the json
+			}
+		}
+
+		// Loaded binary models use their weights straight from the file, so write a new file and swap it in rather than
+		// rewriting one that may be in use
+		std::filesystem::path tempPath = binaryModelPath;
+		tempPath += ".tmp";
+
+		{
+			std::ofstream binaryStream(tempPath, std::ofstream::binary);
+
+			if (!binaryStream)
+				return false;
+
+			WriteBinaryModel(modelJson, *weights, modelPath.extension(), binaryStream);
+
+			binaryStream.close();
+
+			if (!binaryStream)
+			{
+				std::filesystem::remove(tempPath);
+
+				return false;
+			}
+		}
+
+		std::error_code error;
+
+		std::filesystem::rename(tempPath, binaryModelPath, error);
+
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	NeuralModel* NeuralModelLoader::CreateFromJson(nlohmann::json& modelJson, const std::filesystem::path& extension, bool doPrewarm)
+	{
+		ModelWeightsPtr weights;
+
+		if (extension == ".nam")
+		{
+			nlohmann::json reducedJson = ExtractModelWeights(modelJson, weights);
+
+			return CreateFromJson(reducedJson, weights, extension, doPrewarm);
+		}
+
+		return CreateFromJson(modelJson, weights, extension, doPrewarm);
+	}
+
+	NeuralModel* NeuralModelLoader::CreateFromJson(nlohmann::json& modelJson, const ModelWeightsPtr& weights, const std::filesystem::path& extension, bool doPrewarm)
+	{
+		NeuralModelImpl* newModel = CreateModelFromJson(modelJson, weights, extension);
+
+		if (newModel == nullptr)
+			return nullptr;
+
+		if (doPrewarm)
+		{
+			newModel->Prewarm();
+		}
+
+		if (fixedProcessingQuantum > 0)
+		{
+			return new FixedQuantumModel(newModel, fixedProcessingQuantum);
+		}
+
+		return newModel;
+	}
+
+	NeuralModel* NeuralModelLoader::CreateWithImpulseResponse(NeuralModel* model, const std::filesystem::path& wavPath, bool doPrewarm)
+	{
+		std::vector<float> impulseResponse;
+		float impulseResponseSampleRate;
+
+		if (!ReadWavFile(wavPath, impulseResponse, impulseResponseSampleRate) || impulseResponse.empty())
+			return nullptr;
+
+		// The convolution runs on the model output, which is at the external sample rate
+		if (impulseResponseSampleRate != (float)externalSampleRate)
+			impulseResponse = ResampleImpulseResponse(impulseResponse, impulseResponseSampleRate, (float)externalSampleRate);
+
+		return CreateWithImpulseResponse(model, impulseResponse.data(), impulseResponse.size(), doPrewarm);
+	}
+
+	NeuralModel* NeuralModelLoader::CreateWithImpulseResponse(NeuralModel* model, const float* impulseResponse, size_t length, bool doPrewarm)
+	{
+		if ((model == nullptr) || (length == 0))
+			return nullptr;
+
+		ImpulseResponseChainModel* chainModel = new ImpulseResponseChainModel(model, impulseResponse, length);
+
+		chainModel->SetModelLoader(this);
+
+		if (doPrewarm)
+		{
+			chainModel->Prewarm();
+		}
+
+		return chainModel;
+	}
+
+	NeuralModel* NeuralModelLoader::CreateChain(const std::vector<NeuralModel*>& models, bool doPrewarm)
+	{
+		if (models.empty() || (std::find(models.begin(), models.end(), nullptr) != models.end()))
+			return nullptr;
+
+		ChainModel* chainModel = new ChainModel(models, (size_t)std::max(defaultMaxAudioBufferSize, 1));
+
+		chainModel->SetModelLoader(this);
+
+		if (doPrewarm)
+		{
+			chainModel->Prewarm();
+		}
+
+		return chainModel;
+	}
+
+	double NeuralModelLoader::MeasureRealtimeLoad(NeuralModel* model)
+	{
+		const size_t numBenchSamples = 4096;
+		const int numReps = 3;
+
+		size_t blockSize = (size_t)std::max(defaultMaxAudioBufferSize, 1);
+		size_t numSamples = std::max(blockSize, numBenchSamples);
+
+		std::vector<float> input(numSamples, 0.0f);
+		std::vector<float> output(numSamples);
+
+		// Warm up caches before timing
+		model->Process(input.data(), output.data(), blockSize);
+
+		double minTime = 0;
+
+		for (int rep = 0; rep < numReps; rep++)
+		{
+			double time = TimeModelProcessing(model, input.data(), output.data(), numSamples, blockSize);
+
+			if ((rep == 0) || (time < minTime))
+				minTime = time;
+		}
+
+		model->Prewarm();
+
+		return (minTime / (double)numSamples) * model->GetSampleRate();
+	}
+
+	NeuralModelImpl* NeuralModelLoader::CreateModelFromJson(nlohmann::json& modelJson, const ModelWeightsPtr& weights, const std::filesystem::path& extension)
+	{
+		EnsureModelDefsAreLoaded();
+
+		const EModelLoadMode lstmMode = (autoLSTMLoadMode != EModelLoadMode::Auto) ? autoLSTMLoadMode : lstmLoadMode;
+		const EModelLoadMode wavenetMode = (autoWaveNetLoadMode != EModelLoadMode::Auto) ? autoWaveNetLoadMode : wavenetLoadMode;
+
+		EModelLoadMode* autoLoadMode = GetAutoLoadMode(modelJson, extension);
+
+		if ((autoLoadMode != nullptr) && (((autoLoadMode == &autoWaveNetLoadMode) ? wavenetMode : lstmMode) == EModelLoadMode::Auto))
+		{
+			return CreateAutoModelFromJson(modelJson, weights, extension, *autoLoadMode);
+		}
+
+		NeuralModelImpl* newModel = nullptr;
+
+		if (extension == ".nam")
+		{
+			OversampleNAMConfig(modelJson, externalSampleRate);
+
+			std::string arch = modelJson.at("architecture");
+
+			if (arch == "SlimmableContainer")	// Packed A2 multi-model file 
+			{
+				ScalableCompositeModel* model = new ScalableCompositeModel;
+
+				model->SetModelLoader(this);
+				model->LoadFromJson(modelJson, weights);
+
+				newModel = model;
+			}
+
+
+			if (newModel == nullptr)
+			{
+				std::string version = modelJson.at("version");
+
+#ifdef BUILD_NAMCORE
+				bool loadA2WithNAMCore = true;
+
+#ifdef BUILD_STATIC_INTERNAL_NAMA2
+				loadA2WithNAMCore = false;
+#endif
+				if ((wavenetMode == EModelLoadMode::NAMCore) || (NAMIsA2(version) && (loadA2WithNAMCore || !NAMIsA2Standard(modelJson))))
+				{
+					NAMModel* model = new NAMModel;
+
+					model->SetModelLoader(this);
+					model->LoadFromJson(modelJson, weights);
+
+					newModel = model;
+				}
+#endif
+			}
+
+			auto& config = modelJson.at("config");
+
+			if (newModel == nullptr)
+			{
+				if (arch == "WaveNet")
+				{
+					if (config.at("layers").size() == 1)
+					{
+#ifdef BUILD_STATIC_INTERNAL_NAMA2
+						auto& layerConfig = config.at("layers").at(0);
+
+						if (CheckIntegerSequence(layerConfig.at("dilations"), a2Dilations))
+						{
+							if (layerConfig.at("channels") == 3)
+							{
+								auto model = new InternalWaveNetModelT<NeuralAudio::WaveNetModelT<float, NeuralAudio::WaveNetLayerArrayT<float, 1, 1, 1, 16, 1, 3, A2KernelSizes, A2Dilations, true, EActivationType::LeakyReLU>>>();
+
+								if (model != nullptr)
+								{
+									model->SetModelLoader(this);
+									model->LoadFromNAMJson(modelJson, weights);
+
+									newModel = model;
+								}
+							}
+							else if (layerConfig.at("channels") == 8)
+							{
+								auto model = new InternalWaveNetModelT <NeuralAudio::WaveNetModelT<float, NeuralAudio::WaveNetLayerArrayT<float, 1, 1, 1, 16, 1, 8, A2KernelSizes, A2Dilations, true, EActivationType::LeakyReLU>>>();
+
+								if (model != nullptr)
+								{
+									model->SetModelLoader(this);
+									model->LoadFromNAMJson(modelJson, weights);
+
+									newModel = model;
+								}
+							}
+						}
+#endif
+					}
+					else if (config.at("layers").size() == 2)
+					{
+						auto& firstLayerConfig = config.at("layers").at(0);
+						auto& secondLayerConfig = config.at("layers").at(1);
+
+						if (!firstLayerConfig.at("gated") && !secondLayerConfig.at("gated") && !firstLayerConfig.at("head_bias") && secondLayerConfig.at("head_bias"))
+						{
+							bool isStandardDilations = CheckIntegerSequence(firstLayerConfig.at("dilations"), stdDilations) && CheckIntegerSequence(secondLayerConfig.at("dilations"), stdDilations);
+							bool isLiteDilations = CheckIntegerSequence(firstLayerConfig.at("dilations"), liteDilations) && CheckIntegerSequence(secondLayerConfig.at("dilations"), liteDilations2);
+
+							if ((isStandardDilations || isLiteDilations) && (newModel == nullptr))
+							{
+								size_t numChannels = firstLayerConfig.at("channels");
+								size_t headSize = firstLayerConfig.at("head_size");
+								size_t maxFLOPsPerSample = 0;	// Only exact matches unless the model can be padded
+
+								if (IsPaddableA1WaveNet(firstLayerConfig, secondLayerConfig))
+								{
+									maxFLOPsPerSample = (size_t)(GetA1WaveNetFLOPsPerSample(numChannels, headSize, firstLayerConfig.at("dilations").size(),
+										secondLayerConfig.at("dilations").size()) * dynamicWaveNetCostFactor);
+								}
+
+								auto modelDef = FindInternalWaveNetDefinition(numChannels, headSize, isStandardDilations, maxFLOPsPerSample);
+
+								if (modelDef != nullptr)
+								{
+									auto model = modelDef->CreateModel();
+
+									model->SetModelLoader(this);
+									model->LoadFromNAMJson(modelJson, weights);
+
+									newModel = model;
+								}
+							}
+						}
+					}
+
+					if (newModel == nullptr)
+					{
+						// Use a dynamic model if we had no static definition
+						InternalWaveNetModelDyn* model = new InternalWaveNetModelDyn;
+
+						model->SetModelLoader(this);
+
+						if (model->LoadFromNAMJson(modelJson, weights))
+						{
+							newModel = model;
+						}
+					}
+				}
+				else if (arch == "LSTM")
+				{
+#ifdef BUILD_NAMCORE
+					if (lstmMode == EModelLoadMode::NAMCore)
+					{
+						NAMModel* model = new NAMModel;
+
+						model->SetModelLoader(this);
+						model->LoadFromJson(modelJson, weights);
+
+						newModel = model;
+					}
+#endif
+
+#ifdef BUILD_STATIC_RTNEURAL
+					if (lstmMode == EModelLoadMode::RTNeural)
+					{
+						newModel = RTNeuralLoadNAMLSTM(modelJson, weights, this);
+					}
+#endif
+
+					if (newModel == nullptr)
+					{
+						auto modelDef = FindInternalLSTMDefinition(config.at("num_layers"), config.at("hidden_size"));
+
+						if (modelDef != nullptr)
+						{
+							auto model = modelDef->CreateModel();
+
+							model->SetModelLoader(this);
+							model->LoadFromNAMJson(modelJson, weights);
+
+							newModel = model;
+						}
+
+						// Use a dynamic model if we had no static definition
+						if (newModel == nullptr)
+						{
+							InternalLSTMModelDyn* model = new InternalLSTMModelDyn;
+
+							model->SetModelLoader(this);
+
+							if (model->LoadFromNAMJson(modelJson, weights))
+							{
+								newModel = model;
+							}
+						}
+					}
+				}
+				else if (arch == "ConvNet")
+				{
+					size_t numChannels;
+					std::vector<size_t> dilations;
+					bool batchNorm;
+					EConvNetActivation activation;
+
+					if (ReadConvNetConfig(config, numChannels, dilations, batchNorm, activation))
+					{
+						// Static definitions are the standard trainer presets (smaller models are run zero-padded)
+						if ((activation == EConvNetActivation::Tanh) && CheckIntegerSequence(config.at("dilations"), convNetDilations))
+						{
+							auto modelDef = FindInternalConvNetDefinition(numChannels, dilations.size());
+
+							if (modelDef != nullptr)
+							{
+								auto model = modelDef->CreateModel();
+
+								model->SetModelLoader(this);
+								model->LoadFromNAMJson(modelJson, weights);
+
+								newModel = model;
+							}
+						}
+
+						if (newModel == nullptr)
+						{
+							// Use a dynamic model if we had no static definition
+							InternalConvNetModelDyn* model = new InternalConvNetModelDyn;
+
+							model->SetModelLoader(this);
+
+							if (model->LoadFromNAMJson(modelJson, weights))
+							{
+								newModel = model;
+							}
+							else
+							{
+								delete model;
+							}
+						}
+					}
+
+#ifdef BUILD_NAMCORE
+					if (newModel == nullptr)
+					{
+						// Grouped convolutions and other activations are left to NAM Core
+						NAMModel* model = new NAMModel;
+
+						model->SetModelLoader(this);
+						model->LoadFromJson(modelJson, weights);
+
+						newModel = model;
+					}
+#endif
+				}
+				else if (arch == "Linear")
+				{
+					InternalLinearModel* model = new InternalLinearModel;
+
+					model->SetModelLoader(this);
+					model->LoadFromNAMJson(modelJson, weights);
+
+					newModel = model;
+				}
+			}
+		}
+		else if ((extension == ".json") || (extension == ".aidax"))
+		{
+			const auto layers = modelJson.at("layers");
+			const size_t numLayers = layers.size() - 1;
+			const std::string modelType = layers.at(0).at("type");
+			const int hiddenSize = layers.at(0).at("shape").back();
+
+			if (modelType == "lstm")
+			{
+#ifdef BUILD_STATIC_RTNEURAL
+				if (lstmMode == EModelLoadMode::RTNeural)
+				{
+					newModel = RTNeuralLoadKeras(modelJson, this);
+				}
+#endif
+
+				if (newModel == nullptr && lstmMode == EModelLoadMode::Internal)
+				{
+					if (numLayers == 1)
+					{
+						auto modelDef = FindInternalLSTMDefinition(numLayers, hiddenSize);
+
+						if (modelDef != nullptr)
+						{
+							auto model = modelDef->CreateModel();
+
+							if (model->LoadFromKerasJson(modelJson))
+							{
+								newModel = model;
+							}
+						}
+					}
+
+					if (newModel == nullptr)
+					{
+						// Use a dynamic model if we had no static definition
+						InternalLSTMModelDyn* model = new InternalLSTMModelDyn;
+
+						if (model->LoadFromKerasJson(modelJson))
+						{
+							newModel = model;
+						}
+					}
+				}
+			}
+			else if (modelType == "gru")
+			{
+				if (lstmMode == EModelLoadMode::Internal)
+				{
+					auto modelDef = FindInternalGRUDefinition(numLayers, hiddenSize);
+
+					if (modelDef != nullptr)
+					{
+						auto model = modelDef->CreateModel();
+
+						if (model->LoadFromKerasJson(modelJson))
+						{
+							newModel = model;
+						}
+						else
+						{
+							delete model;
+						}
+					}
+
+					if (newModel == nullptr)
+					{
+						// Use a dynamic model if we had no static definition
+						InternalGRUModelDyn* model = new InternalGRUModelDyn;
+
+						if (model->LoadFromKerasJson(modelJson))
+						{
+							newModel = model;
+						}
+						else
+						{
+							delete model;	// Unsupported layout - RTNeural will handle it
+						}
+					}
+				}
+			}
+			else if ((modelType == "conv1d") || (modelType == "dense") || (modelType == "time-distributed-dense"))
+			{
+				if (lstmMode == EModelLoadMode::Internal)
+				{
+					InternalKerasModelDyn* model = new InternalKerasModelDyn;
+
+					if (model->LoadFromKerasJson(modelJson))
+					{
+						newModel = model;
+					}
+					else
+					{
+						delete model;	// Unsupported layer types - RTNeural will handle it
 					}
 				}
 			}
-	
+
 			if (newModel == nullptr)
 			{
 				// Use a dynamic model for other model types
@@ -572,11 +1437,427 @@ namespace NeuralAudio
 			}
 		}
 
-		if ((newModel != nullptr) && doPrewarm)
+		if ((newModel != nullptr) && kernelAutoTuning)
 		{
-			newModel->Prewarm();
+			TuneModelKernels(newModel);
 		}
 
 		return newModel;
 	}
+
+	EModelLoadMode* NeuralModelLoader::GetAutoLoadMode(const nlohmann::json& modelJson, const std::filesystem::path& extension)
+	{
+		if (extension == ".nam")
+		{
+			std::string arch = modelJson.at("architecture");
+
+			// ConvNet models share the WaveNet setting
+			if ((arch == "WaveNet") || (arch == "ConvNet"))
+				return &autoWaveNetLoadMode;
+
+			if (arch == "LSTM")
+				return &autoLSTMLoadMode;
+		}
+		else if ((extension == ".json") || (extension == ".aidax"))
+		{
+			std::string modelType = modelJson.at("layers").at(0).at("type");
+
+			// All keras models share the LSTM setting
+			if ((modelType == "lstm") || (modelType == "gru") || (modelType == "conv1d") || (modelType == "dense") || (modelType == "time-distributed-dense"))
+				return &autoLSTMLoadMode;
+		}
+
+		return nullptr;	// No choice of backend for this model type
+	}
+
+	// Backend speed depends on the architecture and buffer size, not the weights
+	static std::string GetAutoLoadKey(const nlohmann::json& modelJson, const std::filesystem::path& extension, int maxBufferSize, int sampleRate)
+	{
+		std::string key = extension.string() + ":" + std::to_string(maxBufferSize) + ":" + std::to_string(sampleRate) + ":";
+
+		if (extension == ".nam")
+		{
+			key += modelJson.at("architecture").get<std::string>() + ":" + modelJson.at("config").dump();
+		}
+		else
+		{
+			for (const auto& layer : modelJson.at("layers"))
+			{
+				key += layer.value("type", "") + layer.value("shape", nlohmann::json()).dump() + ";";
+			}
+		}
+
+		return key;
+	}
+
+	static NeuralModelImpl* SelectFastestModel(std::vector<NeuralModelImpl*>& models, size_t blockSize)
+	{
+		const size_t numSamples = 4096;
+		const int numReps = 3;
+		const double maxRelativeError = 0.01;	// -40dB
+
+		std::vector<float> input(numSamples);
+
+		for (size_t i = 0; i < numSamples; i++)
+		{
+			input[i] = (float)(0.5 * sin((double)i * 0.01));
+		}
+
+		std::vector<float> reference(numSamples);
+		std::vector<float> output(numSamples);
+
+		double referenceRMS = 0;
+
+		NeuralModelImpl* bestModel = nullptr;
+		double bestTime = 0;
+
+		for (size_t modelIndex = 0; modelIndex < models.size(); modelIndex++)
+		{
+			NeuralModelImpl* model = models[modelIndex];
+
+			model->Prewarm();
+
+			double minTime = TimeModelProcessing(model, input.data(), output.data(), numSamples, blockSize);
+
+			// The first model is the reference - the others have to agree with it
+			if (modelIndex == 0)
+			{
+				reference = output;
+
+				for (float val : reference)
+					referenceRMS += val * val;
+
+				referenceRMS = std::sqrt(referenceRMS / (double)numSamples);
+			}
+			else
+			{
+				double error = 0;
+
+				for (size_t i = 0; i < numSamples; i++)
+				{
+					double diff = output[i] - reference[i];
+
+					error += diff * diff;
+				}
+
+				error = std::sqrt(error / (double)numSamples);
+
+				if (error > (std::max(referenceRMS, 1e-6) * maxRelativeError))
+					continue;
+			}
+
+			for (int rep = 1; rep < numReps; rep++)
+			{
+				minTime = std::min(minTime, TimeModelProcessing(model, input.data(), output.data(), numSamples, blockSize));
+			}
+
+			if ((bestModel == nullptr) || (minTime < bestTime))
+			{
+				bestModel = model;
+				bestTime = minTime;
+			}
+		}
+
+		return bestModel;
+	}
+
+	NeuralModelImpl* NeuralModelLoader::CreateAutoModelFromJson(nlohmann::json& modelJson, const ModelWeightsPtr& weights, const std::filesystem::path& extension,
+		EModelLoadMode& autoLoadMode)
+	{
+		std::string key = GetAutoLoadKey(modelJson, extension, defaultMaxAudioBufferSize, externalSampleRate);
+
+		EModelLoadMode cachedMode = EModelLoadMode::Auto;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			auto cached = autoLoadModes.find(key);
+
+			if (cached != autoLoadModes.end())
+				cachedMode = cached->second;
+		}
+
+		// Choices from earlier runs are kept with the kernel tunings
+		int storedMode;
+
+		if ((cachedMode == EModelLoadMode::Auto) && FindAutoLoadMode(kernelTuningCachePath, key, storedMode) &&
+			(storedMode >= EModelLoadMode::Internal) && (storedMode < EModelLoadMode::Auto))
+		{
+			cachedMode = (EModelLoadMode)storedMode;
+
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			autoLoadModes[key] = cachedMode;
+		}
+
+		if (cachedMode != EModelLoadMode::Auto)
+		{
+			autoLoadMode = cachedMode;
+
+			NeuralModelImpl* model = nullptr;
+
+			try
+			{
+				model = CreateModelFromJson(modelJson, weights, extension);
+			}
+			catch (...)
+			{
+				autoLoadMode = EModelLoadMode::Auto;
+
+				throw;
+			}
+
+			autoLoadMode = EModelLoadMode::Auto;
+
+			return model;
+		}
+
+		bool isWaveNet = (&autoLoadMode == &autoWaveNetLoadMode);
+
+		std::vector<NeuralModelImpl*> models;
+		std::exception_ptr loadError;
+
+		for (EModelLoadMode mode : { EModelLoadMode::Internal, EModelLoadMode::RTNeural, EModelLoadMode::NAMCore })
+		{
+			if (!(isWaveNet ? SupportsWaveNetLoadMode(mode) : SupportsLSTMLoadMode(mode)))
+				continue;
+
+			autoLoadMode = mode;
+
+			nlohmann::json candidateJson = modelJson;	// Loading can modify the json (ie: oversampling). The weights aren't in it.
+
+			NeuralModelImpl* model = nullptr;
+
+			try
+			{
+				model = CreateModelFromJson(candidateJson, weights, extension);
+			}
+			catch (...)
+			{
+				if (!loadError)
+					loadError = std::current_exception();
+			}
+
+			if (model == nullptr)
+				continue;
+
+			if (model->GetLoadMode() != mode)
+			{
+				// The model fell back to a different backend, which we either already have or will get to
+				delete model;
+
+				continue;
+			}
+
+			models.push_back(model);
+		}
+
+		autoLoadMode = EModelLoadMode::Auto;
+
+		if (models.empty())
+		{
+			if (loadError)
+				std::rethrow_exception(loadError);
+
+			return nullptr;
+		}
+
+		NeuralModelImpl* bestModel;
+
+		{
+			std::lock_guard<std::mutex> lock(benchmarkMutex);
+
+			bestModel = SelectFastestModel(models, (size_t)std::max(defaultMaxAudioBufferSize, 1));
+		}
+
+		for (auto model : models)
+		{
+			if (model != bestModel)
+				delete model;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			autoLoadModes[key] = bestModel->GetLoadMode();
+		}
+
+		StoreAutoLoadMode(kernelTuningCachePath, key, bestModel->GetLoadMode());
+
+		return bestModel;
+	}
+
+	void NeuralModelLoader::TuneModelKernels(NeuralModelImpl* model)
+	{
+		std::string signature = model->GetArchitectureSignature();
+
+		if (signature.empty())
+			return;
+
+		KernelTuning tuning;
+
+		if (!FindKernelTuning(kernelTuningCachePath, signature, tuning))
+		{
+			std::lock_guard<std::mutex> lock(benchmarkMutex);
+
+			// Another load may have tuned the same architecture while we waited
+			if (!FindKernelTuning(kernelTuningCachePath, signature, tuning))
+			{
+				tuning = BenchmarkKernelTuning(model, model->GetKernelTuningCandidates(), defaultMaxAudioBufferSize);
+
+				StoreKernelTuning(kernelTuningCachePath, signature, tuning);
+			}
+		}
+
+		model->SetKernelTuning(tuning);
+	}
+
+	ModelSlot::ModelSlot()
+	{
+		reclaimThread = std::thread(&ModelSlot::ReclaimThread, this);
+	}
+
+	ModelSlot::~ModelSlot()
+	{
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			stopping = true;
+		}
+
+		requestCondition.notify_one();
+
+		reclaimThread.join();
+
+		delete pendingModel.exchange(nullptr);
+		delete retiredModel.exchange(nullptr);
+		delete activeModel;
+	}
+
+	void ModelSlot::SetModel(NeuralModel* model)
+	{
+		if (model == nullptr)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			latestSerial++;	// Supersedes any load still in progress
+		}
+
+		PublishModel(model);
+	}
+
+	void ModelSlot::SetModel(std::future<NeuralModel*>&& modelFuture)
+	{
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			loadRequests.push_back({ std::move(modelFuture), ++latestSerial });
+		}
+
+		requestCondition.notify_one();
+	}
+
+	void ModelSlot::LoadModel(NeuralModelLoader& loader, const std::filesystem::path& modelPath)
+	{
+		SetModel(loader.LoadAsync(modelPath));
+	}
+
+	void ModelSlot::Process(float* input, float* output, size_t numSamples)
+	{
+		// Only swap once the previous model has been reclaimed, so there is never more than one model waiting to be deleted
+		if (retiredModel.load(std::memory_order_acquire) == nullptr)
+		{
+			if (pendingModel.load(std::memory_order_acquire) != nullptr)
+			{
+				// Retire the old model before clearing the pending one, so the reclaim thread never sees both empty mid-swap
+				retiredModel.store(activeModel, std::memory_order_release);
+
+				// Other threads only ever replace the pending model with another non-null one
+				activeModel = pendingModel.exchange(nullptr, std::memory_order_acq_rel);
+			}
+		}
+
+		if (activeModel != nullptr)
+			activeModel->Process(input, output, numSamples);
+		else
+			std::fill(output, output + numSamples, 0.0f);
+	}
+
+	void ModelSlot::PublishModel(NeuralModel* model)
+	{
+		// A model that was set but never picked up by the audio thread can just be deleted
+		delete pendingModel.exchange(model, std::memory_order_acq_rel);
+
+		{
+			// Make sure the reclaim thread isn't between checking for a pending model and waiting
+			std::lock_guard<std::mutex> lock(requestMutex);
+		}
+
+		requestCondition.notify_one();
+	}
+
+	void ModelSlot::ReclaimThread()
+	{
+		std::unique_lock<std::mutex> lock(requestMutex);
+
+		while (true)
+		{
+			delete retiredModel.exchange(nullptr, std::memory_order_acq_rel);
+
+			if (!loadRequests.empty())
+			{
+				LoadRequest request = std::move(loadRequests.front());
+
+				loadRequests.pop_front();
+
+				lock.unlock();
+
+				// Keep reclaiming while the load runs, so model swaps aren't held up
+				while (request.ModelFuture.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready)
+					delete retiredModel.exchange(nullptr, std::memory_order_acq_rel);
+
+				NeuralModel* model = nullptr;
+
+				try
+				{
+					model = request.ModelFuture.get();
+				}
+				catch (...)
+				{
+				}
+
+				lock.lock();
+
+				if ((model != nullptr) && (request.Serial == latestSerial))
+				{
+					lock.unlock();
+
+					PublishModel(model);
+
+					lock.lock();
+				}
+				else
+				{
+					delete model;
+				}
+
+				continue;
+			}
+
+			if (stopping)
+				break;
+
+			// The audio thread can't wake us up, so poll while a swap is still under way
+			if ((pendingModel.load(std::memory_order_acquire) != nullptr) || (retiredModel.load(std::memory_order_acquire) != nullptr))
+			{
+				requestCondition.wait_for(lock, std::chrono::milliseconds(10));
+			}
+			else
+			{
+				requestCondition.wait(lock, [this]() { return stopping || !loadRequests.empty() || (pendingModel.load() != nullptr); });
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,9 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <algorithm>
 #include <string>
+#include <thread>
 #include <vector>
 #include "json.hpp"
 
@@ -21,7 +31,8 @@ namespace NeuralAudio
 	{
 		Internal,
 		RTNeural,
-		NAMCore
+		NAMCore,
+		Auto	// Benchmark the supported backends on load and keep the fastest
 	};
 
 	enum ECompositeModelLoadMode
@@ -30,6 +41,38 @@ namespace NeuralAudio
 		OnDemand
 	};
 
+	// Lightweight handle for calling a model's process function without going through the virtual Process() call.
+	// Intended for hosts running very small buffer sizes, where per-call overhead is significant.
+	struct NeuralModelProcessor
+	{
+		using ProcessFunction = void (*)(void* instance, float* input, float* output, size_t numSamples);
+
+		void* Instance = nullptr;
+		ProcessFunction ProcessFunc = nullptr;
+
+		inline void Process(float* input, float* output, size_t numSamples) const
+		{
+			ProcessFunc(Instance, input, output, numSamples);
+		}
+	};
+
+	// Runs several independent instances of a model (each with its own state) that share one set of weights
+	class NeuralModelBatch
+	{
+	public:
+		virtual ~NeuralModelBatch()
+		{
+		}
+
+		virtual size_t GetNumInstances() = 0;
+
+		// Return an instance to the model's initial state (ie: when a new stream starts using it)
+		virtual void ResetInstance(size_t instance) = 0;
+
+		// inputs and outputs are arrays of GetNumInstances() sample buffers
+		virtual void Process(float** inputs, float** outputs, size_t numSamples) = 0;
+	};
+
 	class NeuralModel
 	{
 	public:
@@ -104,6 +147,11 @@ namespace NeuralAudio
 			return -1;	// No fixed receptive field size (ie: for LSTM)
 		}
 
+		virtual int GetLatencySamples()
+		{
+			return 0;
+		}
+
 		virtual std::string GetModelVersion()
 		{
 			return modelVersion;
@@ -135,6 +183,47 @@ namespace NeuralAudio
 		{
 		}
 
+		// The returned handle is only valid for the lifetime of the model
+		virtual NeuralModelProcessor GetProcessor()
+		{
+			return { this, [](void* instance, float* input, float* output, size_t numSamples)
+				{
+					static_cast<NeuralModel*>(instance)->Process(input, output, numSamples);
+				} };
+		}
+
+		// Returns nullptr if the model doesn't support batch processing. The batch shares the model's weights, so it
+		// is only valid for the lifetime of the model. The caller is responsible for deleting it.
+		virtual NeuralModelBatch* CreateBatch(size_t numInstances)
+		{
+			(void)numInstances;
+
+			return nullptr;
+		}
+
+		// Returns nullptr if the model doesn't support cloning. The clone shares the model's weights, and starts from the
+		// model's current (ie: prewarmed) state. The caller is responsible for deleting it (or handing it to ReleaseClone()).
+		virtual NeuralModel* Clone()
+		{
+			return nullptr;
+		}
+
+		// Preallocate clones, so that Clone() doesn't allocate or parse anything. Returns the number of clones reserved.
+		virtual size_t ReserveClones(size_t numClones)
+		{
+			(void)numClones;
+
+			return 0;
+		}
+
+		// Return a clone to the reserved pool instead of deleting it. Returns false if the clone wasn't taken.
+		virtual bool ReleaseClone(NeuralModel* clone)
+		{
+			(void)clone;
+
+			return false;
+		}
+
 	protected:
 		float audioInputLevelDBu = (float)DEFAULT_INPUT_DBU;
 		float modelInputLevelDBu = 12;
@@ -145,13 +234,48 @@ namespace NeuralAudio
 		std::vector<std::pair<std::string, std::string>> metadata;
 	};
 
+	class NeuralModelImpl;
+	class ModelWeights;
+	class SharedMemorySegment;
+
+	// Models can be loaded from several threads at once. Settings shouldn't be changed while loads are running.
 	class NeuralModelLoader
 	{
+		friend class ScalableCompositeModel;
+
 		public:
 			NeuralModel* CreateFromFile(const std::filesystem::path& modelPath, bool doPrewarm = true);
 			NeuralModel* CreateFromStream(std::basic_istream<char>& stream, const std::filesystem::path& extension, bool doPrewarm = true);
 			NeuralModel* CreateFromJson(nlohmann::json& modelJson, const std::filesystem::path& extension, bool doPrewarm = true);
 
+			// Load a model on a background thread. The loader must outlive the load, and its settings shouldn't be changed until
+			// it finishes. The future returns nullptr if the model couldn't be loaded - it never holds an exception.
+			std::future<NeuralModel*> LoadAsync(const std::filesystem::path& modelPath, bool doPrewarm = true);
+
+			// Load several model files at once, spread across threads (see SetMaxLoadThreads()). Returns one model per path, in
+			// order, with nullptr for models that couldn't be loaded.
+			std::vector<NeuralModel*> CreateFromFiles(const std::vector<std::filesystem::path>& modelPaths, bool doPrewarm = true);
+
+			// Load a binary model (".namb") from memory. The data only needs to stay valid for the duration of the call.
+			NeuralModel* CreateFromBinary(const void* data, size_t size, bool doPrewarm = true);
+
+			// Convert a model file to a binary model (".namb"), which loads faster since the weights don't need to be parsed. Weights
+			// the internal engines can run are stored in their layout, and used straight from the file. Returns false if the model
+			// can't be read.
+			static bool ConvertToBinaryModel(const std::filesystem::path& modelPath, const std::filesystem::path& binaryModelPath);
+
+			// Chain an impulse response (ie: a cabinet IR) after a model, using zero latency convolution. On success the returned
+			// model owns the original model. Returns nullptr (and leaves the original model alone) if the WAV file can't be read.
+			NeuralModel* CreateWithImpulseResponse(NeuralModel* model, const std::filesystem::path& wavPath, bool doPrewarm = true);
+			NeuralModel* CreateWithImpulseResponse(NeuralModel* model, const float* impulseResponse, size_t length, bool doPrewarm = true);
+
+			// Run models in series as a single model, which owns them. Uses the default max audio buffer size.
+			NeuralModel* CreateChain(const std::vector<NeuralModel*>& models, bool doPrewarm = true);
+
+			// Benchmark a model (or chain) at the default max audio buffer size. Returns the fraction of one CPU core needed
+			// to run it in real time. The model is prewarmed afterwards. Not real-time safe.
+			double MeasureRealtimeLoad(NeuralModel* model);
+
 			bool SetLSTMLoadMode(EModelLoadMode val)
 			{
 				if (!SupportsLSTMLoadMode(val))
@@ -220,7 +344,113 @@ namespace NeuralAudio
 				this->externalSampleRate = sampleRate;
 			}
 
+			// Run models on a fixed internal block size (0 disables). Rounded up to the convolution tile size.
+			// Adds one quantum of latency - see NeuralModel::GetLatencySamples().
+			void SetFixedProcessingQuantum(int quantumSamples)
+			{
+				fixedProcessingQuantum = quantumSamples;
+			}
+
+			int GetFixedProcessingQuantum()
+			{
+				return fixedProcessingQuantum;
+			}
+
+			// Benchmark runtime-selectable kernel variants on load and keep the fastest for this CPU
+			void SetKernelAutoTuning(bool autoTune)
+			{
+				kernelAutoTuning = autoTune;
+			}
+
+			bool GetKernelAutoTuning()
+			{
+				return kernelAutoTuning;
+			}
+
+			// File used to persist tuning results across runs. If not set, results are only kept in memory.
+			void SetKernelTuningCachePath(const std::filesystem::path& cachePath)
+			{
+				kernelTuningCachePath = cachePath;
+			}
+
+			const std::filesystem::path& GetKernelTuningCachePath()
+			{
+				return kernelTuningCachePath;
+			}
+
+			// Keep a copy of loaded models, keyed by a hash of their contents and the loader settings. Loading the same model
+			// again clones the cached copy, which shares its weights, instead of reading and parsing it. Models that can't be
+			// cloned are built from the cached model data. Cached models are kept until ClearModelCache() is called.
+			void SetModelCaching(bool cacheModels)
+			{
+				modelCaching = cacheModels;
+			}
+
+			bool GetModelCaching()
+			{
+				return modelCaching;
+			}
+
+			void ClearModelCache()
+			{
+				std::lock_guard<std::mutex> lock(cacheMutex);
+
+				modelCache.clear();
+			}
+
+			// Put the packed data of loaded models in named shared memory, keyed by a hash of their contents, so other processes
+			// loading the same models map it instead of reading and parsing the model files again.
+			void SetSharedModelData(bool shareModelData)
+			{
+				sharedModelData = shareModelData;
+			}
+
+			bool GetSharedModelData()
+			{
+				return sharedModelData;
+			}
+
+			// Remove the shared memory segments created by this loader. Models still using their weights keep them mapped.
+			void ClearSharedModelData();
+
+			// Maximum number of threads used to load models in parallel (ie: batch loads and the submodels of packed A2 files).
+			// 0 uses one thread per CPU core.
+			void SetMaxLoadThreads(int numThreads)
+			{
+				maxLoadThreads = numThreads;
+			}
+
+			int GetMaxLoadThreads()
+			{
+				return maxLoadThreads;
+			}
+
 		protected:
+			// Holds either a model to clone, or the data to build the model from if it can't be cloned
+			struct CachedModelData
+			{
+				std::shared_ptr<NeuralModel> Model;
+				bool IsPrewarmed = false;
+				std::shared_ptr<const nlohmann::json> ModelJson;
+				std::shared_ptr<const ModelWeights> Weights;
+				std::filesystem::path Extension;
+			};
+
+			// Model json passed around internally refers to a weights buffer for its weights (see ModelWeights.h)
+			bool ReadModelData(const void* data, size_t size, std::filesystem::path& extension, nlohmann::json& modelJson, std::shared_ptr<const ModelWeights>& weights,
+				std::shared_ptr<const void> dataOwner = nullptr);
+			NeuralModel* CreateFromModelData(const void* data, size_t size, std::filesystem::path& extension, std::shared_ptr<const void> dataOwner, bool doPrewarm);
+			std::string GetModelCacheKey(uint64_t hash, size_t size, const std::filesystem::path& extension);
+			bool ReadSharedModelData(const std::string& segmentName, std::filesystem::path& extension, nlohmann::json& modelJson, std::shared_ptr<const ModelWeights>& weights);
+			void StoreSharedModelData(const std::string& segmentName, std::filesystem::path& extension, nlohmann::json& modelJson, std::shared_ptr<const ModelWeights>& weights);
+			NeuralModel* CreateFromJson(nlohmann::json& modelJson, const std::shared_ptr<const ModelWeights>& weights, const std::filesystem::path& extension, bool doPrewarm);
+			NeuralModelImpl* CreateModelFromJson(nlohmann::json& modelJson, const std::shared_ptr<const ModelWeights>& weights, const std::filesystem::path& extension);
+			NeuralModelImpl* CreateAutoModelFromJson(nlohmann::json& modelJson, const std::shared_ptr<const ModelWeights>& weights, const std::filesystem::path& extension,
+				EModelLoadMode& autoLoadMode);
+			EModelLoadMode* GetAutoLoadMode(const nlohmann::json& modelJson, const std::filesystem::path& extension);
+			void TuneModelKernels(NeuralModelImpl* model);
+			void RunParallel(size_t numTasks, const std::function<void(size_t)>& task);
+
 			EModelLoadMode lstmLoadMode = EModelLoadMode::Internal;
 			EModelLoadMode wavenetLoadMode = EModelLoadMode::Internal;
 			ECompositeModelLoadMode compositeLoadMode = ECompositeModelLoadMode::LoadAll;
@@ -228,6 +458,70 @@ namespace NeuralAudio
 			int defaultMaxAudioBufferSize = 128;
 			float defaultQualityScaleFactor = (float)DEFAULT_QUALITY_SCALE;
 			int externalSampleRate = 48000;
+			int fixedProcessingQuantum = 0;
+			int maxLoadThreads = 0;
+			bool kernelAutoTuning = false;
+			std::filesystem::path kernelTuningCachePath;
+			std::mutex cacheMutex;	// Guards the caches below, so models can be loaded from several threads at once
+			std::map<std::string, EModelLoadMode> autoLoadModes;
+			bool modelCaching = false;
+			std::map<std::string, CachedModelData> modelCache;
+			bool sharedModelData = false;
+			std::map<std::string, std::shared_ptr<SharedMemorySegment>> sharedSegments;
+			std::vector<std::string> createdSharedSegments;
+	};
+
+	// Holds the model used by an audio thread, and lets other threads replace it without blocking or allocating on the
+	// audio thread. The new model is picked up at the start of the next Process() call, and the old one is deleted on a
+	// background thread.
+	class ModelSlot
+	{
+	public:
+		ModelSlot();
+		ModelSlot(const ModelSlot&) = delete;
+		ModelSlot& operator=(const ModelSlot&) = delete;
+
+		// Process() must not be running. Waits for any loads still in progress.
+		~ModelSlot();
+
+		// Replace the model. The slot takes ownership. Call from any thread but the audio thread.
+		void SetModel(NeuralModel* model);
+
+		// Replace the model when an async load finishes. If SetModel() is called again before then, the loaded model is discarded.
+		void SetModel(std::future<NeuralModel*>&& modelFuture);
+
+		// Load a model in the background (see NeuralModelLoader::LoadAsync()), and swap it in when it is ready
+		void LoadModel(NeuralModelLoader& loader, const std::filesystem::path& modelPath);
+
+		// Call from the audio thread. Outputs silence until the first model is ready.
+		void Process(float* input, float* output, size_t numSamples);
+
+		// The model used by the last Process() call. Only safe to use from the audio thread.
+		NeuralModel* GetActiveModel()
+		{
+			return activeModel;
+		}
+
+	private:
+		struct LoadRequest
+		{
+			std::future<NeuralModel*> ModelFuture;
+			uint64_t Serial;
+		};
+
+		void PublishModel(NeuralModel* model);
+		void ReclaimThread();
+
+		NeuralModel* activeModel = nullptr;	// Only touched by the audio thread
+		std::atomic<NeuralModel*> pendingModel = nullptr;
+		std::atomic<NeuralModel*> retiredModel = nullptr;
+
+		std::mutex requestMutex;
+		std::condition_variable requestCondition;
+		std::deque<LoadRequest> loadRequests;
+		uint64_t latestSerial = 0;
+		bool stopping = false;
+		std::thread reclaimThread;
 	};
 
 }
\ No newline at end of file
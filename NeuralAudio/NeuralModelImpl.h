@@ -1,9 +1,60 @@
 #pragma once
 
+#include <vector>
 #include "NeuralModel.h"
+#include "KernelTuning.h"
 
 namespace NeuralAudio
 {
+	// Preallocated clones of a model. Has room for every clone ever reserved, so returning one to the pool never allocates.
+	template <typename CloneType>
+	class ClonePool
+	{
+	public:
+		~ClonePool()
+		{
+			for (auto clone : clones)
+				delete clone;
+		}
+
+		CloneType* Take()
+		{
+			if (clones.empty())
+				return nullptr;
+
+			CloneType* clone = clones.back();
+			clones.pop_back();
+
+			return clone;
+		}
+
+		template <typename CreateFunc>
+		size_t Reserve(size_t numClones, CreateFunc createClone)
+		{
+			numReserved += numClones;
+			clones.reserve(numReserved);
+
+			for (size_t i = 0; i < numClones; i++)
+				clones.push_back(createClone());
+
+			return numClones;
+		}
+
+		bool Release(CloneType* clone)
+		{
+			if (clones.size() >= clones.capacity())
+				return false;
+
+			clones.push_back(clone);
+
+			return true;
+		}
+
+	private:
+		std::vector<CloneType*> clones;
+		size_t numReserved = 0;
+	};
+
 	class NeuralModelImpl : public NeuralModel
 	{
 		public:
@@ -26,6 +77,22 @@ namespace NeuralAudio
 				hadInitialPrewarm = true;
 			}
 
+			// Models with runtime-selectable kernels return a signature identifying their architecture (empty if not tunable)
+			virtual std::string GetArchitectureSignature()
+			{
+				return "";
+			}
+
+			virtual std::vector<KernelTuning> GetKernelTuningCandidates()
+			{
+				return {};
+			}
+
+			virtual void SetKernelTuning(const KernelTuning& tuning)
+			{
+				(void)tuning;
+			}
+
 		protected:
 			void ReadNAMConfig(const nlohmann::json& modelJson)
 			{
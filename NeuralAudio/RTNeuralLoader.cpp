@@ -28,7 +28,7 @@ namespace NeuralAudio
 			return nullptr;
 		}
 
-		NeuralModelImpl* RTNeuralLoadNAMLSTM(const nlohmann::json& modelJson, NeuralModelLoader *loader)
+		NeuralModelImpl* RTNeuralLoadNAMLSTM(const nlohmann::json& modelJson, const ModelWeightsPtr& weights, NeuralModelLoader *loader)
 		{
 			auto& config = modelJson.at("config");
 
@@ -39,7 +39,7 @@ namespace NeuralAudio
 				RTNeuralModel* model = modelDef->CreateModel();
 
 				model->SetModelLoader(loader);
-				model->LoadFromNAMJson(modelJson);
+				model->LoadFromNAMJson(modelJson, weights);
 
 				return model;
 			}
@@ -48,7 +48,7 @@ namespace NeuralAudio
 			RTNeuralModelDyn* dynModel = new RTNeuralModelDyn;
 
 			dynModel->SetModelLoader(loader);
-			dynModel->LoadFromNAMJson(modelJson);
+			dynModel->LoadFromNAMJson(modelJson, weights);
 
 			return dynModel;
 
@@ -2,11 +2,12 @@
 
 #include "NeuralModel.h"
 #include "NeuralModelImpl.h"
+#include "ModelWeights.h"
 
 namespace NeuralAudio
 {
 	extern void EnsureRTNeuralModelDefsAreLoaded();
-	extern NeuralModelImpl* RTNeuralLoadNAMWaveNet(const nlohmann::json& modelJson, NeuralModelLoader* loader);
-	extern NeuralModelImpl* RTNeuralLoadNAMLSTM(const nlohmann::json& modelJson, NeuralModelLoader* loader);
+	extern NeuralModelImpl* RTNeuralLoadNAMWaveNet(const nlohmann::json& modelJson, const ModelWeightsPtr& weights, NeuralModelLoader* loader);
+	extern NeuralModelImpl* RTNeuralLoadNAMLSTM(const nlohmann::json& modelJson, const ModelWeightsPtr& weights, NeuralModelLoader* loader);
 	extern NeuralModelImpl* RTNeuralLoadKeras(const nlohmann::json& modelJson, NeuralModelLoader* loader);
 }
\ No newline at end of file
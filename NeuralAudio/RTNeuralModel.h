@@ -2,6 +2,7 @@
 
 #include "NeuralModel.h"
 #include "NeuralModelImpl.h"
+#include "ModelWeights.h"
 #include <RTNeural/RTNeural.h>
 #include "TemplateHelper.h"
 
@@ -52,16 +53,18 @@ namespace NeuralAudio
 			return false;
 		}
 
-		virtual bool LoadFromNAMJson(const nlohmann::json& modelJson)
+		// The json refers to the weights buffer for its weights
+		virtual bool LoadFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights)
 		{
 			ReadNAMConfig(modelJson);
 
-			return CreateModelFromNAMJson(modelJson);
+			return CreateModelFromNAMJson(modelJson, weights);
 		}
 
-		virtual bool CreateModelFromNAMJson(const nlohmann::json& modelJson)
+		virtual bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights)
 		{
 			(void)modelJson;
+			(void)weights;
 
 			return false;
 		}
@@ -113,7 +116,7 @@ namespace NeuralAudio
 			return true;
 		}
 
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
 		{
 			if (model != nullptr)
 			{
@@ -123,19 +126,20 @@ namespace NeuralAudio
 
 			model = new ModelType;
 
-			std::vector<float> weights = modelJson.at("weights");
+			std::vector<float> unpackedWeights;
+			std::span<const float> namWeights = GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights);
 
 			const int networkInputSize = 1;
 			const int networkOutputSize = 1;
 			const int gateSize = 4 * hiddenSize;
 
-			auto iter = weights.begin();
+			auto iter = namWeights.begin();
 
 			ForEachIndex<numLayers>([&](auto layer)
 				{
 					const int layerInputSize = (layer == 0) ? networkInputSize : hiddenSize;
 
-					Eigen::MatrixXf inputPlusHidden = Eigen::Map<Eigen::MatrixXf>(&(*iter), layerInputSize + hiddenSize, gateSize);
+					Eigen::MatrixXf inputPlusHidden = Eigen::Map<const Eigen::MatrixXf>(&(*iter), layerInputSize + hiddenSize, gateSize);
 
 					auto& lstmLayer = model->template get<layer>();
 
@@ -200,7 +204,7 @@ namespace NeuralAudio
 
 			// Dense layer bias
 			auto denseBias = std::vector<float>(iter, iter + networkOutputSize);
-			denseLayer.setBias(&(*iter));
+			denseLayer.setBias(denseBias.data());
 
 			iter += networkOutputSize;
 
@@ -303,7 +307,7 @@ namespace NeuralAudio
 			return true;
 		}
 
-		bool CreateModelFromNAMJson(const nlohmann::json& modelJson) override
+		bool CreateModelFromNAMJson(const nlohmann::json& modelJson, const ModelWeightsPtr& weights) override
 		{
 			model = std::make_unique<RTNeural::Model<float>>(1);
 
@@ -313,19 +317,20 @@ namespace NeuralAudio
 			const size_t inputSize = config.at("input_size");
 			const size_t hiddenSize = config.at("hidden_size");
 
-			std::vector<float> weights = modelJson.at("weights");
+			std::vector<float> unpackedWeights;
+			std::span<const float> namWeights = GetNAMWeights(modelJson.at("weights"), weights, unpackedWeights);
 
 			const size_t networkInputSize = inputSize;
 			const size_t networkOutputSize = inputSize;
 			const size_t gateSize = 4 * hiddenSize;
 
-			auto iter = weights.begin();
+			auto iter = namWeights.begin();
 
 			for (size_t layer = 0; layer < numLayers; layer++)
 			{
 				const size_t layerInputSize = (layer == 0) ? networkInputSize : hiddenSize;
 
-				Eigen::MatrixXf inputPlusHidden = Eigen::Map<Eigen::MatrixXf>(&(*iter), layerInputSize + hiddenSize, gateSize);
+				Eigen::MatrixXf inputPlusHidden = Eigen::Map<const Eigen::MatrixXf>(&(*iter), layerInputSize + hiddenSize, gateSize);
 
 				auto lstmLayer = new RTNeural::LSTMLayer<float>((int)layerInputSize, (int)hiddenSize);
 
@@ -405,7 +410,7 @@ namespace NeuralAudio
 
 			// Dense layer bias
 			auto denseBias = std::vector<float>(iter, iter + networkOutputSize);
-			denseLayer->setBias(&(*iter));
+			denseLayer->setBias(denseBias.data());
 
 			iter += networkOutputSize;
 
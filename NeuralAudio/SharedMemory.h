@@ -0,0 +1,316 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NeuralAudio
+{
+	// Named, read-only block of data shared between processes. The first process to create a name fills in the data, and
+	// everyone else maps the same pages.
+	//
+	// On POSIX systems the segment persists until it is removed, even if no process has it open. On Windows it goes away
+	// when the last process closes it.
+	//
+	// Segments are only readable by the user that created them, and segments belonging to other users are never opened, so
+	// another user can't substitute model data. On Windows this is down to the default security of the "Local\" namespace.
+	class SharedMemorySegment
+	{
+	public:
+		SharedMemorySegment()
+		{
+		}
+
+		SharedMemorySegment(const SharedMemorySegment&) = delete;
+		SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+
+		~SharedMemorySegment()
+		{
+			Close();
+		}
+
+		// Map an existing segment. Fails if it doesn't exist, or if its creator hasn't finished writing it.
+		bool Open(const std::string& name)
+		{
+			Close();
+
+#ifdef _WIN32
+			HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, GetMappingName(name).c_str());
+
+			if (mapping == nullptr)
+				return false;
+
+			MEMORY_BASIC_INFORMATION info;
+			void* mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+			CloseHandle(mapping);	// The view keeps the mapping open
+
+			if (mapped == nullptr)
+				return false;
+
+			if (VirtualQuery(mapped, &info, sizeof(info)) == 0)
+			{
+				UnmapViewOfFile(mapped);
+
+				return false;
+			}
+
+			mappedSize = info.RegionSize;
+#else
+			int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+			if (fd < 0)
+				return false;
+
+			struct stat segmentStat;
+
+			if ((fstat(fd, &segmentStat) != 0) || (segmentStat.st_uid != geteuid()) || ((size_t)segmentStat.st_size < sizeof(SegmentHeader)))
+			{
+				close(fd);
+
+				return false;
+			}
+
+			void* mapped = mmap(nullptr, (size_t)segmentStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+			close(fd);	// The mapping keeps the segment open
+
+			if (mapped == MAP_FAILED)
+				return false;
+
+			mappedSize = (size_t)segmentStat.st_size;
+#endif
+
+			mappedData = static_cast<uint8_t*>(mapped);
+
+			const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(mappedData);
+
+			if ((mappedSize < sizeof(SegmentHeader)) || (header->Ready.load(std::memory_order_acquire) == 0) || (header->Size > (mappedSize - sizeof(SegmentHeader))))
+			{
+				Close();
+
+				return false;
+			}
+
+			return true;
+		}
+
+		// Create a new segment with a copy of the data. Fails if the name already exists, unless the existing segment is one of
+		// ours that its creator never finished (see RemoveIfStale()).
+		bool Create(const std::string& name, const void* data, size_t size)
+		{
+			Close();
+
+			const size_t totalSize = sizeof(SegmentHeader) + size;
+			void* mapped = nullptr;
+
+#ifdef _WIN32
+			HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)totalSize >> 32), (DWORD)totalSize, GetMappingName(name).c_str());
+
+			if (mapping == nullptr)
+				return false;
+
+			if (GetLastError() == ERROR_ALREADY_EXISTS)
+			{
+				CloseHandle(mapping);
+
+				return false;
+			}
+
+			mapped = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+
+			// Unlike POSIX, the segment only lives as long as a process has it open, so keep the handle
+			ownedMapping = mapping;
+
+			if (mapped == nullptr)
+			{
+				Close();
+
+				return false;
+			}
+#else
+			int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+			if ((fd < 0) && (errno == EEXIST) && RemoveIfStale(name))
+				fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+			if (fd < 0)
+				return false;
+
+			if (ftruncate(fd, (off_t)totalSize) != 0)
+			{
+				close(fd);
+				shm_unlink(name.c_str());
+
+				return false;
+			}
+
+			mapped = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+			close(fd);
+
+			if (mapped == MAP_FAILED)
+			{
+				shm_unlink(name.c_str());
+
+				return false;
+			}
+#endif
+
+			mappedData = static_cast<uint8_t*>(mapped);
+			mappedSize = totalSize;
+
+			// Fill in the data before marking the segment as ready, since other processes can map it as soon as it exists
+			SegmentHeader* header = new (mappedData) SegmentHeader;
+
+#ifdef _WIN32
+			header->CreatorProcess = (uint32_t)GetCurrentProcessId();
+#else
+			header->CreatorProcess = (uint32_t)getpid();
+#endif
+			header->Size = size;
+			std::memcpy(mappedData + sizeof(SegmentHeader), data, size);
+
+			header->Ready.store(1, std::memory_order_release);
+
+			return true;
+		}
+
+		void Close()
+		{
+			if (mappedData != nullptr)
+			{
+#ifdef _WIN32
+				UnmapViewOfFile(mappedData);
+#else
+				munmap(mappedData, mappedSize);
+#endif
+			}
+
+#ifdef _WIN32
+			if (ownedMapping != nullptr)
+				CloseHandle(ownedMapping);
+
+			ownedMapping = nullptr;
+#endif
+
+			mappedData = nullptr;
+			mappedSize = 0;
+		}
+
+		// Remove the name, so the next Create() makes a new segment. Processes that have it mapped keep their mapping.
+		static void Remove(const std::string& name)
+		{
+#ifndef _WIN32
+			shm_unlink(name.c_str());
+#else
+			(void)name;
+#endif
+		}
+
+		const uint8_t* GetData() const
+		{
+			return (mappedData != nullptr) ? (mappedData + sizeof(SegmentHeader)) : nullptr;
+		}
+
+		size_t GetSize() const
+		{
+			return (mappedData != nullptr) ? (size_t)reinterpret_cast<const SegmentHeader*>(mappedData)->Size : 0;
+		}
+
+	private:
+		struct SegmentHeader
+		{
+			std::atomic<uint32_t> Ready { 0 };
+			uint32_t CreatorProcess = 0;
+			uint64_t Size = 0;
+		};
+
+#ifndef _WIN32
+		// How long an unfinished segment can be around before it is assumed to be abandoned, if its creator is unknown
+		static constexpr time_t staleSegmentSeconds = 10;
+
+		// A creator that dies before marking its segment ready would otherwise leave the name blocked until it is removed by
+		// hand (or the system restarts). Returns true if the name is free to create again.
+		static bool RemoveIfStale(const std::string& name)
+		{
+			int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+			if (fd < 0)
+				return errno == ENOENT;
+
+			struct stat segmentStat;
+			bool isStale = false;
+
+			if ((fstat(fd, &segmentStat) == 0) && (segmentStat.st_uid == geteuid()))
+			{
+				const bool isOld = (std::time(nullptr) - segmentStat.st_mtime) > staleSegmentSeconds;
+
+				if ((size_t)segmentStat.st_size < sizeof(SegmentHeader))
+				{
+					isStale = isOld;	// The creator died before sizing it
+				}
+				else
+				{
+					void* mapped = mmap(nullptr, sizeof(SegmentHeader), PROT_READ, MAP_SHARED, fd, 0);
+
+					if (mapped != MAP_FAILED)
+					{
+						const SegmentHeader* header = static_cast<const SegmentHeader*>(mapped);
+
+						if (header->Ready.load(std::memory_order_acquire) == 0)
+						{
+							const pid_t creator = (pid_t)header->CreatorProcess;
+
+							// Signal 0 only checks that the process exists
+							isStale = isOld || ((creator != 0) && (kill(creator, 0) != 0) && (errno == ESRCH));
+						}
+
+						munmap(mapped, sizeof(SegmentHeader));
+					}
+				}
+			}
+
+			close(fd);
+
+			if (isStale)
+				shm_unlink(name.c_str());
+
+			return isStale;
+		}
+#endif
+
+#ifdef _WIN32
+		static std::string GetMappingName(const std::string& name)
+		{
+			// POSIX names start with '/'
+			return "Local\\" + name.substr((!name.empty() && (name[0] == '/')) ? 1 : 0);
+		}
+
+		HANDLE ownedMapping = nullptr;
+#endif
+
+		uint8_t* mappedData = nullptr;
+		size_t mappedSize = 0;
+	};
+}
@@ -4,12 +4,17 @@
 // with some template ideas from https://github.com/jatinchowdhury18/RTNeural-NAM
 
 #include <array>
+#include <cassert>
+#include <memory>
+#include <span>
+#include <vector>
 #include <Eigen/Dense>
 #include <Eigen/Core>
 #include "TemplateHelper.h"
 #include "Activation.h"
 #include "ChannelBuffer.h"
 #include "MatMul.h"
+#include "WeightLayout.h"
 
 #ifndef WAVENET_MAX_NUM_FRAMES
 #define WAVENET_MAX_NUM_FRAMES 64
@@ -19,6 +24,26 @@
 #define LAYER_ARRAY_BUFFER_PADDING 24
 #endif
 
+#ifndef MULTIFRAME_8X8_CONVOLUTION
+#define MULTIFRAME_8X8_CONVOLUTION 0
+#endif
+
+#ifndef WAVENET_PREFETCH_DILATION
+#define WAVENET_PREFETCH_DILATION 100
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define WAVENET_PREFETCH(ptr) _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+#include <intrin.h>
+#define WAVENET_PREFETCH(ptr) __prefetch((const void*)(ptr))
+#elif defined(__GNUC__) || defined(__clang__)
+#define WAVENET_PREFETCH(ptr) __builtin_prefetch((const void*)(ptr), 0, 3)
+#else
+#define WAVENET_PREFETCH(ptr) ((void)(ptr))
+#endif
+
 enum EActivationType
 {
 	Tanh,
@@ -71,6 +96,16 @@ namespace NeuralAudio
 			bufferStart = ReceptiveFieldSize;
 		}
 
+		// Hint the cache about frames we are about to read. Streams from far back in the history tend to miss.
+		void PrefetchFrames(size_t startFrame, size_t numFrames) const
+		{
+			const char* ptr = reinterpret_cast<const char*>(buffer.GetDataConst(startFrame));
+			const char* end = ptr + (numFrames * Channels * sizeof(T));
+
+			for (; ptr < end; ptr += 64)
+				WAVENET_PREFETCH(ptr);
+		}
+
 		void CopyBuffer()
 		{
 			auto slice = buffer.Slice(bufferStart, 1);
@@ -82,8 +117,6 @@ namespace NeuralAudio
 		}
 	};
 
-	struct Empty {};
-
 	template <typename T, int InChannels, int OutChannels, int KernelSize, bool DoBias, int Dilation>
 	class Conv1DT
 	{
@@ -91,209 +124,258 @@ namespace NeuralAudio
 		static constexpr auto ReceptiveFieldSize = (KernelSize - 1) * Dilation;
 		ChannelHistoryBuffer<T, InChannels, ReceptiveFieldSize> channelBuffer;
 
+		static constexpr size_t TapSize = OutChannels * InChannels;
+
 		size_t GetNumWeights()
 		{
-			return OutChannels * InChannels * KernelSize + (DoBias ? OutChannels : 0);
+			return TapSize * KernelSize + (DoBias ? OutChannels : 0);
+		}
+
+		// Our layout is a column-major OutChannels x InChannels matrix for each tap, followed by the bias
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			AddWeightBlock(layout, OutChannels, InChannels, KernelSize);
+
+			if constexpr (DoBias)
+				AddWeightBlock(layout, OutChannels);
 		}
 
-		void SetWeights(std::vector<float>::iterator& inWeights)
+		// Use packed weights in place. They are not copied, and must outlive the convolution.
+		void BindWeights(const T*& packed)
 		{
-			for (size_t i = 0; i < OutChannels; i++)
-				for (size_t j = 0; j < InChannels; j++)
-					for (size_t k = 0; k < KernelSize; k++)
-						weights[k](i, j) = *(inWeights++);
+			for (size_t k = 0; k < KernelSize; k++)
+				weightPtrs[k] = packed + (k * TapSize);
+
+			packed += TapSize * KernelSize;
 
 			if constexpr (DoBias)
 			{
-				for (size_t i = 0; i < OutChannels; i++)
-					bias(i) = *(inWeights++);
+				biasPtr = packed;
+				packed += OutChannels;
 			}
 		}
 
-		std::array<ChannelBuffer<T, OutChannels, InChannels>, KernelSize>& GetWeights()
+		auto GetInputBuffer(size_t numFrames)
 		{
-			return weights;
+			return channelBuffer.buffer.Slice(channelBuffer.bufferStart, numFrames);
 		}
 
-		// Avoid allocation for unused bias
-		using BiasType = typename std::conditional<DoBias,
-			Eigen::Vector<T, OutChannels>,
-			Empty>::type;
+		static constexpr bool SupportsMultiFrame()
+		{
+			return (((InChannels == 8) && (OutChannels == 8)) || ((InChannels == 16) && (OutChannels == 16)) || ((InChannels == 4) && (OutChannels == 4)) || ((InChannels == 2) && (OutChannels == 2))) && DoBias;
+		}
 
-		BiasType& GetBias()
+		// 0 disables multi-frame convolution. Defaults to the compile-time setting, but can be changed by kernel tuning.
+		void SetMultiFrameSize(int size)
 		{
-			return bias;
+			multiFrameSize = size;
 		}
 
-		Conv1DT()
+		inline void Process(const ChannelRowSpan<T, OutChannels>& output)
 		{
-			for (int k = 0; k < KernelSize; k++)
-				weightPtrs[k] = weights[k].GetData();
+			if constexpr (SupportsMultiFrame())
+			{
+				if (multiFrameSize == 8)
+				{
+					ProcessMultiFrame<8>(output);
+
+					return;
+				}
+				else if (multiFrameSize == 4)
+				{
+					ProcessMultiFrame<4>(output);
+
+					return;
+				}
+			}
+
+			ProcessSingleFrame(output);
 		}
 
-		auto GetInputBuffer(size_t numFrames)
+	private:
+		// Large dilations read history from far enough back that it is unlikely to be in cache
+		static constexpr bool PrefetchTaps = (WAVENET_PREFETCH_DILATION > 0) && (Dilation >= WAVENET_PREFETCH_DILATION) && (KernelSize > 1);
+
+		inline void PrefetchTapInputs(size_t numFrames)
 		{
-			return channelBuffer.buffer.Slice(channelBuffer.bufferStart, numFrames);
+			// The last tap reads the current input, which is already in cache
+			for (size_t k = 0; k < (KernelSize - 1); k++)
+			{
+				const auto offset = Dilation * ((int)k + 1 - KernelSize);
+
+				channelBuffer.PrefetchFrames(channelBuffer.bufferStart + offset, numFrames);
+			}
 		}
 
-		inline void Process(const ChannelRowSpan<T, OutChannels>& output)
+		template <size_t MultiFrameSize>
+		inline void ProcessMultiFrame(const ChannelRowSpan<T, OutChannels>& output)
 		{
 			const size_t numFrames = output.GetNumCols();
 			T* __restrict outputPtr = output.GetData();
 
-#if MULTIFRAME_8X8_CONVOLUTION != 0
-			if constexpr ((((InChannels == 8) && (OutChannels == 8)) || ((InChannels == 16) && (OutChannels == 16)) || ((InChannels == 4) && (OutChannels == 4)) || ((InChannels == 2) && (OutChannels == 2))) && DoBias)
-			{
-				// Based on @jfsantos NAM Core implementation - https://github.com/sdatkinson/NeuralAmpModelerCore/pull/277
+			if constexpr (PrefetchTaps)
+				PrefetchTapInputs(numFrames);
 
-				constexpr size_t tileSize = (InChannels == 16) ? (MULTIFRAME_8X8_CONVOLUTION / 2) : MULTIFRAME_8X8_CONVOLUTION;
-				const size_t nFTile = (numFrames / tileSize) * tileSize;
+			// Based on @jfsantos NAM Core implementation - https://github.com/sdatkinson/NeuralAmpModelerCore/pull/277
 
-				for (size_t f = 0; f < nFTile; f += tileSize)
+			constexpr size_t tileSize = (InChannels == 16) ? (MultiFrameSize / 2) : MultiFrameSize;
+			const size_t nFTile = (numFrames / tileSize) * tileSize;
+
+			for (size_t f = 0; f < nFTile; f += tileSize)
+			{
+				alignas(32) T a[tileSize][InChannels]{};
+
+				for (size_t k = 0; k < KernelSize; k++)
 				{
-					alignas(32) T a[tileSize][InChannels]{};
+					const T* __restrict W = weightPtrs[k];
+					const auto offset = Dilation * (k + 1 - KernelSize);
+					const T* __restrict hb = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset + f);
 
-					for (size_t k = 0; k < KernelSize; k++)
+					for (size_t cp = 0; cp < InChannels; cp++)
 					{
-						const T* __restrict W = weightPtrs[k];
-						const auto offset = Dilation * (k + 1 - KernelSize);
-						const T* __restrict hb = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset + f);
+						const T* __restrict Wcol = W + cp * InChannels;
 
-						for (size_t cp = 0; cp < InChannels; cp++)
+						if constexpr (tileSize == 2)
 						{
-							const T* __restrict Wcol = W + cp * InChannels;
+							const T h0 = hb[cp], h1 = hb[InChannels + cp];
 
-							if constexpr (tileSize == 2)
+							for (size_t o = 0; o < InChannels; o++)
 							{
-								const T h0 = hb[cp], h1 = hb[InChannels + cp];
-
-								for (size_t o = 0; o < InChannels; o++)
-								{
-									const T wo = Wcol[o];
-									a[0][o] += wo * h0;
-									a[1][o] += wo * h1;
-								}
+								const T wo = Wcol[o];
+								a[0][o] += wo * h0;
+								a[1][o] += wo * h1;
 							}
-							else if constexpr (tileSize == 4)
+						}
+						else if constexpr (tileSize == 4)
+						{
+							const T h0 = hb[cp], h1 = hb[InChannels + cp], h2 = hb[2 * InChannels + cp], h3 = hb[3 * InChannels + cp];
+
+							for (size_t o = 0; o < InChannels; o++)
 							{
-								const T h0 = hb[cp], h1 = hb[InChannels + cp], h2 = hb[2 * InChannels + cp], h3 = hb[3 * InChannels + cp];
-
-								for (size_t o = 0; o < InChannels; o++)
-								{
-									const T wo = Wcol[o];
-									a[0][o] += wo * h0;
-									a[1][o] += wo * h1;
-									a[2][o] += wo * h2;
-									a[3][o] += wo * h3;
-								}
+								const T wo = Wcol[o];
+								a[0][o] += wo * h0;
+								a[1][o] += wo * h1;
+								a[2][o] += wo * h2;
+								a[3][o] += wo * h3;
 							}
-							else // tileSize == 8
+						}
+						else // tileSize == 8
+						{
+							const T h0 = hb[cp], h1 = hb[InChannels + cp], h2 = hb[2 * InChannels + cp], h3 = hb[3 * InChannels + cp];
+							const T h4 = hb[4 * InChannels + cp], h5 = hb[5 * InChannels + cp], h6 = hb[6 * InChannels + cp], h7 = hb[7 * InChannels + cp];
+
+							for (size_t o = 0; o < InChannels; o++)
 							{
-								const T h0 = hb[cp], h1 = hb[InChannels + cp], h2 = hb[2 * InChannels + cp], h3 = hb[3 * InChannels + cp];
-								const T h4 = hb[4 * InChannels + cp], h5 = hb[5 * InChannels + cp], h6 = hb[6 * InChannels + cp], h7 = hb[7 * InChannels + cp];
-
-								for (size_t o = 0; o < InChannels; o++)
-								{
-									const T wo = Wcol[o];
-									a[0][o] += wo * h0;
-									a[1][o] += wo * h1;
-									a[2][o] += wo * h2;
-									a[3][o] += wo * h3;
-									a[4][o] += wo * h4;
-									a[5][o] += wo * h5;
-									a[6][o] += wo * h6;
-									a[7][o] += wo * h7;
-								}
+								const T wo = Wcol[o];
+								a[0][o] += wo * h0;
+								a[1][o] += wo * h1;
+								a[2][o] += wo * h2;
+								a[3][o] += wo * h3;
+								a[4][o] += wo * h4;
+								a[5][o] += wo * h5;
+								a[6][o] += wo * h6;
+								a[7][o] += wo * h7;
 							}
 						}
 					}
-
-					for (size_t ti = 0; ti < tileSize; ti++)
-						std::memcpy(outputPtr + static_cast<size_t>(f + ti) * InChannels, a[ti], InChannels * sizeof(T));
 				}
 
-				// Scalar tail for any frames past the tile-aligned boundary.
-				for (size_t f = nFTile; f < numFrames; f++)
-				{
-					T* zf = outputPtr + static_cast<size_t>(f) * InChannels;
+				for (size_t ti = 0; ti < tileSize; ti++)
+					std::memcpy(outputPtr + static_cast<size_t>(f + ti) * InChannels, a[ti], InChannels * sizeof(T));
+			}
 
-					for (size_t o = 0; o < InChannels; o++)
-						zf[o] = TCONST(0.0);
+			// Scalar tail for any frames past the tile-aligned boundary.
+			for (size_t f = nFTile; f < numFrames; f++)
+			{
+				T* zf = outputPtr + static_cast<size_t>(f) * InChannels;
 
-					for (size_t k = 0; k < KernelSize; k++)
-					{
-						const T* W = weightPtrs[k];
-						const auto offset = Dilation * (k + 1 - KernelSize);
-						const T* h = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset + f);
+				for (size_t o = 0; o < InChannels; o++)
+					zf[o] = TCONST(0.0);
 
-						for (int cp = 0; cp < InChannels; cp++)
-						{
-							const T hv = h[cp];
-							const T* Wcol = W + cp * InChannels;
+				for (size_t k = 0; k < KernelSize; k++)
+				{
+					const T* W = weightPtrs[k];
+					const auto offset = Dilation * (k + 1 - KernelSize);
+					const T* h = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset + f);
 
-							for (size_t o = 0; o < InChannels; o++)
-								zf[o] += Wcol[o] * hv;
-						}
+					for (int cp = 0; cp < InChannels; cp++)
+					{
+						const T hv = h[cp];
+						const T* Wcol = W + cp * InChannels;
+
+						for (size_t o = 0; o < InChannels; o++)
+							zf[o] += Wcol[o] * hv;
 					}
 				}
 			}
-			else
-#endif
+
+			if constexpr (DoBias && !MatMul<T, InChannels, OutChannels>::HasKernel())
+				output.GetEigenMap().colwise() += GetBias();
+		}
+
+		inline void ProcessSingleFrame(const ChannelRowSpan<T, OutChannels>& output)
+		{
+			const size_t numFrames = output.GetNumCols();
+			T* __restrict outputPtr = output.GetData();
+
+			if constexpr (PrefetchTaps)
+				PrefetchTapInputs(numFrames);
+
+			for (size_t k = 0; k < KernelSize; k++)
 			{
-				const T* biasPtr = nullptr;
-				
-				if constexpr (DoBias)
-				{
-					biasPtr = bias.data();
-				}
+				const T* weightPtr = weightPtrs[k];
 
-				for (size_t k = 0; k < KernelSize; k++)
-				{
-					const T* weightPtr = this->weights[k].GetDataConst();
+				const auto offset = Dilation * ((int)k + 1 - KernelSize);
 
-					const auto offset = Dilation * ((int)k + 1 - KernelSize);
+				if constexpr (DoBias && MatMul<T, InChannels, OutChannels>::HasKernel())
+				{
+					const T* inputPtr = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset);
 
-					if constexpr (DoBias && MatMul<T, InChannels, OutChannels>::HasKernel())
+					if (k == 0)	// Maybe move this out of loop?
 					{
-						const T* inputPtr = channelBuffer.buffer.GetDataConst(channelBuffer.bufferStart + offset);
-
-						if (k == 0)	// Maybe move this out of loop?
+						if constexpr (DoBias)
 						{
-							if constexpr (DoBias)
-							{
-								MatMul<T, InChannels, OutChannels>::MultiplyInitColwise(inputPtr, outputPtr, weightPtr, biasPtr, numFrames);
-							}
-							else
-							{
-								MatMul<T, InChannels, OutChannels>::MultiplyInitZero(inputPtr, outputPtr, weightPtr, numFrames);
-							}
+							MatMul<T, InChannels, OutChannels>::MultiplyInitColwise(inputPtr, outputPtr, weightPtr, biasPtr, numFrames);
 						}
 						else
 						{
-							MatMul<T, InChannels, OutChannels>::MultiplyAccumlulate(inputPtr, outputPtr, weightPtr, numFrames);
+							MatMul<T, InChannels, OutChannels>::MultiplyInitZero(inputPtr, outputPtr, weightPtr, numFrames);
 						}
 					}
 					else
 					{
-						const auto inBlock = channelBuffer.buffer.Slice(channelBuffer.bufferStart + offset, numFrames);
-
-						if (k == 0)
-							output.GetEigenMap().noalias() = weights[k].GetEigenMapConst() * inBlock.GetEigenMapConst();
-						else
-							output.GetEigenMap().noalias() += weights[k].GetEigenMapConst() * inBlock.GetEigenMapConst();
+						MatMul<T, InChannels, OutChannels>::MultiplyAccumlulate(inputPtr, outputPtr, weightPtr, numFrames);
 					}
 				}
+				else
+				{
+					const auto inBlock = channelBuffer.buffer.Slice(channelBuffer.bufferStart + offset, numFrames);
+
+					if (k == 0)
+						output.GetEigenMap().noalias() = GetTapWeights(k) * inBlock.GetEigenMapConst();
+					else
+						output.GetEigenMap().noalias() += GetTapWeights(k) * inBlock.GetEigenMapConst();
+				}
 			}
 
 			if constexpr (DoBias && !MatMul<T, InChannels, OutChannels>::HasKernel())
-				output.GetEigenMap().colwise() += bias;
+				output.GetEigenMap().colwise() += GetBias();
 		}
 
-	private:
-		alignas(32) std::array<ChannelBuffer<T, OutChannels, InChannels>, KernelSize> weights;	// consider making this a contiguous block of data instead of block of ChannelBuffers
-		std::array<T *, KernelSize> weightPtrs;
+		auto GetTapWeights(size_t k) const
+		{
+			return Eigen::Map<const Eigen::Matrix<T, OutChannels, InChannels>>(weightPtrs[k]);
+		}
+
+		auto GetBias() const
+		{
+			return Eigen::Map<const Eigen::Vector<T, OutChannels>>(biasPtr);
+		}
 
-		BiasType bias;
+		// Weights are read only, and may be shared with other instances of the model
+		std::array<const T*, KernelSize> weightPtrs{};
+		const T* biasPtr = nullptr;
+		int multiFrameSize = MULTIFRAME_8X8_CONVOLUTION;
 	};
 
 	template <typename T, int InSize, int OutSize, bool DoBias>
@@ -305,32 +387,26 @@ namespace NeuralAudio
 			return OutSize * InSize + (DoBias ? OutSize : 0);
 		}
 
-		void SetWeights(std::vector<float>::iterator& inWeights)
+		// Our layout is a column-major OutSize x InSize matrix, followed by the bias
+		void AddWeightLayout(WeightLayout& layout) const
 		{
-			for (size_t i = 0; i < OutSize; i++)
-				for (size_t j = 0; j < InSize; j++)
-					weights(i, j) = *(inWeights++);
+			AddWeightBlock(layout, OutSize, InSize);
 
 			if constexpr (DoBias)
-			{
-				for (size_t i = 0; i < OutSize; i++)
-					bias(i) = *(inWeights++);
-			}
+				AddWeightBlock(layout, OutSize);
 		}
 
-		ChannelBuffer<T, OutSize, InSize>& GetWeights()
+		// Use packed weights in place. They are not copied, and must outlive the layer.
+		void BindWeights(const T*& packed)
 		{
-			return weights;
-		}
+			weightPtr = packed;
+			packed += OutSize * InSize;
 
-		// Avoid allocation for unused bias
-		using BiasType = typename std::conditional<DoBias,
-			Eigen::Vector<T, OutSize>,
-			Empty>::type;
-
-		BiasType& GetBias()
-		{
-			return bias;
+			if constexpr (DoBias)
+			{
+				biasPtr = packed;
+				packed += OutSize;
+			}
 		}
 
 		void Process(const ChannelRowSpan<T, InSize>& input, const ChannelRowSpan<T, OutSize>& output) const
@@ -341,22 +417,22 @@ namespace NeuralAudio
 			{
 				if constexpr (DoBias)
 				{
-					MatMul<T, InSize, OutSize>::MultiplyInitColwise(input.GetDataConst(), output.GetData(), weights.GetDataConst(), bias.data(), numFrames);
+					MatMul<T, InSize, OutSize>::MultiplyInitColwise(input.GetDataConst(), output.GetData(), weightPtr, biasPtr, numFrames);
 				}
 				else
 				{
-					MatMul<T, InSize, OutSize>::MultiplyInitZero(input.GetDataConst(), output.GetData(), weights.GetDataConst(), numFrames);
+					MatMul<T, InSize, OutSize>::MultiplyInitZero(input.GetDataConst(), output.GetData(), weightPtr, numFrames);
 				}
 			}
 			else
 			{
 				if constexpr (DoBias)
 				{
-					output.GetEigenMap().noalias() = (weights.GetEigenMapConst() * input.GetEigenMapConst()).colwise() + bias;
+					output.GetEigenMap().noalias() = (GetWeights() * input.GetEigenMapConst()).colwise() + GetBias();
 				}
 				else
 				{
-					output.GetEigenMap().noalias() = weights.GetEigenMapConst() * input.GetEigenMapConst();
+					output.GetEigenMap().noalias() = GetWeights() * input.GetEigenMapConst();
 				}
 			}
 		}
@@ -367,25 +443,35 @@ namespace NeuralAudio
 
 			if constexpr (!DoBias && MatMul<T, InSize, OutSize>::HasKernel())
 			{
-				MatMul<T, InSize, OutSize>::MultiplyAccumlulate(input.GetDataConst(), output.GetData(), weights.GetDataConst(), numFrames);
+				MatMul<T, InSize, OutSize>::MultiplyAccumlulate(input.GetDataConst(), output.GetData(), weightPtr, numFrames);
 			}
 			else
 			{
 				if constexpr (DoBias)
 				{
-					output.GetEigenMap().noalias() += (weights.GetEigenMapConst() * input.GetEigenMapConst()) + bias;
+					output.GetEigenMap().noalias() += (GetWeights() * input.GetEigenMapConst()).colwise() + GetBias();
 				}
 				else
 				{
-					output.GetEigenMap().noalias() += weights.GetEigenMapConst() * input.GetEigenMapConst();
+					output.GetEigenMap().noalias() += GetWeights() * input.GetEigenMapConst();
 				}
 			}
 		}
 
 	private:
-		ChannelBuffer<T, OutSize, InSize> weights;
-		
-		BiasType bias;
+		auto GetWeights() const
+		{
+			return Eigen::Map<const Eigen::Matrix<T, OutSize, InSize>>(weightPtr);
+		}
+
+		auto GetBias() const
+		{
+			return Eigen::Map<const Eigen::Vector<T, OutSize>>(biasPtr);
+		}
+
+		// Weights are read only, and may be shared with other instances of the model
+		const T* weightPtr = nullptr;
+		const T* biasPtr = nullptr;
 	};
 
 	template <typename T, int ConditionSize, int Channels, int KernelSize, int Dilation, EActivationType Activation>
@@ -417,11 +503,23 @@ namespace NeuralAudio
 			return conv1D.GetNumWeights() + inputMixin.GetNumWeights() + oneByOne.GetNumWeights();
 		}
 
-		void SetWeights(std::vector<float>::iterator& weights)
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			conv1D.AddWeightLayout(layout);
+			inputMixin.AddWeightLayout(layout);
+			oneByOne.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const T*& packed)
+		{
+			conv1D.BindWeights(packed);
+			inputMixin.BindWeights(packed);
+			oneByOne.BindWeights(packed);
+		}
+
+		void SetConvolutionTileSize(int tileSize)
 		{
-			conv1D.SetWeights(weights);
-			inputMixin.SetWeights(weights);
-			oneByOne.SetWeights(weights);
+			conv1D.SetMultiFrameSize(tileSize);
 		}
 
 		Conv1DT<T, Channels, Channels, KernelSize, true, Dilation>& GetConv1D()
@@ -459,7 +557,7 @@ namespace NeuralAudio
 			conv1D.channelBuffer.CopyBuffer();
 		}
 
-		template <bool NeedOutput = true>
+		template <bool NeedOutput = true, bool InitHeadInput = false>
 		void Process(const ChannelRowSpan<T, ConditionSize>& condition, const ChannelRowSpan<T, Channels>& headInput, const ChannelRowSpan<T, Channels>& output)
 		{
 			size_t numFrames = output.GetNumCols();
@@ -479,7 +577,14 @@ namespace NeuralAudio
 				WAVENET_MATH<T>::template LeakyReLU<Channels>(block);
 			}
 
-			headInput.GetEigenMap().noalias() += block.GetEigenMapConst();
+			if constexpr (InitHeadInput)
+			{
+				headInput.GetEigenMap().noalias() = block.GetEigenMapConst();
+			}
+			else
+			{
+				headInput.GetEigenMap().noalias() += block.GetEigenMapConst();
+			}
 
 			//headInput.AddData(block);
 
@@ -567,16 +672,38 @@ namespace NeuralAudio
 			return numWeights;
 		}
 
-		void SetWeights(std::vector<float>::iterator& weights)
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			rechannel.AddWeightLayout(layout);
+
+			ForEachIndex<NumLayers>([&](auto layerIndex)
+				{
+					std::get<layerIndex>(layers).AddWeightLayout(layout);
+				});
+
+			headRechannel.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const T*& packed)
 		{
-			rechannel.SetWeights(weights);
+			rechannel.BindWeights(packed);
+
+			ForEachIndex<NumLayers>([&](auto layerIndex)
+				{
+					std::get<layerIndex>(layers).BindWeights(packed);
+				});
+
+			headRechannel.BindWeights(packed);
+		}
 
+		void SetConvolutionTileSize(int tileSize)
+		{
 			ForEachIndex<NumLayers>([&](auto layerIndex)
 				{
-					std::get<layerIndex>(layers).SetWeights(weights);
+					std::get<layerIndex>(layers).SetConvolutionTileSize(tileSize);
 				});
 
-			headRechannel.SetWeights(weights);
+			headRechannel.SetMultiFrameSize(tileSize);
 		}
 
 		Layers& GetLayers()
@@ -629,7 +756,8 @@ namespace NeuralAudio
 			headRechannel.Process(headOutputs.Slice(1));
 		}
 
-		template <bool NeedOutput = true>
+		// InitHeadInputs lets the first layer overwrite headInputs instead of accumulating into it, so the caller doesn't need to clear it
+		template <bool NeedOutput = true, bool InitHeadInputs = false>
 		void Process(const ChannelRowSpan<T, InputSize>& layerInputs, const ChannelRowSpan<T, ConditionSize>& condition, const ChannelRowSpan<T, Channels>& headInputs)
 		{
 			size_t numFrames = condition.GetNumCols();
@@ -638,13 +766,15 @@ namespace NeuralAudio
 
 			ForEachIndex<NumLayers>([&](auto layerIndex)
 				{
+					constexpr bool initHead = InitHeadInputs && (layerIndex == 0);
+
 					if constexpr (layerIndex == LastLayer)
 					{
-						std::get<layerIndex>(layers).template Process<NeedOutput>(condition, headInputs, arrayOutputs.Slice(numFrames));
+						std::get<layerIndex>(layers).template Process<NeedOutput, initHead>(condition, headInputs, arrayOutputs.Slice(numFrames));
 					}
 					else
 					{
-						std::get<layerIndex>(layers).Process(condition, headInputs,	std::get<layerIndex + 1>(layers).GetInputBuffer(numFrames));
+						std::get<layerIndex>(layers).template Process<true, initHead>(condition, headInputs, std::get<layerIndex + 1>(layers).GetInputBuffer(numFrames));
 					}
 
 					std::get<layerIndex>(layers).AdvanceFrames(numFrames);
@@ -668,6 +798,7 @@ namespace NeuralAudio
 		int ReceptiveFieldSize = 0;	// This should be a static constexpr, but I haven't sorted out the right template magic
 
 		static constexpr auto headLayerChannels = std::tuple_element_t<0, std::tuple<LayerArrays...>>::NumChannelsP;
+		static constexpr auto headLayerHeadSize = std::tuple_element_t<0, std::tuple<LayerArrays...>>::HeadSizeP;
 		static constexpr auto NumLayerArrays = std::tuple_size_v<std::tuple<LayerArrays...>>;
 		static constexpr auto LastLayerArray = NumLayerArrays - 1;
 
@@ -697,7 +828,7 @@ namespace NeuralAudio
 			return numWeights;
 		}
 
-		void SetWeights(std::vector<float> weights)
+		void SetWeights(std::span<const float> weights)
 		{
 			size_t numWeights = GetNumWeights();
 
@@ -708,14 +839,84 @@ namespace NeuralAudio
 				throw std::runtime_error(str.str());
 			}
 
-			std::vector<float>::iterator it = weights.begin();
+			auto packedWeights = std::make_shared<std::vector<T>>(numWeights);
+
+			PackWeights(weights, GetWeightLayout(), packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
+
+		// Layout of our packed weights - each layer array in turn, then the head scale
+		WeightLayout GetWeightLayout() const
+		{
+			WeightLayout layout;
+
+			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
+				{
+					std::get<layerIndex>(layerArrays).AddWeightLayout(layout);
+				});
+
+			AddWeightBlock(layout, 1);	// headScale
+
+			return layout;
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive, and they
+		// may be shared with other instances.
+		void SetSharedWeights(const T* packedWeights, std::shared_ptr<const void> owner)
+		{
+			weightsOwner = std::move(owner);
+
+			const T* packed = packedWeights;
+
+			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
+				{
+					std::get<layerIndex>(layerArrays).BindWeights(packed);
+				});
+
+			headScale = *(packed++);
+		}
+
+		const std::shared_ptr<const void>& GetSharedWeights() const
+		{
+			return weightsOwner;
+		}
+
+		// New instance that shares our weights, and starts with a copy of our state
+		WaveNetModelT* CreateSharedInstance() const
+		{
+			return new WaveNetModelT(*this);
+		}
+
+		// Other must share our weights. Only copies buffers, so doesn't allocate.
+		void CopyState(const WaveNetModelT& other)
+		{
+			assert(other.weightsOwner == weightsOwner);
+
+			*this = other;
+		}
+
+		std::string GetArchitectureSignature()
+		{
+			std::string signature = "WaveNet";
 
 			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
 				{
-					std::get<layerIndex>(layerArrays).SetWeights(it);
+					using LayerArrayType = std::tuple_element_t<layerIndex, std::tuple<LayerArrays...>>;
+
+					signature += "_" + std::to_string(LayerArrayType::NumChannelsP) + "x" + std::to_string(LayerArrayType::HeadSizeP) + "x" + std::to_string(LayerArrayType::NumLayers);
 				});
 
-			headScale = *(it++);
+			return signature + "_rf" + std::to_string(ReceptiveFieldSize);
+		}
+
+		// Multi-frame convolution tile size (0, 4 or 8)
+		void SetConvolutionTileSize(int tileSize)
+		{
+			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
+				{
+					std::get<layerIndex>(layerArrays).SetConvolutionTileSize(tileSize);
+				});
 		}
 
 		size_t GetMaxFrames()
@@ -728,11 +929,6 @@ namespace NeuralAudio
 			return layerArrays;
 		}
 
-		ChannelBuffer<T, 1, WAVENET_MAX_NUM_FRAMES>& GetCondition()
-		{
-			return condition;
-		}
-
 		ChannelBuffer<T, headLayerChannels, WAVENET_MAX_NUM_FRAMES>& GetHeadArray()
 		{
 			return headArray;
@@ -745,11 +941,11 @@ namespace NeuralAudio
 
 		void Prewarm()
 		{
-			condition.GetData()[0] = 0;
+			T silence = 0;
 
 			headArray.SetZero();
 
-			auto conditionSpan = condition.Slice(1);
+			auto conditionSpan = ChannelRowSpan<T, 1>(&silence, 1);
 			auto headArraySpan = headArray.Slice(1);
 
 			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
@@ -767,18 +963,20 @@ namespace NeuralAudio
 
 		void Process(const T* input, T* output, const size_t numFrames)
 		{
-			std::memcpy(condition.GetData(), input, numFrames * sizeof(T));
-
-			headArray.SetZero();
-
-			auto conditionSpan = condition.Slice(numFrames);
+			// The input is only ever read, so the condition can reference it directly instead of being copied.
+			// The output is only written once all layer arrays are done, so in-place processing is still safe.
+			auto conditionSpan = ChannelRowSpan<T, 1>(const_cast<T*>(input), numFrames);
 			auto headArraySpan = headArray.Slice(numFrames);
 
 			ForEachIndex<sizeof...(LayerArrays)>([&](auto layerIndex)
 				{
-					if constexpr (layerIndex == 0)
+					if constexpr ((layerIndex == 0) && (layerIndex == LastLayerArray))
+					{
+						std::get<layerIndex>(layerArrays).template Process<false, true>(conditionSpan, conditionSpan, headArraySpan);
+					}
+					else if constexpr (layerIndex == 0)
 					{
-						std::get<layerIndex>(layerArrays).Process(conditionSpan, conditionSpan, headArraySpan);
+						std::get<layerIndex>(layerArrays).template Process<true, true>(conditionSpan, conditionSpan, headArraySpan);
 					}
 					else if constexpr (layerIndex == LastLayerArray)
 					{
@@ -800,8 +998,8 @@ namespace NeuralAudio
 
 	private:
 		std::tuple<LayerArrays...> layerArrays;
-		ChannelBuffer<T, 1, WAVENET_MAX_NUM_FRAMES> condition;
 		ChannelBuffer<T, headLayerChannels, WAVENET_MAX_NUM_FRAMES> headArray;
 		T headScale;
+		std::shared_ptr<const void> weightsOwner;
 	};
 }
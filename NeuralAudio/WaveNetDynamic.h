@@ -3,9 +3,16 @@
 // Based on WaveNet model structure from https://github.com/sdatkinson/NeuralAmpModelerCore
 // with some template ideas from https://github.com/jatinchowdhury18/RTNeural-NAM
 
+#include <cassert>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 #include <Eigen/Dense>
 #include <Eigen/Core>
 #include "Activation.h"
+#include "WeightLayout.h"
 
 #ifndef WAVENET_MAX_NUM_FRAMES
 #define WAVENET_MAX_NUM_FRAMES 64
@@ -25,8 +32,8 @@ namespace NeuralAudio
 		size_t kernelSize;
 		bool doBias;
 		size_t dilation;
-		std::vector<Eigen::MatrixXf> weights;
-		Eigen::VectorXf bias;
+		const float* weights = nullptr;	// Read only, and may be shared with other instances of the model
+		const float* bias = nullptr;
 
 	public:
 		Conv1D(size_t inChannels, size_t outChannels, size_t kernelSize, bool doBias, size_t dilation) :
@@ -36,31 +43,32 @@ namespace NeuralAudio
 			doBias(doBias),
 			dilation(dilation)
 		{
-			for (size_t k = 0; k < kernelSize; k++)
-			{
-				auto kernelWeights = Eigen::MatrixXf(outChannels, inChannels);
-				weights.push_back(kernelWeights);
-			}
+		}
 
-			if (doBias)
-			{
-				bias.resize(outChannels);
-			}
+		size_t GetNumWeights() const
+		{
+			return (outChannels * inChannels * kernelSize) + (doBias ? outChannels : 0);
 		}
 
-		void SetWeights(std::vector<float>::iterator& inWeights)
+		// Same layout as Conv1DT - a column-major outChannels x inChannels matrix for each tap, followed by the bias
+		void AddWeightLayout(WeightLayout& layout) const
 		{
-			weights.resize(kernelSize);
+			AddWeightBlock(layout, outChannels, inChannels, kernelSize);
+
+			if (doBias)
+				AddWeightBlock(layout, outChannels);
+		}
 
-			for (size_t i = 0; i < outChannels; i++)
-				for (size_t j = 0; j < inChannels; j++)
-					for (size_t k = 0; k < kernelSize; k++)
-						weights[k](i, j) = *(inWeights++);
+		// Use packed weights in place. They are not copied, and must outlive the convolution.
+		void BindWeights(const float*& packed)
+		{
+			weights = packed;
+			packed += outChannels * inChannels * kernelSize;
 
 			if (doBias)
 			{
-				for (size_t i = 0; i < outChannels; i++)
-					bias(i) = *(inWeights++);
+				bias = packed;
+				packed += outChannels;
 			}
 		}
 
@@ -71,15 +79,16 @@ namespace NeuralAudio
 				size_t offset = dilation * (k + 1 - kernelSize);
 
 				auto& inBlock = input.middleCols(iStart + offset, nCols);
+				auto tapWeights = Eigen::Map<const Eigen::MatrixXf>(weights + (k * outChannels * inChannels), outChannels, inChannels);
 
 				if (k == 0)
-					output.noalias() = weights[k] * inBlock;
+					output.noalias() = tapWeights * inBlock;
 				else
-					output.noalias() += weights[k] * inBlock;
+					output.noalias() += tapWeights * inBlock;
 			}
 
 			if (doBias)
-				output.colwise() += bias;
+				output.colwise() += Eigen::Map<const Eigen::VectorXf>(bias, outChannels);
 		}
 	};
 
@@ -89,32 +98,51 @@ namespace NeuralAudio
 		size_t inSize;
 		size_t outSize;
 		bool doBias;
-		Eigen::MatrixXf weights;
-		Eigen::VectorXf bias;
+		const float* weights = nullptr;	// Read only, and may be shared with other instances of the model
+		const float* bias = nullptr;
+
+		auto GetWeights() const
+		{
+			return Eigen::Map<const Eigen::MatrixXf>(weights, outSize, inSize);
+		}
+
+		auto GetBias() const
+		{
+			return Eigen::Map<const Eigen::VectorXf>(bias, outSize);
+		}
 
 	public:
 		DenseLayer(size_t inSize, size_t outSize, bool doBias) :
 			inSize(inSize),
 			outSize(outSize),
-			doBias(doBias),
-			weights(outSize, inSize)
+			doBias(doBias)
+		{
+		}
+
+		size_t GetNumWeights() const
 		{
+			return (outSize * inSize) + (doBias ? outSize : 0);
+		}
+
+		// Same layout as DenseLayerT - a column-major outSize x inSize matrix, followed by the bias
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			AddWeightBlock(layout, outSize, inSize);
+
 			if (doBias)
-			{
-				bias.resize(outSize);
-			}
+				AddWeightBlock(layout, outSize);
 		}
 
-		void SetWeights(std::vector<float>::iterator& inWeights)
+		// Use packed weights in place. They are not copied, and must outlive the layer.
+		void BindWeights(const float*& packed)
 		{
-			for (size_t i = 0; i < outSize; i++)
-				for (size_t j = 0; j < inSize; j++)
-					weights(i, j) = *(inWeights++);
+			weights = packed;
+			packed += outSize * inSize;
 
 			if (doBias)
 			{
-				for (size_t i = 0; i < outSize; i++)
-					bias(i) = *(inWeights++);
+				bias = packed;
+				packed += outSize;
 			}
 		}
 
@@ -122,11 +150,11 @@ namespace NeuralAudio
 		{
 			if (doBias)
 			{
-				output.noalias() = (weights * input).colwise() + bias;
+				output.noalias() = (GetWeights() * input).colwise() + GetBias();
 			}
 			else
 			{
-				output.noalias() = weights * input;
+				output.noalias() = GetWeights() * input;
 			}
 		}
 
@@ -134,11 +162,11 @@ namespace NeuralAudio
 		{
 			if (doBias)
 			{
-				output.noalias() += (weights * input).colwise() + bias;
+				output.noalias() += (GetWeights() * input).colwise() + GetBias();
 			}
 			else
 			{
-				output.noalias() += weights * input;
+				output.noalias() += GetWeights() * input;
 			}
 		}
 	};
@@ -189,11 +217,23 @@ namespace NeuralAudio
 #endif
 		}
 
-		void SetWeights(std::vector<float>::iterator& weights)
+		size_t GetNumWeights() const
 		{
-			conv1D.SetWeights(weights);
-			inputMixin.SetWeights(weights);
-			oneByOne.SetWeights(weights);
+			return conv1D.GetNumWeights() + inputMixin.GetNumWeights() + oneByOne.GetNumWeights();
+		}
+
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			conv1D.AddWeightLayout(layout);
+			inputMixin.AddWeightLayout(layout);
+			oneByOne.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const float*& packed)
+		{
+			conv1D.BindWeights(packed);
+			inputMixin.BindWeights(packed);
+			oneByOne.BindWeights(packed);
 		}
 
 		void SetMaxFrames(const size_t maxFrames)
@@ -315,16 +355,40 @@ namespace NeuralAudio
 			}
 		}
 
-		void SetWeights(std::vector<float>::iterator& weights)
+		size_t GetNumWeights() const
+		{
+			size_t numWeights = rechannel.GetNumWeights() + headRechannel.GetNumWeights();
+
+			for (auto& layer : layers)
+			{
+				numWeights += layer.GetNumWeights();
+			}
+
+			return numWeights;
+		}
+
+		void AddWeightLayout(WeightLayout& layout) const
+		{
+			rechannel.AddWeightLayout(layout);
+
+			for (auto& layer : layers)
+			{
+				layer.AddWeightLayout(layout);
+			}
+
+			headRechannel.AddWeightLayout(layout);
+		}
+
+		void BindWeights(const float*& packed)
 		{
-			rechannel.SetWeights(weights);
+			rechannel.BindWeights(packed);
 
 			for (auto& layer : layers)
 			{
-				layer.SetWeights(weights);
+				layer.BindWeights(packed);
 			}
 
-			headRechannel.SetWeights(weights);
+			headRechannel.BindWeights(packed);
 		}
 
 		void Prewarm(const Eigen::MatrixXf& layerInputs, const Eigen::MatrixXf& condition, Eigen::Ref<Eigen::MatrixXf> const& headInputs)
@@ -376,6 +440,7 @@ namespace NeuralAudio
 		Eigen::MatrixXf headArray;
 		float headScale;
 		size_t maxFrames;
+		std::shared_ptr<const void> weightsOwner;
 
 	public:
 		WaveNetModel(std::vector<WaveNetLayerArray>& layerArrays) :
@@ -391,18 +456,84 @@ namespace NeuralAudio
 			}
 		}
 
-		void SetWeights(std::vector<float> weights)
+		size_t GetNumWeights() const
 		{
-			std::vector<float>::iterator it = weights.begin();
+			size_t numWeights = 1;	// headScale
 
 			for (auto& layerArray : layerArrays)
 			{
-				layerArray.SetWeights(it);
+				numWeights += layerArray.GetNumWeights();
+			}
+
+			return numWeights;
+		}
+
+		void SetWeights(std::span<const float> weights)
+		{
+			size_t numWeights = GetNumWeights();
+
+			if (numWeights != weights.size())
+			{
+				std::stringstream str;
+				str << "Wrong number of weights. Expected " << numWeights << " but got " << weights.size();
+				throw std::runtime_error(str.str());
 			}
 
-			headScale = *(it++);
+			auto packedWeights = std::make_shared<std::vector<float>>(numWeights);
+
+			PackWeights(weights, GetWeightLayout(), packedWeights->data());
+
+			SetSharedWeights(packedWeights->data(), packedWeights);
+		}
+
+		// Layout of our packed weights - each layer array in turn, then the head scale
+		WeightLayout GetWeightLayout() const
+		{
+			WeightLayout layout;
+
+			for (auto& layerArray : layerArrays)
+			{
+				layerArray.AddWeightLayout(layout);
+			}
+
+			AddWeightBlock(layout, 1);	// headScale
+
+			return layout;
+		}
+
+		// Use weights that are already in our layout (see GetWeightLayout()) in place. The owner keeps them alive, and they
+		// may be shared with other instances.
+		void SetSharedWeights(const float* packedWeights, std::shared_ptr<const void> owner)
+		{
+			weightsOwner = std::move(owner);
+
+			const float* packed = packedWeights;
+
+			for (auto& layerArray : layerArrays)
+			{
+				layerArray.BindWeights(packed);
+			}
+
+			headScale = *(packed++);
+		}
+
+		const std::shared_ptr<const void>& GetSharedWeights() const
+		{
+			return weightsOwner;
+		}
+
+		// New instance that shares our weights, and starts with a copy of our state
+		WaveNetModel* CreateSharedInstance() const
+		{
+			return new WaveNetModel(*this);
+		}
+
+		// Other must share our weights. Buffers are already the right size, so this doesn't allocate.
+		void CopyState(const WaveNetModel& other)
+		{
+			assert(other.weightsOwner == weightsOwner);
 
-			assert(std::distance(weights.begin(), it) == (long)weights.size());
+			*this = other;
 		}
 
 		size_t GetMaxFrames()
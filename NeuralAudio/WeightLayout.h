@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace NeuralAudio
+{
+	// A block of model weights. NAM stores it as Rows x Cols x Taps (row major), and the internal engines use a column-major
+	// Rows x Cols matrix for each tap. If GateSize is non-zero, the rows are LSTM gates (i, f, g, o order), and the engines
+	// swap the last two gates so that the sigmoid gates are contiguous.
+	struct WeightBlock
+	{
+		size_t Rows = 0;
+		size_t Cols = 1;
+		size_t Taps = 1;
+		size_t GateSize = 0;
+
+		size_t GetSize() const
+		{
+			return Rows * Cols * Taps;
+		}
+
+		// Stored the same way by NAM and the engines
+		bool IsCopy() const
+		{
+			return (Cols == 1) && (Taps == 1) && (GateSize == 0);
+		}
+
+		bool operator==(const WeightBlock& other) const = default;
+	};
+
+	// The weights of a model, block by block
+	using WeightLayout = std::vector<WeightBlock>;
+
+	// Blocks that don't need reordering are merged, so that layouts of the same weights always compare equal
+	inline void AddWeightBlock(WeightLayout& layout, size_t rows, size_t cols = 1, size_t taps = 1, size_t gateSize = 0)
+	{
+		WeightBlock block = { rows, cols, taps, gateSize };
+
+		if (block.GetSize() == 0)
+			return;
+
+		if ((gateSize == 0) && (((rows > 1) + (cols > 1) + (taps > 1)) <= 1))
+			block = { block.GetSize(), 1, 1, 0 };
+
+		if (block.IsCopy() && !layout.empty() && layout.back().IsCopy())
+			layout.back().Rows += block.Rows;
+		else
+			layout.push_back(block);
+	}
+
+	inline size_t GetWeightLayoutSize(const WeightLayout& layout)
+	{
+		size_t size = 0;
+
+		for (auto& block : layout)
+			size += block.GetSize();
+
+		return size;
+	}
+
+	namespace WeightLayoutDetail
+	{
+		inline size_t GetEngineRow(const WeightBlock& block, size_t row)
+		{
+			if (block.GateSize == 0)
+				return row;
+
+			const size_t gate = row / block.GateSize;
+
+			if (gate == 2)
+				return row + block.GateSize;	// g
+
+			if (gate == 3)
+				return row - block.GateSize;	// o
+
+			return row;
+		}
+
+		template <typename T, bool ToEngine>
+		void ConvertWeights(const float* from, T* to, const WeightLayout& layout)
+		{
+			for (auto& block : layout)
+			{
+				if (block.IsCopy())
+				{
+					for (size_t i = 0; i < block.Rows; i++)
+						to[i] = (T)from[i];
+				}
+				else
+				{
+					for (size_t row = 0; row < block.Rows; row++)
+					{
+						const size_t engineRow = GetEngineRow(block, row);
+
+						for (size_t col = 0; col < block.Cols; col++)
+						{
+							for (size_t tap = 0; tap < block.Taps; tap++)
+							{
+								const size_t namIndex = (((row * block.Cols) + col) * block.Taps) + tap;
+								const size_t engineIndex = (((tap * block.Cols) + col) * block.Rows) + engineRow;
+
+								if constexpr (ToEngine)
+									to[engineIndex] = (T)from[namIndex];
+								else
+									to[namIndex] = (T)from[engineIndex];
+							}
+						}
+					}
+				}
+
+				from += block.GetSize();
+				to += block.GetSize();
+			}
+		}
+	}
+
+	// Convert NAM ordered weights to the engine layout. There must be GetWeightLayoutSize() of them.
+	template <typename T>
+	void PackWeights(std::span<const float> weights, const WeightLayout& layout, T* packed)
+	{
+		WeightLayoutDetail::ConvertWeights<T, true>(weights.data(), packed, layout);
+	}
+
+	// Convert weights in the engine layout back to NAM order
+	inline void UnpackWeights(std::span<const float> packed, const WeightLayout& layout, float* weights)
+	{
+		WeightLayoutDetail::ConvertWeights<float, false>(packed.data(), weights, layout);
+	}
+}
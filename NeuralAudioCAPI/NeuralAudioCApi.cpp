@@ -4,6 +4,8 @@
 struct NeuralModel
 {
     NeuralAudio::NeuralModel* model;
+	std::vector<NeuralModel*> cloneWrappers;	// Preallocated wrappers for reserved clones, so CloneModel() doesn't allocate
+	size_t numReservedClones = 0;
 };
 
 struct NeuralModelLoader
@@ -11,6 +13,16 @@ struct NeuralModelLoader
 	NeuralAudio::NeuralModelLoader* loader;
 };
 
+struct NeuralModelBatch
+{
+	NeuralAudio::NeuralModelBatch* batch;
+};
+
+struct NeuralModelSlot
+{
+	NeuralAudio::ModelSlot* slot;
+};
+
 NeuralModelLoader* CreateLoader()
 {
 	NeuralModelLoader* loader = new NeuralModelLoader();
@@ -35,10 +47,51 @@ NeuralModel* CreateModelFromFile(NeuralModelLoader* loader, const wchar_t* model
     return model;
 }
 
+void CreateModelsFromFiles(NeuralModelLoader* loader, const wchar_t** modelPaths, size_t numModels, NeuralModel** models)
+{
+	std::vector<std::filesystem::path> paths(modelPaths, modelPaths + numModels);
+
+	std::vector<NeuralAudio::NeuralModel*> loadedModels = loader->loader->CreateFromFiles(paths);
+
+	for (size_t index = 0; index < numModels; index++)
+	{
+		models[index] = nullptr;
+
+		if (loadedModels[index] != nullptr)
+		{
+			models[index] = new NeuralModel();
+
+			models[index]->model = loadedModels[index];
+		}
+	}
+}
+
+// Deletes the wrapper and the wrappers reserved for its clones, but not the model itself
+static void DeleteModelWrapper(NeuralModel* model)
+{
+	for (auto wrapper : model->cloneWrappers)
+		delete wrapper;
+
+	delete model;
+}
+
 void DeleteModel(NeuralModel* model)
 {
     delete model->model;
-    delete model;
+
+	DeleteModelWrapper(model);
+}
+
+bool AddImpulseResponseFromFile(NeuralModelLoader* loader, NeuralModel* model, const wchar_t* wavPath)
+{
+	NeuralAudio::NeuralModel* chainModel = loader->loader->CreateWithImpulseResponse(model->model, wavPath);
+
+	if (chainModel == nullptr)
+		return false;
+
+	model->model = chainModel;
+
+	return true;
 }
 
 void SetLSTMLoadMode(NeuralModelLoader* loader, int loadMode)
@@ -61,6 +114,46 @@ void SetDefaultMaxAudioBufferSize(NeuralModelLoader* loader, int maxSize)
 	loader->loader->SetDefaultMaxAudioBufferSize(maxSize);
 }
 
+void SetFixedProcessingQuantum(NeuralModelLoader* loader, int quantumSamples)
+{
+	loader->loader->SetFixedProcessingQuantum(quantumSamples);
+}
+
+void SetKernelAutoTuning(NeuralModelLoader* loader, bool autoTune)
+{
+	loader->loader->SetKernelAutoTuning(autoTune);
+}
+
+void SetKernelTuningCachePath(NeuralModelLoader* loader, const wchar_t* cachePath)
+{
+	loader->loader->SetKernelTuningCachePath(cachePath);
+}
+
+void SetModelCaching(NeuralModelLoader* loader, bool cacheModels)
+{
+	loader->loader->SetModelCaching(cacheModels);
+}
+
+void ClearModelCache(NeuralModelLoader* loader)
+{
+	loader->loader->ClearModelCache();
+}
+
+void SetSharedModelData(NeuralModelLoader* loader, bool shareModelData)
+{
+	loader->loader->SetSharedModelData(shareModelData);
+}
+
+void ClearSharedModelData(NeuralModelLoader* loader)
+{
+	loader->loader->ClearSharedModelData();
+}
+
+void SetMaxLoadThreads(NeuralModelLoader* loader, int numThreads)
+{
+	loader->loader->SetMaxLoadThreads(numThreads);
+}
+
 int GetLoadMode(NeuralModel* model)
 {
 	return model->model->GetLoadMode();
@@ -91,9 +184,133 @@ float GetSampleRate(NeuralModel* model)
 	return model->model->GetSampleRate();
 }
 
+int GetLatencySamples(NeuralModel* model)
+{
+	return model->model->GetLatencySamples();
+}
+
 void Process(NeuralModel* model, float* input, float* output, size_t numSamples)
 {
     model->model->Process(input, output, numSamples);
 }
 
+NeuralModel* CloneModel(NeuralModel* model)
+{
+	NeuralAudio::NeuralModel* modelClone = model->model->Clone();
+
+	if (modelClone == nullptr)
+		return nullptr;
+
+	NeuralModel* clone = nullptr;
+
+	if (!model->cloneWrappers.empty())
+	{
+		clone = model->cloneWrappers.back();
+		model->cloneWrappers.pop_back();
+	}
+	else
+	{
+		clone = new NeuralModel();
+	}
+
+	clone->model = modelClone;
+
+	return clone;
+}
+
+size_t ReserveModelClones(NeuralModel* model, size_t numClones)
+{
+	size_t numReserved = model->model->ReserveClones(numClones);
+
+	// Keep room for every wrapper ever reserved, so releasing one never allocates
+	model->numReservedClones += numReserved;
+	model->cloneWrappers.reserve(model->numReservedClones);
+
+	for (size_t i = 0; i < numReserved; i++)
+		model->cloneWrappers.push_back(new NeuralModel());
+
+	return numReserved;
+}
+
+bool ReleaseModelClone(NeuralModel* model, NeuralModel* clone)
+{
+	if (!model->model->ReleaseClone(clone->model))
+		return false;
+
+	clone->model = nullptr;
+
+	if (model->cloneWrappers.size() < model->cloneWrappers.capacity())
+		model->cloneWrappers.push_back(clone);
+	else
+		delete clone;
+
+	return true;
+}
+
+NeuralModelBatch* CreateModelBatch(NeuralModel* model, size_t numInstances)
+{
+	NeuralAudio::NeuralModelBatch* modelBatch = model->model->CreateBatch(numInstances);
+
+	if (modelBatch == nullptr)
+		return nullptr;
+
+	NeuralModelBatch* batch = new NeuralModelBatch();
+
+	batch->batch = modelBatch;
+
+	return batch;
+}
+
+void DeleteModelBatch(NeuralModelBatch* batch)
+{
+	delete batch->batch;
+	delete batch;
+}
 
+size_t GetBatchNumInstances(NeuralModelBatch* batch)
+{
+	return batch->batch->GetNumInstances();
+}
+
+void ResetBatchInstance(NeuralModelBatch* batch, size_t instance)
+{
+	batch->batch->ResetInstance(instance);
+}
+
+void ProcessBatch(NeuralModelBatch* batch, float** inputs, float** outputs, size_t numSamples)
+{
+	batch->batch->Process(inputs, outputs, numSamples);
+}
+
+NeuralModelSlot* CreateModelSlot()
+{
+	NeuralModelSlot* slot = new NeuralModelSlot();
+
+	slot->slot = new NeuralAudio::ModelSlot();
+
+	return slot;
+}
+
+void DeleteModelSlot(NeuralModelSlot* slot)
+{
+	delete slot->slot;
+	delete slot;
+}
+
+void SetSlotModel(NeuralModelSlot* slot, NeuralModel* model)
+{
+	// The slot takes ownership of the model
+	slot->slot->SetModel(model->model);
+
+	DeleteModelWrapper(model);
+}
+
+void LoadSlotModelFromFile(NeuralModelSlot* slot, NeuralModelLoader* loader, const wchar_t* modelPath)
+{
+	slot->slot->LoadModel(*loader->loader, modelPath);
+}
+
+void ProcessSlot(NeuralModelSlot* slot, float* input, float* output, size_t numSamples)
+{
+	slot->slot->Process(input, output, numSamples);
+}
@@ -14,6 +14,8 @@ extern "C" {
 
 struct NeuralModel;
 struct NeuralModelLoader;
+struct NeuralModelBatch;
+struct NeuralModelSlot;
 
 NA_EXTERN NeuralModelLoader* CreateLoader();
 
@@ -21,8 +23,12 @@ NA_EXTERN void DeleteLoader(NeuralModelLoader* loader);
 
 NA_EXTERN NeuralModel* CreateModelFromFile(NeuralModelLoader *loader, const wchar_t* modelPath);
 
+NA_EXTERN void CreateModelsFromFiles(NeuralModelLoader* loader, const wchar_t** modelPaths, size_t numModels, NeuralModel** models);
+
 NA_EXTERN void DeleteModel(NeuralModel* model);
 
+NA_EXTERN bool AddImpulseResponseFromFile(NeuralModelLoader* loader, NeuralModel* model, const wchar_t* wavPath);
+
 NA_EXTERN void SetLSTMLoadMode(NeuralModelLoader* loader, int loadMode);
 
 NA_EXTERN void SetWaveNetLoadMode(NeuralModelLoader* loader, int loadMode);
@@ -31,6 +37,22 @@ NA_EXTERN void SetAudioInputLevelDBu(NeuralModelLoader* loader, float audioDBu);
 
 NA_EXTERN void SetDefaultMaxAudioBufferSize(NeuralModelLoader* loader, int maxSize);
 
+NA_EXTERN void SetFixedProcessingQuantum(NeuralModelLoader* loader, int quantumSamples);
+
+NA_EXTERN void SetKernelAutoTuning(NeuralModelLoader* loader, bool autoTune);
+
+NA_EXTERN void SetKernelTuningCachePath(NeuralModelLoader* loader, const wchar_t* cachePath);
+
+NA_EXTERN void SetModelCaching(NeuralModelLoader* loader, bool cacheModels);
+
+NA_EXTERN void ClearModelCache(NeuralModelLoader* loader);
+
+NA_EXTERN void SetSharedModelData(NeuralModelLoader* loader, bool shareModelData);
+
+NA_EXTERN void ClearSharedModelData(NeuralModelLoader* loader);
+
+NA_EXTERN void SetMaxLoadThreads(NeuralModelLoader* loader, int numThreads);
+
 NA_EXTERN int GetLoadMode(NeuralModel* model);
 
 NA_EXTERN bool IsStatic(NeuralModel* model);
@@ -43,8 +65,36 @@ NA_EXTERN float GetRecommendedOutputDBAdjustment(NeuralModel* model);
 
 NA_EXTERN float GetSampleRate(NeuralModel* model);
 
+NA_EXTERN int GetLatencySamples(NeuralModel* model);
+
 NA_EXTERN void Process(NeuralModel* model, float* input, float* output, size_t numSamples);
 
+NA_EXTERN NeuralModel* CloneModel(NeuralModel* model);
+
+NA_EXTERN size_t ReserveModelClones(NeuralModel* model, size_t numClones);
+
+NA_EXTERN bool ReleaseModelClone(NeuralModel* model, NeuralModel* clone);
+
+NA_EXTERN NeuralModelBatch* CreateModelBatch(NeuralModel* model, size_t numInstances);
+
+NA_EXTERN void DeleteModelBatch(NeuralModelBatch* batch);
+
+NA_EXTERN size_t GetBatchNumInstances(NeuralModelBatch* batch);
+
+NA_EXTERN void ResetBatchInstance(NeuralModelBatch* batch, size_t instance);
+
+NA_EXTERN void ProcessBatch(NeuralModelBatch* batch, float** inputs, float** outputs, size_t numSamples);
+
+NA_EXTERN NeuralModelSlot* CreateModelSlot();
+
+NA_EXTERN void DeleteModelSlot(NeuralModelSlot* slot);
+
+NA_EXTERN void SetSlotModel(NeuralModelSlot* slot, NeuralModel* model);
+
+NA_EXTERN void LoadSlotModelFromFile(NeuralModelSlot* slot, NeuralModelLoader* loader, const wchar_t* modelPath);
+
+NA_EXTERN void ProcessSlot(NeuralModelSlot* slot, float* input, float* output, size_t numSamples);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
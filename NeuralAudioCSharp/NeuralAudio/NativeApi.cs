@@ -20,6 +20,10 @@ namespace NeuralAudio
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern void DeleteModel(IntPtr model);
 
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool AddImpulseResponseFromFile(IntPtr loader, IntPtr model, [MarshalAs(UnmanagedType.LPWStr)]string wavPath);
+
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern void SetLSTMLoadMode(IntPtr loader, int loadMode);
 
@@ -32,6 +36,33 @@ namespace NeuralAudio
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern void SetDefaultMaxAudioBufferSize(IntPtr loader, int maxSize);
 
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetFixedProcessingQuantum(IntPtr loader, int quantumSamples);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetKernelAutoTuning(IntPtr loader, [MarshalAs(UnmanagedType.I1)] bool autoTune);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetKernelTuningCachePath(IntPtr loader, [MarshalAs(UnmanagedType.LPWStr)]string cachePath);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetModelCaching(IntPtr loader, [MarshalAs(UnmanagedType.I1)] bool cacheModels);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void ClearModelCache(IntPtr loader);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetSharedModelData(IntPtr loader, [MarshalAs(UnmanagedType.I1)] bool shareModelData);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void ClearSharedModelData(IntPtr loader);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetMaxLoadThreads(IntPtr loader, int numThreads);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void CreateModelsFromFiles(IntPtr loader, [MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.LPWStr)] string[] modelPaths, uint numModels, [Out] IntPtr[] models);
+
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern int GetLoadMode(IntPtr model);
 
@@ -50,7 +81,46 @@ namespace NeuralAudio
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern float GetSampleRate(IntPtr model);
 
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern int GetLatencySamples(IntPtr model);
+
         [DllImport(NEURAL_AUDIO_LIB_NAME)]
         public static extern unsafe void Process(IntPtr model, float* input, float* output, uint numSamples);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern IntPtr CloneModel(IntPtr model);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern uint ReserveModelClones(IntPtr model, uint numClones);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern IntPtr CreateModelBatch(IntPtr model, uint numInstances);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void DeleteModelBatch(IntPtr batch);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern uint GetBatchNumInstances(IntPtr batch);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void ResetBatchInstance(IntPtr batch, uint instance);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern unsafe void ProcessBatch(IntPtr batch, float** inputs, float** outputs, uint numSamples);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern IntPtr CreateModelSlot();
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void DeleteModelSlot(IntPtr slot);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void SetSlotModel(IntPtr slot, IntPtr model);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern void LoadSlotModelFromFile(IntPtr slot, IntPtr loader, [MarshalAs(UnmanagedType.LPWStr)] string modelPath);
+
+        [DllImport(NEURAL_AUDIO_LIB_NAME)]
+        public static extern unsafe void ProcessSlot(IntPtr slot, float* input, float* output, uint numSamples);
     }
 }
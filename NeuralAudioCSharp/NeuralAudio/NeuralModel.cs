@@ -1,5 +1,7 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.Runtime.CompilerServices;
+using System.Threading;
 
 namespace NeuralAudio
 {
@@ -7,12 +9,14 @@ namespace NeuralAudio
     {
         Internal,
         RTNeural,
-        NAMCore
+        NAMCore,
+        Auto
     };
 
     public class NeuralModelLoader
     {
-        IntPtr nativeLoader;
+        internal IntPtr nativeLoader;
+        internal int numDependents;    // Model slots that may still be loading with this loader
 
         public NeuralModelLoader()
         {
@@ -21,6 +25,14 @@ namespace NeuralAudio
 
         ~NeuralModelLoader()
         {
+            // Finalization order isn't guaranteed - wait until the slots using the loader are gone
+            if (Volatile.Read(ref numDependents) > 0)
+            {
+                GC.ReRegisterForFinalize(this);
+
+                return;
+            }
+
             NativeApi.DeleteLoader(nativeLoader);
         }
 
@@ -39,6 +51,47 @@ namespace NeuralAudio
             NativeApi.SetDefaultMaxAudioBufferSize(nativeLoader, bufferSize);
         }
 
+        public void SetFixedProcessingQuantum(int quantumSamples)
+        {
+            NativeApi.SetFixedProcessingQuantum(nativeLoader, quantumSamples);
+        }
+
+        public void SetKernelAutoTuning(bool autoTune)
+        {
+            NativeApi.SetKernelAutoTuning(nativeLoader, autoTune);
+        }
+
+        public void SetKernelTuningCachePath(string cachePath)
+        {
+            NativeApi.SetKernelTuningCachePath(nativeLoader, cachePath);
+        }
+
+        public void SetModelCaching(bool cacheModels)
+        {
+            NativeApi.SetModelCaching(nativeLoader, cacheModels);
+        }
+
+        public void ClearModelCache()
+        {
+            NativeApi.ClearModelCache(nativeLoader);
+        }
+
+        public void SetSharedModelData(bool shareModelData)
+        {
+            NativeApi.SetSharedModelData(nativeLoader, shareModelData);
+        }
+
+        public void ClearSharedModelData()
+        {
+            NativeApi.ClearSharedModelData(nativeLoader);
+        }
+
+        // Maximum number of threads used to load models in parallel. 0 uses one thread per CPU core.
+        public void SetMaxLoadThreads(int numThreads)
+        {
+            NativeApi.SetMaxLoadThreads(nativeLoader, numThreads);
+        }
+
         public NeuralModel CreateModelFromFile(string modelPath)
         {
             NeuralModel model = new NeuralModel();
@@ -50,21 +103,60 @@ namespace NeuralAudio
 
             return model;
         }
+
+        // Load several models in parallel. Entries are null for models that couldn't be loaded.
+        public NeuralModel[] CreateModelsFromFiles(string[] modelPaths)
+        {
+            IntPtr[] nativeModels = new IntPtr[modelPaths.Length];
+
+            NativeApi.CreateModelsFromFiles(nativeLoader, modelPaths, (uint)modelPaths.Length, nativeModels);
+
+            NeuralModel[] models = new NeuralModel[modelPaths.Length];
+
+            for (int i = 0; i < modelPaths.Length; i++)
+            {
+                if (nativeModels[i] == IntPtr.Zero)
+                    continue;
+
+                models[i] = new NeuralModel();
+
+                models[i].nativeModel = nativeModels[i];
+            }
+
+            return models;
+        }
+
+        // Chain an impulse response (ie: a cabinet IR) after the model. Returns false if the WAV file can't be read.
+        public bool AddImpulseResponseFromFile(NeuralModel model, string wavPath)
+        {
+            return NativeApi.AddImpulseResponseFromFile(nativeLoader, model.nativeModel, wavPath);
+        }
     }
 
     public class NeuralModel
     {
         internal IntPtr nativeModel;
+        internal int numDependents;    // Batches created from this model
 
         public bool IsStatic { get { return NativeApi.IsStatic(nativeModel);  } }
         public EModelLoadMode LoadMode { get { return (EModelLoadMode)NativeApi.GetLoadMode(nativeModel); } }
         public float SampleRate { get { return NativeApi.GetSampleRate(nativeModel); } }
+        public int LatencySamples { get { return NativeApi.GetLatencySamples(nativeModel); } }
         public float RecommendedInputDBAdjustment { get { return NativeApi.GetRecommendedInputDBAdjustment(nativeModel); } }
         public float RecommendedOutputDBAdjustment { get { return NativeApi.GetRecommendedOutputDBAdjustment(nativeModel); } }
 
         ~NeuralModel()
         {
-            NativeApi.DeleteModel(nativeModel);
+            // Finalization order isn't guaranteed - wait until the batches using the model are gone
+            if (Volatile.Read(ref numDependents) > 0)
+            {
+                GC.ReRegisterForFinalize(this);
+
+                return;
+            }
+
+            if (nativeModel != IntPtr.Zero)   // Ownership may have been passed to a ModelSlot
+                NativeApi.DeleteModel(nativeModel);
         }
 
         public void SetMaxAudioBufferSize(int bufferSize)
@@ -82,5 +174,185 @@ namespace NeuralAudio
                 }
             }
         }
+
+        // Returns null if the model doesn't support cloning. The clone shares the model's weights.
+        public NeuralModel Clone()
+        {
+            IntPtr nativeClone = NativeApi.CloneModel(nativeModel);
+
+            if (nativeClone == IntPtr.Zero)
+                return null;
+
+            NeuralModel clone = new NeuralModel();
+
+            clone.nativeModel = nativeClone;
+
+            return clone;
+        }
+
+        // Preallocate clones so that Clone() doesn't need to load anything
+        public int ReserveClones(int numClones)
+        {
+            return (int)NativeApi.ReserveModelClones(nativeModel, (uint)numClones);
+        }
+
+        // Returns null if the model doesn't support batch processing. The batch is only valid for the lifetime of the model.
+        public NeuralModelBatch CreateBatch(int numInstances)
+        {
+            IntPtr nativeBatch = NativeApi.CreateModelBatch(nativeModel, (uint)numInstances);
+
+            if (nativeBatch == IntPtr.Zero)
+                return null;
+
+            return new NeuralModelBatch(this, nativeBatch);
+        }
+    }
+
+    // Dispose the batch before the model it was created from goes away
+    public class NeuralModelBatch : IDisposable
+    {
+        NeuralModel model;  // Keep the model alive while the batch is in use
+        IntPtr nativeBatch;
+
+        public int NumInstances { get { return (int)NativeApi.GetBatchNumInstances(nativeBatch); } }
+
+        internal NeuralModelBatch(NeuralModel model, IntPtr nativeBatch)
+        {
+            this.model = model;
+            this.nativeBatch = nativeBatch;
+
+            Interlocked.Increment(ref model.numDependents);
+        }
+
+        ~NeuralModelBatch()
+        {
+            DeleteBatch();
+        }
+
+        public void Dispose()
+        {
+            DeleteBatch();
+
+            GC.SuppressFinalize(this);
+        }
+
+        void DeleteBatch()
+        {
+            IntPtr batch = Interlocked.Exchange(ref nativeBatch, IntPtr.Zero);
+
+            if (batch == IntPtr.Zero)
+                return;
+
+            NativeApi.DeleteModelBatch(batch);
+
+            // Only release the model once the batch is gone
+            Interlocked.Decrement(ref model.numDependents);
+        }
+
+        public void ResetInstance(int instance)
+        {
+            NativeApi.ResetBatchInstance(nativeBatch, (uint)instance);
+        }
+
+        // Input and output hold numSamples for each instance, one instance after another
+        public unsafe void Process(ReadOnlySpan<float> input, Span<float> output, uint numSamples)
+        {
+            int numInstances = NumInstances;
+
+            float** inputPtrs = stackalloc float*[numInstances];
+            float** outputPtrs = stackalloc float*[numInstances];
+
+            fixed (float* inputPtr = input)
+            {
+                fixed (float* outputPtr = output)
+                {
+                    for (int instance = 0; instance < numInstances; instance++)
+                    {
+                        inputPtrs[instance] = inputPtr + (instance * numSamples);
+                        outputPtrs[instance] = outputPtr + (instance * numSamples);
+                    }
+
+                    NativeApi.ProcessBatch(nativeBatch, inputPtrs, outputPtrs, numSamples);
+                }
+            }
+        }
+    }
+
+    // Dispose the slot before the loaders used with it go away
+    public class ModelSlot : IDisposable
+    {
+        IntPtr nativeSlot;
+        List<NeuralModelLoader> loaders = new List<NeuralModelLoader>();   // Keep the loaders alive while a load may be running
+
+        public ModelSlot()
+        {
+            nativeSlot = NativeApi.CreateModelSlot();
+        }
+
+        ~ModelSlot()
+        {
+            DeleteSlot();
+        }
+
+        public void Dispose()
+        {
+            DeleteSlot();
+
+            GC.SuppressFinalize(this);
+        }
+
+        void DeleteSlot()
+        {
+            IntPtr slot = Interlocked.Exchange(ref nativeSlot, IntPtr.Zero);
+
+            if (slot == IntPtr.Zero)
+                return;
+
+            // Waits for any background load to finish
+            NativeApi.DeleteModelSlot(slot);
+
+            lock (loaders)
+            {
+                foreach (NeuralModelLoader loader in loaders)
+                    Interlocked.Decrement(ref loader.numDependents);
+
+                loaders.Clear();
+            }
+        }
+
+        // The slot takes ownership of the model, which can't be used afterwards
+        public void SetModel(NeuralModel model)
+        {
+            NativeApi.SetSlotModel(nativeSlot, model.nativeModel);
+
+            model.nativeModel = IntPtr.Zero;
+        }
+
+        // Load the model in the background, and swap it in when it is ready
+        public void LoadModel(NeuralModelLoader loader, string modelPath)
+        {
+            lock (loaders)
+            {
+                if (!loaders.Contains(loader))
+                {
+                    loaders.Add(loader);
+
+                    Interlocked.Increment(ref loader.numDependents);
+                }
+            }
+
+            NativeApi.LoadSlotModelFromFile(nativeSlot, loader.nativeLoader, modelPath);
+        }
+
+        public unsafe void Process(ReadOnlySpan<float> input, Span<float> output, uint numSamples)
+        {
+            fixed (float* inputPtr = input)
+            {
+                fixed (float* outputPtr = output)
+                {
+                    NativeApi.ProcessSlot(nativeSlot, inputPtr, outputPtr, numSamples);
+                }
+            }
+        }
     }
 }
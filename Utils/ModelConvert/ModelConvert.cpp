@@ -0,0 +1,43 @@
+#include <filesystem>
+#include <iostream>
+#include <NeuralAudio/NeuralModel.h>
+
+using namespace NeuralAudio;
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: ModelConvert <model file> [<binary model file>]" << std::endl;
+
+		return 1;
+	}
+
+	std::filesystem::path modelPath = argv[1];
+	std::filesystem::path binaryModelPath = modelPath;
+
+	if (argc > 2)
+		binaryModelPath = argv[2];
+	else
+		binaryModelPath.replace_extension(".namb");
+
+	try
+	{
+		if (!NeuralModelLoader::ConvertToBinaryModel(modelPath, binaryModelPath))
+		{
+			std::cout << "Unable to convert model: " << modelPath << std::endl;
+
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Error converting model: " << e.what() << std::endl;
+
+		return 1;
+	}
+
+	std::cout << "Wrote: " << binaryModelPath << std::endl;
+
+	return 0;
+}
@@ -1,12 +1,14 @@
 #include <math.h>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include "argparse.hpp"
 #include <NeuralAudio/NeuralModel.h>
 
 using namespace NeuralAudio;
 
-static std::string LoadModes[] = { "Internal", "RTNeural", "NAMCore" };
+static std::string LoadModes[] = { "Internal", "RTNeural", "NAMCore", "Auto" };
 
 NeuralModel* LoadModel(std::filesystem::path modelPath, NeuralModelLoader& loader, EModelLoadMode loadMode)
 {
@@ -31,7 +33,7 @@ NeuralModel* LoadModel(std::filesystem::path modelPath, NeuralModelLoader& loade
 			return nullptr;
 		}
 
-		if (model->GetLoadMode() != loadMode)
+		if ((loadMode != EModelLoadMode::Auto) && (model->GetLoadMode() != loadMode))
 		{
 			delete model;
 
@@ -117,6 +119,28 @@ static double ComputeError(NeuralModel* model1, NeuralModel* model2, int blockSi
 	return sqrt(totErr / (double)(blockSize * numBlocks));
 }
 
+static double BenchProcessor(NeuralModelProcessor processor, int blockSize, int numBlocks)
+{
+	std::vector<float> inData;
+	inData.resize(blockSize);
+
+	std::vector<float> outData;
+	outData.resize(blockSize);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		processor.Process(inData.data(), outData.data(), blockSize);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double tot = std::chrono::duration_cast<std::chrono::duration<double>> (end - start).count();
+
+	return tot;
+}
+
 void PrintBench(std::string name, double time, int dataSize)
 {
 	std::cout << name << ": " << time << " (" << (((float)dataSize / 48000.0f) / time) << "xRT)" << std::endl;
@@ -187,6 +211,15 @@ void RunNAMTests(std::filesystem::path modelPath, NeuralModelLoader& loader, int
 		}
 	}
 
+	NeuralModel* autoModel = LoadModel(modelPath, loader, EModelLoadMode::Auto);
+
+	if (autoModel != nullptr)
+	{
+		std::cout << "Auto load mode picked: " << LoadModes[autoModel->GetLoadMode()] << std::endl;
+
+		delete autoModel;
+	}
+
 	std::cout << std::endl;
 }
 
@@ -203,6 +236,17 @@ void RunKerasTests(std::filesystem::path modelPath, NeuralModelLoader& loader, i
 	auto internalModel = LoadModel(modelPath, loader, EModelLoadMode::Internal);
 	auto rtNeuralModel = LoadModel(modelPath, loader, EModelLoadMode::RTNeural);
 
+	if ((internalModel == nullptr) || (rtNeuralModel == nullptr))
+	{
+		std::cout << "Model can't be loaded as " << ((internalModel == nullptr) ? "internal" : "RTNeural") << " model" << std::endl;
+		std::cout << std::endl;
+
+		delete internalModel;
+		delete rtNeuralModel;
+
+		return;
+	}
+
 	double rms = ComputeError(rtNeuralModel, internalModel, blockSize, numBlocks);
 	std::cout << "Internal vs RTNeural RMS err: " << rms << std::endl;
 	std::cout << std::endl;
@@ -215,9 +259,236 @@ void RunKerasTests(std::filesystem::path modelPath, NeuralModelLoader& loader, i
 	std::cout << "Internal is: " << (rt / internal) << "x RTNeural" << std::endl;
 
 	std::cout << std::endl;
+
+	delete internalModel;
+	delete rtNeuralModel;
 }
 
-int RunDefaultTests(NeuralModelLoader& loader, int blockSize)
+// Synthetic models with random weights, for architectures we don't have example models of
+
+static std::mt19937 testRandom(1234);
+
+static float RandomWeight(float scale)
+{
+	return std::uniform_real_distribution<float>(-scale, scale)(testRandom);
+}
+
+static void AddRandomWeights(std::vector<float>& weights, size_t numWeights, float scale, float offset = 0)
+{
+	for (size_t i = 0; i < numWeights; i++)
+		weights.push_back(offset + RandomWeight(scale));
+}
+
+// Nested keras weight array with the given shape
+static nlohmann::json KerasWeights(std::vector<size_t> shape, float scale)
+{
+	nlohmann::json weights = nlohmann::json::array();
+
+	size_t size = shape[0];
+
+	shape.erase(shape.begin());
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (shape.empty())
+			weights.push_back(RandomWeight(scale));
+		else
+			weights.push_back(KerasWeights(shape, scale));
+	}
+
+	return weights;
+}
+
+static nlohmann::json KerasLayer(std::string type, std::string activation, size_t size, nlohmann::json weights)
+{
+	return { { "type", type }, { "activation", activation }, { "shape", { nullptr, nullptr, size } }, { "weights", weights } };
+}
+
+static std::filesystem::path WriteTestModel(const nlohmann::json& modelJson, std::string fileName)
+{
+	std::filesystem::path modelPath = std::filesystem::temp_directory_path() / fileName;
+
+	std::ofstream modelStream(modelPath);
+
+	modelStream << modelJson;
+
+	return modelPath;
+}
+
+static std::filesystem::path WriteKerasConv1DModel()
+{
+	nlohmann::json conv1 = KerasLayer("conv1d", "tanh", 8, { KerasWeights({ 3, 1, 8 }, 0.5f), KerasWeights({ 8 }, 0.1f) });
+	conv1["kernel_size"] = { 3 };
+	conv1["dilation"] = { 2 };
+
+	nlohmann::json conv2 = KerasLayer("conv1d", "tanh", 8, { KerasWeights({ 2, 8, 8 }, 0.3f), KerasWeights({ 8 }, 0.1f) });
+	conv2["kernel_size"] = { 2 };
+	conv2["dilation"] = { 4 };
+
+	nlohmann::json modelJson = { { "in_shape", { nullptr, nullptr, 1 } },
+		{ "layers", { conv1, conv2, KerasLayer("dense", "", 1, { KerasWeights({ 8, 1 }, 0.3f), KerasWeights({ 1 }, 0.1f) }) } } };
+
+	return WriteTestModel(modelJson, "ModelTestConv1D.json");
+}
+
+static std::filesystem::path WriteKerasGRUModel(size_t hiddenSize)
+{
+	nlohmann::json gru = KerasLayer("gru", "", hiddenSize, { KerasWeights({ 1, 3 * hiddenSize }, 0.5f), KerasWeights({ hiddenSize, 3 * hiddenSize }, 0.3f),
+		KerasWeights({ 2, 3 * hiddenSize }, 0.1f) });
+
+	nlohmann::json modelJson = { { "in_shape", { nullptr, nullptr, 1 } },
+		{ "layers", { gru, KerasLayer("dense", "", 1, { KerasWeights({ hiddenSize, 1 }, 0.3f), KerasWeights({ 1 }, 0.1f) }) } } };
+
+	return WriteTestModel(modelJson, "ModelTestGRU.json");
+}
+
+static std::filesystem::path WriteNAMModel(std::string architecture, const nlohmann::json& config, const std::vector<float>& weights, std::string fileName)
+{
+	nlohmann::json modelJson = { { "version", "0.5.4" }, { "architecture", architecture }, { "config", config }, { "weights", weights }, { "sample_rate", 48000 } };
+
+	return WriteTestModel(modelJson, fileName);
+}
+
+static std::filesystem::path WriteNAMConvNetModel(size_t channels, size_t numBlocks)
+{
+	std::vector<size_t> dilations;
+	std::vector<float> weights;
+
+	for (size_t block = 0; block < numBlocks; block++)
+	{
+		dilations.push_back((size_t)1 << block);
+
+		AddRandomWeights(weights, channels * ((block == 0) ? 1 : channels) * 2, 0.5f);	// Convolution
+
+		AddRandomWeights(weights, channels, 0.1f);	// Batchnorm running mean
+		AddRandomWeights(weights, channels, 0.5f, 1.0f);	// Running variance
+		AddRandomWeights(weights, channels, 0.5f, 1.0f);	// Weight
+		AddRandomWeights(weights, channels, 0.1f);	// Bias
+		weights.push_back(1e-5f);	// Epsilon
+	}
+
+	AddRandomWeights(weights, channels + 1, 0.3f);	// Head
+
+	nlohmann::json config = { { "channels", channels }, { "dilations", dilations }, { "batchnorm", true }, { "activation", "Tanh" } };
+
+	return WriteNAMModel("ConvNet", config, weights, "ModelTestConvNet.nam");
+}
+
+static std::filesystem::path WriteNAMLinearModel(size_t receptiveField)
+{
+	std::vector<float> weights;
+
+	AddRandomWeights(weights, receptiveField + 1, 0.1f);	// Kernel and bias
+
+	nlohmann::json config = { { "receptive_field", receptiveField }, { "bias", true } };
+
+	return WriteNAMModel("Linear", config, weights, "ModelTestLinear.nam");
+}
+
+// Checks the partitioned convolution of an impulse response against direct convolution
+void RunImpulseResponseTest(NeuralModelLoader& loader, int blockSize, size_t impulseResponseLength)
+{
+	int dataSize = 4096 * 16;
+
+	int numBlocks = dataSize / blockSize;
+
+	loader.SetDefaultMaxAudioBufferSize(blockSize);
+	loader.SetWaveNetLoadMode(EModelLoadMode::Internal);
+
+	// A single tap Linear model passes the input through unchanged
+	nlohmann::json modelJson = { { "version", "0.5.4" }, { "architecture", "Linear" }, { "config", { { "receptive_field", 1 }, { "bias", false } } },
+		{ "weights", { 1.0f } }, { "sample_rate", 48000 } };
+
+	NeuralModel* model = loader.CreateFromJson(modelJson, ".nam", false);
+
+	std::vector<float> impulseResponse;
+
+	for (size_t i = 0; i < impulseResponseLength; i++)
+		impulseResponse.push_back(RandomWeight(1.0f) * expf(-(float)i / (float)(impulseResponseLength / 8)));
+
+	NeuralModel* irModel = loader.CreateWithImpulseResponse(model, impulseResponse.data(), impulseResponse.size(), false);
+
+	if (irModel == nullptr)
+	{
+		std::cout << "Unable to create impulse response model" << std::endl;
+
+		delete model;
+
+		return;
+	}
+
+	std::vector<float> inData;
+	inData.resize(dataSize);
+
+	std::vector<float> outData;
+	outData.resize(dataSize);
+
+	for (int i = 0; i < dataSize; i++)
+	{
+		inData[i] = (float)sin(i * 0.01);
+	}
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		irModel->Process(inData.data() + (block * blockSize), outData.data() + (block * blockSize), blockSize);
+	}
+
+	double totErr = 0;
+
+	for (int i = 0; i < (numBlocks * blockSize); i++)
+	{
+		double expected = 0;
+
+		for (size_t tap = 0; (tap < impulseResponseLength) && (tap <= (size_t)i); tap++)
+		{
+			expected += impulseResponse[tap] * inData[i - tap];
+		}
+
+		double diff = outData[i] - expected;
+
+		totErr += (diff * diff);
+	}
+
+	std::cout << "Impulse response length: " << impulseResponseLength << std::endl;
+	std::cout << "Partitioned vs direct convolution RMS err: " << sqrt(totErr / (double)(numBlocks * blockSize)) << std::endl;
+
+	PrintBench("Impulse response", BenchModel(irModel, blockSize, numBlocks), dataSize);
+
+	std::cout << std::endl;
+
+	delete irModel;
+}
+
+void RunBlockSizeSweep(std::filesystem::path modelPath, NeuralModelLoader& loader)
+{
+	std::cout << "Block size sweep: " << modelPath << std::endl;
+
+	int dataSize = 4096 * 64;
+
+	for (int blockSize : { 8, 16, 32, 64, 128, 256 })
+	{
+		loader.SetDefaultMaxAudioBufferSize(blockSize);
+
+		NeuralModel* model = LoadModel(modelPath, loader, EModelLoadMode::Internal);
+
+		if (model == nullptr)
+		{
+			std::cout << "Model can't be loaded as internal model" << std::endl;
+
+			return;
+		}
+
+		double time = BenchProcessor(model->GetProcessor(), blockSize, dataSize / blockSize);
+
+		std::cout << "Block size " << blockSize << ": " << ((time * 1e9) / (double)dataSize) << " ns/sample (" << (((float)dataSize / 48000.0f) / time) << "xRT)" << std::endl;
+
+		delete model;
+	}
+
+	std::cout << std::endl;
+}
+
+std::filesystem::path FindModelsPath()
 {
 	std::filesystem::path modelPath = std::filesystem::current_path();
 
@@ -236,10 +507,32 @@ int RunDefaultTests(NeuralModelLoader& loader, int blockSize)
 		std::cout << "ModelTest looks for a \"Models\" folder in current folder or up the path." << std::endl;
 		std::cout << "You can also specify a specific model to test by passing the path on the commandline." << std::endl;
 
-		return -1;
+		return std::filesystem::path();
 	}
 
-	modelPath = modelPath / "Models";
+	return modelPath / "Models";
+}
+
+int RunDefaultBlockSizeSweep(NeuralModelLoader& loader)
+{
+	std::filesystem::path modelPath = FindModelsPath();
+
+	if (modelPath.empty())
+		return -1;
+
+	RunBlockSizeSweep(modelPath / "BossWN-a2.nam", loader);
+	RunBlockSizeSweep(modelPath / "BossWN-standard.nam", loader);
+	RunBlockSizeSweep(modelPath / "BossLSTM-1x16.nam", loader);
+
+	return 0;
+}
+
+int RunDefaultTests(NeuralModelLoader& loader, int blockSize)
+{
+	std::filesystem::path modelPath = FindModelsPath();
+
+	if (modelPath.empty())
+		return -1;
 
 	std::cout << "Loading models from: " << modelPath << std::endl << std::endl;
 
@@ -263,6 +556,31 @@ int RunDefaultTests(NeuralModelLoader& loader, int blockSize)
 	std::cout << "LSTM (1x16) Test" << std::endl;
 	RunNAMTests(modelPath / "BossLSTM-1x16.nam", loader, blockSize);
 
+	std::cout << std::endl;
+
+	std::cout << "ConvNet (8 channel) Test" << std::endl;
+	RunNAMTests(WriteNAMConvNetModel(8, 12), loader, blockSize);
+
+	std::cout << std::endl;
+
+	std::cout << "Linear Test" << std::endl;
+	RunNAMTests(WriteNAMLinearModel(256), loader, blockSize);
+
+	std::cout << std::endl;
+
+	std::cout << "Impulse Response Test" << std::endl;
+	RunImpulseResponseTest(loader, blockSize, 4096);
+
+	std::cout << std::endl;
+
+	std::cout << "Keras GRU (1x12) Test" << std::endl;
+	RunKerasTests(WriteKerasGRUModel(12), loader, blockSize);
+
+	std::cout << std::endl;
+
+	std::cout << "Keras Conv1D Test" << std::endl;
+	RunKerasTests(WriteKerasConv1DModel(), loader, blockSize);
+
 	return 0;
 }
 
@@ -288,6 +606,12 @@ int main(int argc, char* argv[])
 		.required()
 		.help("Quality scaling (0.0 is fasteset, 1.0 is highest quality")
 		.scan<'g', float>();
+
+	program.add_argument("-s", "--block_sweep")
+		.default_value(false)
+		.implicit_value(true)
+		.help("Benchmark per-sample cost of the internal model across a range of block sizes");
+
     try
 	{
         program.parse_args(argc, argv);
@@ -316,7 +640,19 @@ int main(int argc, char* argv[])
 
 	std::cout << "Block size: " << blockSize << "  Quality Scale: " << qualityScale << std::endl;
 
-	if (!modelPath.empty())
+	if (program.get<bool>("--block_sweep"))
+	{
+		if (!modelPath.empty())
+		{
+			RunBlockSizeSweep(modelPath, loader);
+		}
+		else
+		{
+			if (RunDefaultBlockSizeSweep(loader) < 0)
+				return -1;
+		}
+	}
+	else if (!modelPath.empty())
 	{
 		if (modelPath.extension() == ".nam")
 		{